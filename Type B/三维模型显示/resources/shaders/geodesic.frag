@@ -0,0 +1,16 @@
+#version 330 core
+
+in float vDistance;
+out vec4 color;
+uniform vec3 uColor;
+uniform float uMaxDistance;
+uniform float uBands;
+void main()
+{
+ // warm near the source, cold far away, with dark isolines
+ float t = clamp(vDistance / max(uMaxDistance, 1e-6), 0.0, 1.0);
+ vec3 base = mix(vec3(1.0, 0.85, 0.3), uColor, t);
+ float band = fract(vDistance / max(uMaxDistance, 1e-6) * uBands);
+ float line = smoothstep(0.0, 0.08, band) * smoothstep(1.0, 0.92, band);
+ color = vec4(base * (0.35 + 0.65 * line), 1.0);
+}
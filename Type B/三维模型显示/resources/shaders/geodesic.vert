@@ -0,0 +1,15 @@
+#version 330 core
+layout (location = 0) in vec3 position;
+layout (location = 1) in float distance;
+
+uniform mat4 model;
+uniform mat4 view;
+uniform mat4 projection;
+
+out float vDistance;
+
+void main()
+{
+  gl_Position = projection * view * model * vec4(position, 1.0f);
+  vDistance = distance;
+}
@@ -0,0 +1,15 @@
+#version 330 core
+layout (location = 0) in vec3 position;
+layout (location = 1) in vec3 normal;
+layout (location = 2) in mat4 instanceModel;
+
+uniform mat4 view;
+uniform mat4 projection;
+
+out vec3 vNormal;
+
+void main()
+{
+  gl_Position = projection * view * instanceModel * vec4(position, 1.0f);
+  vNormal = mat3(instanceModel) * normal;
+}
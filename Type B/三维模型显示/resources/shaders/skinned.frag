@@ -0,0 +1,11 @@
+#version 330 core
+
+in vec3 vNormal;
+out vec4 color;
+uniform vec3 uColor;
+void main()
+{
+ vec3 l = normalize(vec3(0.4, 0.8, 0.5));
+ float diffuse = max(dot(normalize(vNormal), l), 0.0);
+ color = vec4(uColor * (0.25 + 0.75 * diffuse), 1.0);
+}
@@ -0,0 +1,56 @@
+#version 330 core
+layout (location = 0) in vec3 position;
+layout (location = 1) in vec3 normal;
+layout (location = 2) in ivec4 boneIds;
+layout (location = 3) in vec4 weights;
+layout (location = 4) in ivec2 morphRange;
+
+// Sizes must match SkinnedMesh::MAX_PALETTE / MAX_MORPH_WEIGHTS
+layout (std140) uniform SkinPalette
+{
+  mat4 uBones[256];
+};
+layout (std140) uniform MorphWeights
+{
+  vec4 uMorphWeights[256];
+};
+
+// Two texels per sparse entry: (position delta, target), (normal delta, 0)
+uniform samplerBuffer uMorphDeltas;
+uniform int uBonesPerInstance;
+uniform int uTargetsPerInstance;
+
+uniform mat4 view;
+uniform mat4 projection;
+
+out vec3 vNormal;
+
+float morphWeight(int i)
+{
+  return uMorphWeights[i >> 2][i & 3];
+}
+
+void main()
+{
+  vec3 p = position;
+  vec3 n = normal;
+  int weightBase = gl_InstanceID * uTargetsPerInstance;
+  for (int e = morphRange.x; e < morphRange.x + morphRange.y; ++e)
+  {
+    vec4 d = texelFetch(uMorphDeltas, e * 2);
+    float w = morphWeight(weightBase + int(d.w));
+    p += w * d.xyz;
+    n += w * texelFetch(uMorphDeltas, e * 2 + 1).xyz;
+  }
+
+  int boneBase = gl_InstanceID * uBonesPerInstance;
+  mat4 skin = mat4(0.0);
+  for (int k = 0; k < 4; ++k)
+  {
+    if (boneIds[k] >= 0 && weights[k] > 0.0)
+      skin += weights[k] * uBones[boneBase + boneIds[k]];
+  }
+
+  gl_Position = projection * view * skin * vec4(p, 1.0);
+  vNormal = mat3(skin) * n;
+}
@@ -0,0 +1,114 @@
+#include "file_watcher.h"
+#include <chrono>
+#include <iostream>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <climits>
+#else
+#include <filesystem>
+#include <system_error>
+#endif
+
+// Writers often touch a file several times in a row; wait this long after
+// the last event before reporting a change
+static const int SETTLE_MS = 100;
+
+bool FileWatcher::start(const std::string& path, std::function<void()> onChange)
+{
+    stop();
+    filePath = path;
+    callback = std::move(onChange);
+    running = true;
+    worker = std::thread(&FileWatcher::run, this);
+    return true;
+}
+
+void FileWatcher::stop()
+{
+    running = false;
+    if (worker.joinable()) worker.join();
+}
+
+#ifdef __linux__
+
+void FileWatcher::run()
+{
+    size_t slash = filePath.find_last_of('/');
+    std::string dir = (slash == std::string::npos) ? "." : filePath.substr(0, slash);
+    std::string name = (slash == std::string::npos) ? filePath : filePath.substr(slash + 1);
+
+    int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (fd < 0) {
+        std::cout << "FileWatcher: inotify unavailable" << std::endl;
+        return;
+    }
+    if (inotify_add_watch(fd, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE) < 0) {
+        std::cout << "FileWatcher: cannot watch " << dir << std::endl;
+        close(fd);
+        return;
+    }
+
+    alignas(inotify_event) char buf[sizeof(inotify_event) + NAME_MAX + 1];
+    bool pending = false;
+    auto lastEvent = std::chrono::steady_clock::now();
+
+    while (running)
+    {
+        // wake up regularly so stop() never waits long
+        pollfd pfd = {fd, POLLIN, 0};
+        int ready = poll(&pfd, 1, 50);
+
+        if (ready > 0 && (pfd.revents & POLLIN)) {
+            ssize_t len;
+            while ((len = read(fd, buf, sizeof(buf))) > 0) {
+                for (char* p = buf; p < buf + len;) {
+                    const inotify_event* ev = reinterpret_cast<const inotify_event*>(p);
+                    if (ev->len > 0 && name == ev->name) {
+                        pending = true;
+                        lastEvent = std::chrono::steady_clock::now();
+                    }
+                    p += sizeof(inotify_event) + ev->len;
+                }
+            }
+        }
+
+        if (pending && std::chrono::steady_clock::now() - lastEvent > std::chrono::milliseconds(SETTLE_MS)) {
+            pending = false;
+            callback();
+        }
+    }
+
+    close(fd);
+}
+
+#else
+
+void FileWatcher::run()
+{
+    namespace fs = std::filesystem;
+    std::error_code ec;
+    fs::file_time_type lastWrite = fs::last_write_time(filePath, ec);
+    bool pending = false;
+    auto lastChange = std::chrono::steady_clock::now();
+
+    while (running)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+        fs::file_time_type t = fs::last_write_time(filePath, ec);
+        if (!ec && t != lastWrite) {
+            lastWrite = t;
+            pending = true;
+            lastChange = std::chrono::steady_clock::now();
+        }
+        if (pending && std::chrono::steady_clock::now() - lastChange > std::chrono::milliseconds(SETTLE_MS)) {
+            pending = false;
+            callback();
+        }
+    }
+}
+
+#endif
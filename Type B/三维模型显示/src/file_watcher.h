@@ -0,0 +1,34 @@
+#ifndef FILE_WATCHER_H
+#define FILE_WATCHER_H
+
+#include <atomic>
+#include <functional>
+#include <string>
+#include <thread>
+
+// Watches one file and calls onChange on a background thread whenever it
+// has been rewritten. Uses inotify on Linux (watching the parent directory,
+// so editors that save by rename are caught too) and polls the modification
+// time elsewhere.
+class FileWatcher
+{
+public:
+    FileWatcher() = default;
+    ~FileWatcher() { stop(); }
+
+    FileWatcher(const FileWatcher&) = delete;
+    FileWatcher& operator=(const FileWatcher&) = delete;
+
+    bool start(const std::string& path, std::function<void()> onChange);
+    void stop();
+
+private:
+    void run();
+
+    std::string filePath;
+    std::function<void()> callback;
+    std::thread worker;
+    std::atomic<bool> running{false};
+};
+
+#endif
@@ -0,0 +1,221 @@
+#include "geodesic.h"
+#include "parallel.h"
+#include <algorithm>
+#include <cmath>
+#include <future>
+#include <iostream>
+#include <limits>
+
+// The Laplacian is singular on every closed component; shift it by this
+// much of the mass matrix (relative to 1 / bounding box diagonal^2) so it
+// can be factored without visibly moving the distances
+static const double POISSON_SHIFT = 1e-6;
+
+bool HeatGeodesic::build(const Hedge& mesh, double timeScale)
+{
+    ready = false;
+
+    std::vector<glm::vec3> floatPositions;
+    mesh.buildVertexArray(floatPositions);
+    mesh.buildFaceIndexArray(indices);
+    positions.assign(floatPositions.size(), glm::dvec3(0.0));
+    for (size_t i = 0; i < floatPositions.size(); ++i) positions[i] = glm::dvec3(floatPositions[i]);
+
+    const int numVerts = static_cast<int>(positions.size());
+    const size_t numFaces = indices.size() / 3;
+    if (numVerts == 0 || numFaces == 0) {
+        std::cout << "HeatGeodesic: empty mesh" << std::endl;
+        return false;
+    }
+
+    // ---- per face: corner cotangents and area
+    cotangents.resize(numFaces * 3);
+    std::vector<double> faceArea(numFaces);
+    parallelFor(numFaces, 4096, [&](size_t begin, size_t end) {
+        for (size_t f = begin; f < end; ++f) {
+            for (int c = 0; c < 3; ++c) {
+                const glm::dvec3& p = positions[indices[f * 3 + c]];
+                glm::dvec3 u = positions[indices[f * 3 + (c + 1) % 3]] - p;
+                glm::dvec3 v = positions[indices[f * 3 + (c + 2) % 3]] - p;
+                double s = glm::length(glm::cross(u, v));
+                cotangents[f * 3 + c] = glm::dot(u, v) / std::max(s, 1e-300);
+                if (c == 0) faceArea[f] = 0.5 * s;
+            }
+        }
+    });
+
+    // ---- corners around each vertex
+    vertexFaceOffsets.assign(numVerts + 1, 0);
+    for (unsigned int v : indices) vertexFaceOffsets[v + 1]++;
+    for (int v = 0; v < numVerts; ++v) vertexFaceOffsets[v + 1] += vertexFaceOffsets[v];
+    vertexCorners.resize(indices.size());
+    {
+        std::vector<int> next(vertexFaceOffsets.begin(), vertexFaceOffsets.end() - 1);
+        for (size_t i = 0; i < indices.size(); ++i) vertexCorners[next[indices[i]]++] = static_cast<int>(i);
+    }
+
+    // ---- cotan Laplacian L (positive semi-definite) and lumped mass M.
+    // Each column only reads its own corners, so columns fill in parallel.
+    SparseMatrix L;
+    L.n = numVerts;
+    L.colPtr.assign(numVerts + 1, 0);
+    std::vector<double> mass(numVerts, 0.0);
+    std::vector<int> diagonal(numVerts);
+
+    auto gatherNeighbors = [&](int v, std::vector<int>& out) {
+        out.clear();
+        out.push_back(v);
+        for (int k = vertexFaceOffsets[v]; k < vertexFaceOffsets[v + 1]; ++k) {
+            size_t f = vertexCorners[k] / 3;
+            int c = vertexCorners[k] % 3;
+            out.push_back(static_cast<int>(indices[f * 3 + (c + 1) % 3]));
+            out.push_back(static_cast<int>(indices[f * 3 + (c + 2) % 3]));
+        }
+        std::sort(out.begin(), out.end());
+        out.erase(std::unique(out.begin(), out.end()), out.end());
+    };
+
+    parallelFor(numVerts, 4096, [&](size_t begin, size_t end) {
+        std::vector<int> scratch;
+        for (size_t v = begin; v < end; ++v) {
+            gatherNeighbors(static_cast<int>(v), scratch);
+            L.colPtr[v + 1] = static_cast<int>(scratch.size());
+        }
+    });
+    for (int v = 0; v < numVerts; ++v) L.colPtr[v + 1] += L.colPtr[v];
+    L.rowIdx.resize(L.colPtr[numVerts]);
+    L.values.assign(L.colPtr[numVerts], 0.0);
+
+    parallelFor(numVerts, 4096, [&](size_t begin, size_t end) {
+        std::vector<int> scratch;
+        for (size_t vi = begin; vi < end; ++vi) {
+            int v = static_cast<int>(vi);
+            gatherNeighbors(v, scratch);
+            int base = L.colPtr[v];
+            std::copy(scratch.begin(), scratch.end(), L.rowIdx.begin() + base);
+            auto slot = [&](int row) {
+                return base + static_cast<int>(std::lower_bound(scratch.begin(), scratch.end(), row) - scratch.begin());
+            };
+            diagonal[v] = slot(v);
+
+            for (int k = vertexFaceOffsets[v]; k < vertexFaceOffsets[v + 1]; ++k) {
+                size_t f = vertexCorners[k] / 3;
+                int c = vertexCorners[k] % 3;
+                int j = static_cast<int>(indices[f * 3 + (c + 1) % 3]);
+                int l = static_cast<int>(indices[f * 3 + (c + 2) % 3]);
+                // edge v-j is opposite the corner at l, edge v-l opposite j
+                double wj = 0.5 * cotangents[f * 3 + (c + 2) % 3];
+                double wl = 0.5 * cotangents[f * 3 + (c + 1) % 3];
+                L.values[slot(j)] -= wj;
+                L.values[slot(l)] -= wl;
+                L.values[diagonal[v]] += wj + wl;
+                mass[v] += faceArea[f] / 3.0;
+            }
+        }
+    });
+
+    // ---- time step and shift from the mesh scale
+    double edgeSum = 0.0;
+    glm::dvec3 lo = positions[0], hi = positions[0];
+    for (size_t f = 0; f < numFaces; ++f) {
+        for (int c = 0; c < 3; ++c) {
+            edgeSum += glm::length(positions[indices[f * 3 + (c + 1) % 3]] - positions[indices[f * 3 + c]]);
+        }
+    }
+    for (const auto& p : positions) { lo = glm::min(lo, p); hi = glm::max(hi, p); }
+    double h = edgeSum / (numFaces * 3);
+    t = timeScale * h * h;
+    double diag2 = std::max(glm::dot(hi - lo, hi - lo), 1e-300);
+
+    SparseMatrix heat = L;
+    SparseMatrix poisson = L;
+    for (int v = 0; v < numVerts; ++v) {
+        for (int p = L.colPtr[v]; p < L.colPtr[v + 1]; ++p) heat.values[p] *= t;
+        heat.values[diagonal[v]] += mass[v];
+        poisson.values[diagonal[v]] += POISSON_SHIFT / diag2 * mass[v];
+    }
+
+    // ---- both systems share one pattern: order and analyze once,
+    // then factor them side by side
+    std::vector<int> order;
+    nestedDissectionOrder(L, floatPositions, order);
+    if (!heatSolver.analyze(L, order)) return false;
+    poissonSolver = heatSolver;
+
+    std::future<bool> poissonDone = std::async(std::launch::async, [&]() { return poissonSolver.factor(poisson); });
+    bool heatOk = heatSolver.factor(heat);
+    bool poissonOk = poissonDone.get();
+    if (!heatOk || !poissonOk) return false;
+
+    ready = true;
+    return true;
+}
+
+bool HeatGeodesic::distance(const std::vector<int>& sources, std::vector<float>& out) const
+{
+    if (!ready) {
+        std::cout << "HeatGeodesic: build() has not succeeded" << std::endl;
+        return false;
+    }
+
+    const int numVerts = static_cast<int>(positions.size());
+    const size_t numFaces = indices.size() / 3;
+
+    // 1. heat flow: (M + t L) u = delta
+    std::vector<double> u(numVerts, 0.0);
+    bool any = false;
+    for (int s : sources) {
+        if (s < 0 || s >= numVerts) continue;
+        u[s] = 1.0;
+        any = true;
+    }
+    if (!any) {
+        std::cout << "HeatGeodesic: no valid source vertex" << std::endl;
+        return false;
+    }
+    heatSolver.solve(u);
+
+    // 2. normalized negative gradient per face
+    std::vector<glm::dvec3> X(numFaces);
+    parallelFor(numFaces, 4096, [&](size_t begin, size_t end) {
+        for (size_t f = begin; f < end; ++f) {
+            const glm::dvec3& p0 = positions[indices[f * 3]];
+            const glm::dvec3& p1 = positions[indices[f * 3 + 1]];
+            const glm::dvec3& p2 = positions[indices[f * 3 + 2]];
+            glm::dvec3 n = glm::cross(p1 - p0, p2 - p0);
+            // grad u * 2A = sum u_i (N x e_i), e_i the edge opposite i
+            glm::dvec3 g = glm::cross(n, p2 - p1) * u[indices[f * 3]] +
+                           glm::cross(n, p0 - p2) * u[indices[f * 3 + 1]] +
+                           glm::cross(n, p1 - p0) * u[indices[f * 3 + 2]];
+            double len = glm::length(g);
+            X[f] = len > 0.0 ? g * (-1.0 / len) : glm::dvec3(0.0);
+        }
+    });
+
+    // 3. integrated divergence per vertex, gathered from its corners
+    std::vector<double> phi(numVerts, 0.0);
+    parallelFor(numVerts, 4096, [&](size_t begin, size_t end) {
+        for (size_t v = begin; v < end; ++v) {
+            double div = 0.0;
+            for (int k = vertexFaceOffsets[v]; k < vertexFaceOffsets[v + 1]; ++k) {
+                size_t f = vertexCorners[k] / 3;
+                int c = vertexCorners[k] % 3;
+                int c1 = (c + 1) % 3, c2 = (c + 2) % 3;
+                glm::dvec3 e1 = positions[indices[f * 3 + c1]] - positions[v];
+                glm::dvec3 e2 = positions[indices[f * 3 + c2]] - positions[v];
+                div += cotangents[f * 3 + c2] * glm::dot(e1, X[f]) +
+                       cotangents[f * 3 + c1] * glm::dot(e2, X[f]);
+            }
+            // L is positive semi-definite, i.e. minus the usual Laplacian
+            phi[v] = -0.5 * div;
+        }
+    });
+
+    // 4. L phi = -div, then shift so the closest vertex is at distance 0
+    poissonSolver.solve(phi);
+    double lowest = *std::min_element(phi.begin(), phi.end());
+
+    out.resize(numVerts);
+    for (int v = 0; v < numVerts; ++v) out[v] = static_cast<float>(phi[v] - lowest);
+    return true;
+}
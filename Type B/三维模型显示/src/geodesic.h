@@ -0,0 +1,48 @@
+#ifndef GEODESIC_H
+#define GEODESIC_H
+#include <glm/glm.hpp>
+#include <vector>
+#include "hedge.h"
+#include "sparse_cholesky.h"
+
+// Geodesic distances with the heat method (Crane et al. 2013):
+// diffuse heat from the sources for a short time, normalize its gradient,
+// then recover the distance with a Poisson solve.
+//
+// build() assembles the cotan Laplacian and lumped mass matrix and factors
+// both systems once; every distance() query after that is just two
+// forward/back substitutions plus two passes over the faces.
+class HeatGeodesic
+{
+public:
+    // timeScale multiplies the default time step (mean edge length squared);
+    // larger values give smoother but less accurate distances
+    bool build(const Hedge& mesh, double timeScale = 1.0);
+
+    // Distance from the nearest source vertex, for every vertex
+    bool distance(const std::vector<int>& sources, std::vector<float>& out) const;
+    bool distance(int source, std::vector<float>& out) const
+    {
+        return distance(std::vector<int>{source}, out);
+    }
+
+    bool isReady() const { return ready; }
+    size_t vertexCount() const { return positions.size(); }
+    double timeStep() const { return t; }
+    // Nonzeros in each Cholesky factor
+    size_t factorSize() const { return heatSolver.nonZeros(); }
+
+private:
+    std::vector<glm::dvec3> positions;
+    std::vector<unsigned int> indices;
+    std::vector<double> cotangents;     // per face corner: cot of its angle
+    std::vector<int> vertexFaceOffsets; // corners around each vertex, CSR
+    std::vector<int> vertexCorners;     // face * 3 + corner
+
+    SparseCholesky heatSolver;          // M + t L
+    SparseCholesky poissonSolver;       // L + small shift
+    double t = 0.0;
+    bool ready = false;
+};
+
+#endif
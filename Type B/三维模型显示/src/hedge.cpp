@@ -1,14 +1,15 @@
 #include "hedge.h"
-#include <fstream>
-#include <sstream>
+#include "meshio.h"
+#include "parallel.h"
+#include <algorithm>
 #include <iostream>
 #include <unordered_map>
+#include <cstdint>
+#include <cmath>
 #include <glm/glm.hpp>
 #include <vector>
 
 
-struct FaceIndex { int v0; int v1; int v2; };
-
 struct EdgeKey {
     int from;
     int to;
@@ -20,8 +21,14 @@ struct EdgeKey {
 
 struct EdgeKeyHash {
     std::size_t operator()(const EdgeKey& k) const {
-        // simple hash combine
-        return std::hash<int>()(k.from) ^ (std::hash<int>()(k.to) << 1);
+        // pack both indices into one word and mix it; the old xor/shift
+        // combine collided heavily on the near-sequential indices of scans
+        uint64_t h = (static_cast<uint64_t>(static_cast<uint32_t>(k.from)) << 32) |
+                     static_cast<uint32_t>(k.to);
+        h ^= h >> 33;
+        h *= 0xFF51AFD7ED558CCDull;
+        h ^= h >> 33;
+        return static_cast<std::size_t>(h);
     }
 };
 
@@ -44,65 +51,61 @@ void Hedge::clear()
 bool Hedge::loadFromOBJ(const std::string& path)
 {
     clear();
-    std::ifstream in(path);
-    std::string line;
-
     std::vector<glm::vec3> tmpPositions;
-    std::vector<FaceIndex> tmpFaces;
-
-    while (std::getline(in, line))
-    {
-        std::stringstream ss(line);
-        std::string tag;
-        ss >> tag;
-
-        if (tag == "v")
-        {
-            float x,y,z;
-            ss >> x >> y >> z;
-            tmpPositions.push_back(glm::vec3(x,y,z));
-        }
-        else if (tag == "f")
-        {
-            std::string vStr;
-            int idx[3];
-            int count = 0;
+    std::vector<unsigned int> tmpIndices;
+    if (!readOBJ(path, tmpPositions, tmpIndices)) return false;
+    return buildFromTriangles(tmpPositions, tmpIndices);
+}
 
-            // read up to 3 vertices for this face
-            while (count < 3 && (ss >> vStr)) {
-                // handle formats like "3/2/1" or "3//1"
-                size_t slashPos = vStr.find('/');
-                if (slashPos != std::string::npos) {
-                    vStr = vStr.substr(0, slashPos); // keep only the vertex index before '/'
-                }
+bool Hedge::loadFromPLY(const std::string& path)
+{
+    clear();
+    std::vector<glm::vec3> tmpPositions;
+    std::vector<unsigned int> tmpIndices;
+    if (!readPLY(path, tmpPositions, tmpIndices)) return false;
+    return buildFromTriangles(tmpPositions, tmpIndices);
+}
 
-                int vi = std::stoi(vStr) - 1; // convert 1-based OBJ index to 0-based
+bool Hedge::loadFromSTL(const std::string& path)
+{
+    clear();
+    std::vector<glm::vec3> tmpPositions;
+    std::vector<unsigned int> tmpIndices;
+    if (!readSTL(path, tmpPositions, tmpIndices)) return false;
+    return buildFromTriangles(tmpPositions, tmpIndices);
+}
 
-                idx[count] = vi;
-                count++;
-            }
+bool Hedge::loadFromFile(const std::string& path)
+{
+    clear();
+    std::vector<glm::vec3> tmpPositions;
+    std::vector<unsigned int> tmpIndices;
+    if (!readMesh(path, tmpPositions, tmpIndices)) return false;
+    return buildFromTriangles(tmpPositions, tmpIndices);
+}
 
-            if (count == 3) {
-                FaceIndex f;
-                f.v0 = idx[0];
-                f.v1 = idx[1];
-                f.v2 = idx[2];
-                tmpFaces.push_back(f);
-            }
-        }
+bool Hedge::saveToFile(const std::string& path) const
+{
+    std::vector<glm::vec3> outPositions;
+    std::vector<unsigned int> outIndices;
+    buildVertexArray(outPositions);
+    buildFaceIndexArray(outIndices);
+    return writeMesh(path, outPositions, outIndices);
+}
 
-    }
+bool Hedge::buildFromTriangles(const std::vector<glm::vec3>& tmpPositions,
+                               const std::vector<unsigned int>& tmpIndices)
+{
+    clear();
 
-    in.close();
     // debug check: make sure all face indices are valid
-    for (const auto& f : tmpFaces) {
-        if (f.v0 < 0 || f.v1 < 0 || f.v2 < 0 ||
-            f.v0 >= (int)tmpPositions.size() ||
-            f.v1 >= (int)tmpPositions.size() ||
-            f.v2 >= (int)tmpPositions.size()) 
+    for (size_t i = 0; i + 2 < tmpIndices.size(); i += 3) {
+        if (tmpIndices[i]     >= tmpPositions.size() ||
+            tmpIndices[i + 1] >= tmpPositions.size() ||
+            tmpIndices[i + 2] >= tmpPositions.size())
         {
             std::cout << "Invalid face indices: "
-                    << f.v0 << ", " << f.v1 << ", " << f.v2
+                    << (int)tmpIndices[i] << ", " << (int)tmpIndices[i + 1] << ", " << (int)tmpIndices[i + 2]
                     << " with vertex count = " << tmpPositions.size()
                     << std::endl;
             return false; // or exit(1) while debugging
@@ -121,17 +124,19 @@ bool Hedge::loadFromOBJ(const std::string& path)
 
     // build faces and half edges
     std::unordered_map<EdgeKey, HalfEdge*, EdgeKeyHash> edgeMap;
-    edgeMap.reserve(tmpFaces.size() * 3);
-    faces.reserve(tmpFaces.size());
-    edges.reserve(tmpFaces.size()*3);
+    size_t faceCount = tmpIndices.size() / 3;
+    edgeMap.reserve(faceCount * 3);
+    faces.reserve(faceCount);
+    edges.reserve(faceCount * 3);
 
-    for (const auto& fIdx : tmpFaces) {
+    for (size_t fi = 0; fi < faceCount; ++fi) {
         HEFace* face = new HEFace();
+        face->index = static_cast<int>(fi);
         faces.push_back(face);
 
-        int a = fIdx.v0;
-        int b = fIdx.v1;
-        int c = fIdx.v2;
+        int a = static_cast<int>(tmpIndices[fi * 3]);
+        int b = static_cast<int>(tmpIndices[fi * 3 + 1]);
+        int c = static_cast<int>(tmpIndices[fi * 3 + 2]);
 
         // Create 3 half-edges: a->b, b->c, c->a
         HalfEdge* e0 = new HalfEdge();
@@ -224,20 +229,93 @@ void Hedge::buildFaceIndexArray(std::vector<unsigned int>& outIndices) const
 void Hedge::buildEdgeIndexArray(std::vector<unsigned int>& outIndices) const
 {
     outIndices.clear();
-    outIndices.reserve(edges.size() * 2);
 
+    // Each undirected edge once, as (lower, higher) vertex index, sorted
+    // by that pair, so the array only depends on the mesh and not on where
+    // its edges were allocated. Keying on the pair also merges the extra
+    // halves of non-manifold and badly oriented edges.
+    std::vector<uint64_t> keys;
+    keys.reserve(edges.size());
     for (auto e : edges) {
         if (!e) continue;
+        uint64_t a = static_cast<unsigned int>(std::min(e->fromIndex, e->toIndex));
+        uint64_t b = static_cast<unsigned int>(std::max(e->fromIndex, e->toIndex));
+        keys.push_back((a << 32) | b);
+    }
+    std::sort(keys.begin(), keys.end());
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+
+    outIndices.reserve(keys.size() * 2);
+    for (uint64_t key : keys) {
+        outIndices.push_back(static_cast<unsigned int>(key >> 32));
+        outIndices.push_back(static_cast<unsigned int>(key));
+    }
+}
+
+static glm::vec3 faceNormal(const HEFace* face)
+{
+    const HalfEdge* e0 = face->edge;
+    const glm::vec3& a = e0->prev->vert->position;
+    const glm::vec3& b = e0->vert->position;
+    const glm::vec3& c = e0->next->vert->position;
+    glm::vec3 n = glm::cross(b - a, c - a);
+    float len = glm::length(n);
+    return len > 0.0f ? n / len : n;
+}
+
+void Hedge::buildFaceGraph(FaceGraph& out, FaceWeight weight) const
+{
+    size_t numFaces = faces.size();
+    out.offsets.resize(numFaces + 1);
 
-        // Avoid adding each undirected edge twice.
-        // Only emit if:
-        //  - either no twin, or
-        //  - this pointer is "less" than twin (arbitrary but consistent)
-        if (e->twin && e > e->twin) {
-            continue;
+    // pass 1: count neighbors per face (twins whose face is known)
+    parallelFor(numFaces, 4096, [&](size_t begin, size_t end) {
+        for (size_t f = begin; f < end; ++f) {
+            int count = 0;
+            const HEFace* face = faces[f];
+            if (face && face->edge) {
+                const HalfEdge* e = face->edge;
+                do {
+                    if (e->twin && e->twin->face) count++;
+                    e = e->next;
+                } while (e && e != face->edge);
+            }
+            out.offsets[f + 1] = count;
         }
+    });
 
-        outIndices.push_back(static_cast<unsigned int>(e->fromIndex));
-        outIndices.push_back(static_cast<unsigned int>(e->toIndex));
+    out.offsets[0] = 0;
+    for (size_t f = 0; f < numFaces; ++f) {
+        out.offsets[f + 1] += out.offsets[f];
     }
+
+    size_t numArcs = static_cast<size_t>(out.offsets[numFaces]);
+    out.neighbors.resize(numArcs);
+    if (weight == FaceWeight::None) out.weights.clear();
+    else                            out.weights.resize(numArcs);
+
+    // pass 2: fill each row in place
+    parallelFor(numFaces, 4096, [&](size_t begin, size_t end) {
+        for (size_t f = begin; f < end; ++f) {
+            const HEFace* face = faces[f];
+            if (!face || !face->edge) continue;
+
+            int slot = out.offsets[f];
+            glm::vec3 n0 = (weight == FaceWeight::DihedralAngle) ? faceNormal(face) : glm::vec3(0.0f);
+            const HalfEdge* e = face->edge;
+            do {
+                if (e->twin && e->twin->face) {
+                    out.neighbors[slot] = e->twin->face->index;
+                    if (weight == FaceWeight::EdgeLength) {
+                        out.weights[slot] = glm::length(e->vert->position - e->twin->vert->position);
+                    } else if (weight == FaceWeight::DihedralAngle) {
+                        float c = glm::dot(n0, faceNormal(e->twin->face));
+                        out.weights[slot] = std::acos(glm::clamp(c, -1.0f, 1.0f));
+                    }
+                    slot++;
+                }
+                e = e->next;
+            } while (e && e != face->edge);
+        }
+    });
 }
@@ -18,6 +18,7 @@ struct HEVertex {
 struct HEFace
 {
     HalfEdge* edge = nullptr;  // one halfe edge on this face
+    int index = -1;            // index in the face array
 };
 
 struct HalfEdge
@@ -33,6 +34,63 @@ struct HalfEdge
     int toIndex   = -1;   // ending vertex index (0-based)
 };
 
+// Face dual graph in compressed sparse row form.
+// Neighbors of face f are neighbors[offsets[f] .. offsets[f+1]).
+struct FaceGraph
+{
+    std::vector<int>   offsets;    // size = numFaces + 1
+    std::vector<int>   neighbors;  // adjacent face indices
+    std::vector<float> weights;    // same size as neighbors, empty if unweighted
+};
+
+// Optional weight stored for every dual edge
+enum class FaceWeight
+{
+    None,
+    EdgeLength,     // length of the shared edge
+    DihedralAngle   // angle between the face normals, in radians
+};
+
+// Kinds of problems reported by Hedge::validate
+enum class TopologyIssueKind
+{
+    DanglingPointer,         // next/prev/twin/vert/face not owned by this mesh
+    BrokenCycle,             // next/prev do not form a closed loop on one face
+    TwinAsymmetric,          // e->twin->twin != e
+    TwinMismatch,            // twin does not run between the same two vertices
+    WrongVertex,             // vert/fromIndex/toIndex disagree
+    BadVertexEdge,           // a vertex's edge does not start at that vertex
+    InconsistentOrientation, // two faces traverse a shared edge the same way
+    NonManifoldEdge,         // more than two faces on one edge
+    NonManifoldVertex,       // faces around a vertex form more than one fan
+    Count
+};
+
+struct TopologyIssue
+{
+    TopologyIssueKind kind;
+    int element;   // index into edges, or into vertices for the vertex kinds
+};
+
+struct TopologyReport
+{
+    size_t counts[static_cast<int>(TopologyIssueKind::Count)] = {};
+    std::vector<TopologyIssue> issues;   // details, capped by validate()
+    size_t boundaryEdges = 0;            // half-edges without a twin (not an error)
+
+    size_t count(TopologyIssueKind k) const { return counts[static_cast<int>(k)]; }
+    bool ok() const;
+};
+
+// What Hedge::repair changed
+struct RepairStats
+{
+    size_t facesFlipped = 0;
+    size_t verticesSplit = 0;
+};
+
+const char* topologyIssueName(TopologyIssueKind kind);
+
 class Hedge
 {   
 public:
@@ -49,6 +107,32 @@ public:
     // Load from a simple OBJ file (only v and f, triangles)
     bool loadFromOBJ(const std::string& path);
 
+    // Load from a binary PLY file (little or big endian)
+    bool loadFromPLY(const std::string& path);
+
+    // Load from a binary STL file, welding identical corners
+    bool loadFromSTL(const std::string& path);
+
+    // Load by file extension (.obj / .ply / .stl)
+    bool loadFromFile(const std::string& path);
+
+    // Check all half-edge invariants in parallel. At most maxIssues
+    // detailed issues are stored; the counts are always complete.
+    // Returns report.ok().
+    bool validate(TopologyReport& report, size_t maxIssues = 1000) const;
+
+    // Reorient faces consistently (BFS over the dual graph, per connected
+    // component) and split non-manifold vertices, then rebuild.
+    RepairStats repair();
+
+    // Save as OBJ or binary PLY (by file extension)
+    bool saveToFile(const std::string& path) const;
+
+    // Build the half-edge structure from an indexed triangle list
+    // (3 indices per face). All loaders end up here.
+    bool buildFromTriangles(const std::vector<glm::vec3>& positions,
+                            const std::vector<unsigned int>& indices);
+
     // Build arrays for OpenGL:
 
     // Positions for VBO: size = numVertices
@@ -59,6 +143,10 @@ public:
 
     // Edge indices (for wireframe): 2 indices per edge (each edge only once)
     void buildEdgeIndexArray(std::vector<unsigned int>& outIndices) const;
+
+    // Face-to-face adjacency across twin edges. Existing capacity in out
+    // is reused, so rebuilding into the same FaceGraph does not allocate.
+    void buildFaceGraph(FaceGraph& out, FaceWeight weight = FaceWeight::None) const;
 };
 
 
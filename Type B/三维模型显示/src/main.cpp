@@ -7,9 +7,21 @@
 #include <glm/gtc/type_ptr.hpp>
 #include <iostream>
 #include <vector>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <future>
+#include <chrono>
+#include <mutex>
 
 #include "shader.h"
 #include "hedge.h"
+#include "meshio.h"
+#include "meshops.h"
+#include "file_watcher.h"
+#include "skinning.h"
+#include "geodesic.h"
+#include "scene.h"
 
 using std::cerr;
 using std::endl;
@@ -18,6 +30,7 @@ using std::endl;
 void keyCallback(GLFWwindow* window, int key, int scancode, int action, int mode);
 void mouseButtonCallback(GLFWwindow* window, int button, int action, int mods);
 void cursorPosCallback(GLFWwindow* window, double xpos, double ypos);
+void scrollCallback(GLFWwindow* window, double xoffset, double yoffset);
 
 // =================Window Settings=====================
 const int WIDTH = 800;
@@ -29,11 +42,189 @@ double gLastMouseX   = 0.0;
 double gLastMouseY   = 0.0;
 float  gYaw          = 0.0f;  // rotate around Y
 float  gPitch        = 0.0f;  // rotate around X
+float  gZoom         = 1.0f;  // scene view distance factor, mouse wheel
 
-// Mode control keys: 1 vertext only (default), 2 face only, 3 edges only, 4 face+edge
+// Mode control keys: 1 vertext only (default), 2 face only, 3 edges only, 4 face+edge,
+// 5 skinned instances, 6 geodesic distance (right click picks the source)
 int drawMode = 1;
+
+// Right click position waiting to be turned into a geodesic source
+bool   gPickRequested = false;
+double gPickX = 0.0;
+double gPickY = 0.0;
+// Meshes above this many faces first show a clustered preview
+const size_t PREVIEW_FACE_THRESHOLD = 200000;
+// Preview grid cells along the longest bounding box axis
+const int PREVIEW_RESOLUTION = 128;
+
+// Changed runs closer than this many elements are uploaded together
+const size_t PATCH_MERGE_GAP = 64;
+
+// Skinning demo: SKIN_GRID x SKIN_GRID copies, each with its own pose
+const int SKIN_GRID = 6;
+
+// Isolines drawn across the geodesic distance range
+const float GEODESIC_BANDS = 20.0f;
+
 // ================== Helper Functions ==================
 
+// Upload only the element ranges of newData that differ from oldData.
+// Falls back to a full upload when the size changed. Returns bytes sent.
+template <class T>
+size_t patchBuffer(GLenum target, GLuint buffer,
+                   const std::vector<T>& oldData, const std::vector<T>& newData)
+{
+  glBindBuffer(target, buffer);
+  if (oldData.size() != newData.size())
+  {
+    glBufferData(target, newData.size() * sizeof(T), newData.data(), GL_STATIC_DRAW);
+    return newData.size() * sizeof(T);
+  }
+
+  size_t sent = 0;
+  size_t i = 0;
+  const size_t n = newData.size();
+  while (i < n)
+  {
+    if (oldData[i] == newData[i]) { ++i; continue; }
+
+    // grow the run until a long enough stretch of equal elements
+    size_t begin = i;
+    size_t end = i + 1;
+    size_t same = 0;
+    for (size_t j = end; j < n && same < PATCH_MERGE_GAP; ++j)
+    {
+      if (oldData[j] == newData[j]) same++;
+      else { same = 0; end = j + 1; }
+    }
+
+    glBufferSubData(target, begin * sizeof(T), (end - begin) * sizeof(T), newData.data() + begin);
+    sent += (end - begin) * sizeof(T);
+    i = end;
+  }
+  return sent;
+}
+
+
+// (Re)fill the vertex buffer and both index buffers
+void uploadMesh(GLuint VAO, GLuint VBO, GLuint EBOFaces, GLuint EBOEdges,
+                const std::vector<glm::vec3>& positions,
+                const std::vector<unsigned int>& faceIndices,
+                const std::vector<unsigned int>& edgeIndices)
+{
+  //vao
+  glBindVertexArray(VAO);
+
+  // vbo
+  glBindBuffer(GL_ARRAY_BUFFER, VBO);
+  glBufferData(GL_ARRAY_BUFFER, positions.size() * sizeof(glm::vec3), positions.data(), GL_STATIC_DRAW);
+
+  // vertex attribute 0 = vec3 position
+  glEnableVertexAttribArray(0);
+  glVertexAttribPointer(
+    0, // layout(location = 0)
+    3, // vec3
+    GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (void*)0);  
+
+  // ebo
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBOFaces);
+  glBufferData(GL_ELEMENT_ARRAY_BUFFER, faceIndices.size() * sizeof(unsigned int), faceIndices.data(), GL_STATIC_DRAW);  
+
+  glBindVertexArray(0);
+
+  glBindVertexArray(VAO);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBOEdges);
+  glBufferData(GL_ELEMENT_ARRAY_BUFFER, edgeIndices.size() * sizeof(unsigned int), edgeIndices.data(), GL_STATIC_DRAW);
+  glBindVertexArray(0);
+}
+
+
+// True when a world space box lies entirely outside one clip plane
+bool boxOffScreen(const glm::mat4& viewProjection, const glm::vec3& lo, const glm::vec3& hi)
+{
+  int outside[6] = {0, 0, 0, 0, 0, 0};
+  for (int corner = 0; corner < 8; ++corner)
+  {
+    glm::vec4 c = viewProjection * glm::vec4((corner & 1) ? hi.x : lo.x,
+                                             (corner & 2) ? hi.y : lo.y,
+                                             (corner & 4) ? hi.z : lo.z, 1.0f);
+    for (int axis = 0; axis < 3; ++axis)
+    {
+      if (c[axis] < -c.w) outside[2 * axis]++;
+      if (c[axis] > c.w) outside[2 * axis + 1]++;
+    }
+  }
+  for (int p = 0; p < 6; ++p)
+    if (outside[p] == 8) return true;
+  return false;
+}
+
+
+// Rig the mesh for the skinning demo: two bones blended along the longest
+// bounding box axis, plus one morph target that inflates the middle band.
+// Returns the bone pivot and axis used to animate the twist.
+bool createSkinDemo(SkinnedMesh& skinned,
+                    const std::vector<glm::vec3>& positions,
+                    const std::vector<unsigned int>& faceIndices,
+                    glm::vec3& pivot, glm::vec3& axis)
+{
+  if (positions.empty()) return false;
+
+  glm::vec3 lo = positions[0], hi = positions[0];
+  for (const auto& p : positions) { lo = glm::min(lo, p); hi = glm::max(hi, p); }
+  glm::vec3 extent = hi - lo;
+  int a = 0;
+  if (extent.y > extent[a]) a = 1;
+  if (extent.z > extent[a]) a = 2;
+  axis = glm::vec3(0.0f);
+  axis[a] = 1.0f;
+  pivot = (lo + hi) * 0.5f;
+  float len = std::max(extent[a], 1e-6f);
+
+  std::vector<glm::vec3> normals;
+  computeVertexNormals(positions, faceIndices, normals);
+
+  SkinWeights skin;
+  skin.boneIds.assign(positions.size(), glm::ivec4(0, 1, -1, -1));
+  skin.weights.resize(positions.size());
+  MorphTarget inflate;
+  for (size_t i = 0; i < positions.size(); ++i)
+  {
+    // 0 at the low end, 1 at the high end, smooth in the middle third
+    float t = (positions[i][a] - lo[a]) / len;
+    float w = glm::clamp((t - 1.0f / 3.0f) * 3.0f, 0.0f, 1.0f);
+    w = w * w * (3.0f - 2.0f * w);
+    skin.weights[i] = glm::vec4(1.0f - w, w, 0.0f, 0.0f);
+
+    float band = 1.0f - std::abs(t - 0.5f) * 4.0f;
+    if (band > 0.0f)
+    {
+      inflate.vertices.push_back(static_cast<unsigned int>(i));
+      inflate.deltas.push_back(normals[i] * (0.08f * len * band));
+    }
+  }
+
+  return skinned.create(positions, faceIndices, skin, 2, {inflate});
+}
+
+
+// Vertex whose direction from the ray origin is closest to the ray
+int pickVertex(const std::vector<glm::vec3>& positions, glm::vec3 origin, glm::vec3 dir)
+{
+  int best = -1;
+  float bestScore = std::numeric_limits<float>::max();
+  for (size_t i = 0; i < positions.size(); ++i)
+  {
+    glm::vec3 v = positions[i] - origin;
+    float t = glm::dot(v, dir);
+    if (t <= 0.0f) continue;
+    float score = (glm::dot(v, v) - t * t) / (t * t);   // tan^2 of the angle off the ray
+    if (score < bestScore) { bestScore = score; best = static_cast<int>(i); }
+  }
+  return best;
+}
+
+
 GLFWwindow* initialize() {
   // Init GLFW
   int glfwInitRes = glfwInit();
@@ -67,6 +258,7 @@ GLFWwindow* initialize() {
   glfwSetKeyCallback(window, keyCallback);
   glfwSetMouseButtonCallback(window, mouseButtonCallback);
   glfwSetCursorPosCallback(window, cursorPosCallback);
+  glfwSetScrollCallback(window, scrollCallback);
 
   // Load OpenGL function pointers with GLAD
   int gladInitRes = gladLoadGL();
@@ -92,16 +284,89 @@ GLFWwindow* initialize() {
   return window;
 }
 
+// Viewer loop for .scene files: instanced meshes, culled every frame
+int runScene(GLFWwindow* window, const std::string& scenePath)
+{
+  Scene scene;
+  if (!scene.load(scenePath) || !scene.upload())
+  {
+    std::cout << "Failed to load scene: " << scenePath << std::endl;
+    glfwDestroyWindow(window);
+    glfwTerminate();
+    return 0;
+  }
+
+  Shader sceneShader("resources/shaders/scene.vert", "resources/shaders/scene.frag");
+  double lastTitle = glfwGetTime();
+  int frames = 0;
+
+  while (!glfwWindowShouldClose(window)) {
+    glfwPollEvents();
+
+    glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    // orbit around the scene center, framing its bounding sphere
+    float distance = scene.radius() * 2.5f * gZoom;
+    glm::mat4 view(1);
+    view = glm::translate(view, glm::vec3(0.0f, 0.0f, -distance));
+    view = glm::rotate(view, glm::radians(gPitch), glm::vec3(1.0f, 0.0f, 0.0f));
+    view = glm::rotate(view, glm::radians(gYaw), glm::vec3(0.0f, 1.0f, 0.0f));
+    view = glm::translate(view, -scene.center());
+    float nearPlane = std::max(distance - scene.radius(), distance * 0.001f);
+    glm::mat4 projection = glm::perspective(glm::radians(45.0f), (GLfloat)WIDTH / (GLfloat)HEIGHT,
+                                            nearPlane, distance + scene.radius());
+
+    scene.cull(projection * view);
+
+    sceneShader.Use();
+    glUniformMatrix4fv(glGetUniformLocation(sceneShader.Program, "view"), 1, GL_FALSE, glm::value_ptr(view));
+    glUniformMatrix4fv(glGetUniformLocation(sceneShader.Program, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
+    glUniform3f(glGetUniformLocation(sceneShader.Program, "uColor"), 0.5f, 0.2f, 0.8f);
+    scene.draw();
+
+    glfwSwapBuffers(window);
+
+    // frame rate and culling result in the title twice a second
+    frames++;
+    double now = glfwGetTime();
+    if (now - lastTitle > 0.5)
+    {
+      std::string title = "Object Loader - " + std::to_string(scene.visibleCount()) + "/" +
+                          std::to_string(scene.instanceCount()) + " instances, " +
+                          std::to_string(static_cast<int>(frames / (now - lastTitle))) + " fps";
+      glfwSetWindowTitle(window, title.c_str());
+      lastTitle = now;
+      frames = 0;
+    }
+  }
+
+  scene.destroy();
+  glfwDestroyWindow(window);
+  glfwTerminate();
+  return 0;
+}
+
 // The MAIN function, from here we start the application and run the game loop
-int main() {
+int main(int argc, char** argv) {
   GLFWwindow* window = initialize();
   if (!window) {
     return 0;
   }
 
-  std::string objPath = "resources/obj/eight.uniform.obj";
-  Hedge mesh;
-  if (!mesh.loadFromOBJ(objPath))
+  // a .scene file lists many mesh instances
+  if (argc > 1)
+  {
+    std::string arg = argv[1];
+    if (arg.size() > 6 && arg.compare(arg.size() - 6, 6, ".scene") == 0)
+      return runScene(window, arg);
+  }
+
+  // .obj, binary .ply or binary .stl
+  std::string objPath = (argc > 1) ? argv[1] : "resources/obj/eight.uniform.obj";
+  std::vector<glm::vec3> rawPositions;
+  std::vector<unsigned int> rawIndices;
+  if (!readMesh(objPath, rawPositions, rawIndices))
   {
     std::cout << "Failed to load object: " << objPath << std::endl;
   }
@@ -111,9 +376,69 @@ int main() {
   std::vector<unsigned int> faceIndices;
   std::vector<unsigned int> edgeIndices;
 
-  mesh.buildVertexArray(positions);
-  mesh.buildFaceIndexArray(faceIndices);
-  mesh.buildEdgeIndexArray(edgeIndices);
+  // Full resolution arrays, filled by the worker for big scans
+  std::vector<glm::vec3> fullPositions;
+  std::vector<unsigned int> fullFaceIndices;
+  std::vector<unsigned int> fullEdgeIndices;
+  std::future<bool> fullMesh;
+  bool waitingForFull = false;
+
+  auto buildArrays = [](const std::vector<glm::vec3>& srcPositions,
+                        const std::vector<unsigned int>& srcIndices,
+                        std::vector<glm::vec3>& outPositions,
+                        std::vector<unsigned int>& outFaces,
+                        std::vector<unsigned int>& outEdges) {
+    Hedge mesh;
+    if (!mesh.buildFromTriangles(srcPositions, srcIndices)) return false;
+    mesh.buildVertexArray(outPositions);
+    mesh.buildFaceIndexArray(outFaces);
+    mesh.buildEdgeIndexArray(outEdges);
+    return true;
+  };
+
+  if (rawIndices.size() / 3 > PREVIEW_FACE_THRESHOLD)
+  {
+    // big scan: show a clustered preview now, build the real mesh on a worker
+    std::vector<glm::vec3> previewPositions;
+    std::vector<unsigned int> previewIndices;
+    clusterDecimate(rawPositions, rawIndices, PREVIEW_RESOLUTION, previewPositions, previewIndices);
+    buildArrays(previewPositions, previewIndices, positions, faceIndices, edgeIndices);
+
+    fullMesh = std::async(std::launch::async, [&]() {
+      return buildArrays(rawPositions, rawIndices, fullPositions, fullFaceIndices, fullEdgeIndices);
+    });
+    waitingForFull = true;
+  }
+  else
+  {
+    buildArrays(rawPositions, rawIndices, positions, faceIndices, edgeIndices);
+  }
+
+  // hot reload: re-read the asset on a background thread when it changes
+  std::mutex reloadMutex;
+  bool reloadReady = false;
+  std::vector<glm::vec3> reloadPositions;
+  std::vector<unsigned int> reloadFaceIndices;
+  std::vector<unsigned int> reloadEdgeIndices;
+
+  FileWatcher watcher;
+  watcher.start(objPath, [&]() {
+    std::vector<glm::vec3> newRaw;
+    std::vector<unsigned int> newRawIndices;
+    std::vector<glm::vec3> newPositions;
+    std::vector<unsigned int> newFaces, newEdges;
+    if (!readMesh(objPath, newRaw, newRawIndices) ||
+        !buildArrays(newRaw, newRawIndices, newPositions, newFaces, newEdges))
+    {
+      std::cout << "Reload failed, keeping current mesh: " << objPath << std::endl;
+      return;
+    }
+    std::lock_guard<std::mutex> lock(reloadMutex);
+    reloadPositions.swap(newPositions);
+    reloadFaceIndices.swap(newFaces);
+    reloadEdgeIndices.swap(newEdges);
+    reloadReady = true;
+  });
 
   // one VAO for position, two EBO: one for faces one for edges
   GLuint VAO, VBO, EBOFaces, EBOEdges;
@@ -121,34 +446,32 @@ int main() {
   glGenBuffers(1, &VBO);
   glGenBuffers(1, &EBOFaces);
   glGenBuffers(1, &EBOEdges);
-  
-  //vao
-  glBindVertexArray(VAO);
-
-  // vbo
-  glBindBuffer(GL_ARRAY_BUFFER, VBO);
-  glBufferData(GL_ARRAY_BUFFER, positions.size() * sizeof(glm::vec3), positions.data(), GL_STATIC_DRAW);
-
-  // vertex attribute 0 = vec3 position
-  glEnableVertexAttribArray(0);
-  glVertexAttribPointer(
-    0, // layout(location = 0)
-    3, // vec3
-    GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (void*)0);  
-
-  // ebo
-  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBOFaces);
-  glBufferData(GL_ELEMENT_ARRAY_BUFFER, faceIndices.size() * sizeof(unsigned int), faceIndices.data(), GL_STATIC_DRAW);  
-
-  glBindVertexArray(0);
-
-  glBindVertexArray(VAO);
-  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBOEdges);
-  glBufferData(GL_ELEMENT_ARRAY_BUFFER, edgeIndices.size() * sizeof(unsigned int), edgeIndices.data(), GL_STATIC_DRAW);
-  glBindVertexArray(0);
+  uploadMesh(VAO, VBO, EBOFaces, EBOEdges, positions, faceIndices, edgeIndices);
   
   // shaders
   Shader ourShader("resources/shaders/main.vert", "resources/shaders/main.frag");
+  Shader skinShader("resources/shaders/skinned.vert", "resources/shaders/skinned.frag");
+
+  // skinning demo, rigged on first use and again after the mesh changes
+  SkinnedMesh skinned;
+  bool skinnedReady = false;
+  glm::vec3 skinPivot(0.0f), skinAxis(0.0f, 1.0f, 0.0f);
+  std::vector<SkinInstance> skinInstances(SKIN_GRID * SKIN_GRID);
+  std::vector<SkinInstance> skinVisible;   // copies whose bounds are on screen
+
+  // geodesic distances: both solvers are factored on a worker the first
+  // time mode 6 is used, after that every pick is two substitutions
+  Shader geodesicShader("resources/shaders/geodesic.vert", "resources/shaders/geodesic.frag");
+  HeatGeodesic geodesic;
+  std::future<bool> geodesicBuild;
+  bool geodesicPending = false;
+  bool geodesicReady = false;
+  int meshGeneration = 0;       // bumped whenever the displayed mesh changes
+  int geodesicGeneration = -1;  // mesh the solver is being built for
+  std::vector<float> distances;
+  float maxDistance = 1.0f;
+  GLuint distanceVBO;
+  glGenBuffers(1, &distanceVBO);
 
   // Game loop
   while (!glfwWindowShouldClose(window)) {
@@ -156,6 +479,69 @@ int main() {
     // and call corresponding response functions
     glfwPollEvents();
 
+    // swap in the full resolution mesh once the worker is done
+    if (waitingForFull &&
+        fullMesh.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+    {
+      waitingForFull = false;
+      if (fullMesh.get())
+      {
+        positions.swap(fullPositions);
+        faceIndices.swap(fullFaceIndices);
+        edgeIndices.swap(fullEdgeIndices);
+        uploadMesh(VAO, VBO, EBOFaces, EBOEdges, positions, faceIndices, edgeIndices);
+        skinnedReady = false;
+        geodesicReady = false;
+        meshGeneration++;
+      }
+    }
+
+    // apply a finished reload, sending only what changed
+    {
+      std::lock_guard<std::mutex> lock(reloadMutex);
+      if (reloadReady)
+      {
+        reloadReady = false;
+        waitingForFull = false;   // the reload supersedes a pending full mesh
+
+        glBindVertexArray(VAO);
+        size_t sent = patchBuffer(GL_ARRAY_BUFFER, VBO, positions, reloadPositions);
+        sent += patchBuffer(GL_ELEMENT_ARRAY_BUFFER, EBOEdges, edgeIndices, reloadEdgeIndices);
+        sent += patchBuffer(GL_ELEMENT_ARRAY_BUFFER, EBOFaces, faceIndices, reloadFaceIndices);
+        glBindVertexArray(0);
+
+        positions.swap(reloadPositions);
+        faceIndices.swap(reloadFaceIndices);
+        edgeIndices.swap(reloadEdgeIndices);
+        skinnedReady = false;
+        geodesicReady = false;
+        meshGeneration++;
+        std::cout << "Reloaded " << objPath << ", uploaded " << sent << " bytes" << std::endl;
+      }
+    }
+
+    // factor the geodesic solvers in the background, once per mesh
+    if (drawMode == 6 && !geodesicReady && !geodesicPending)
+    {
+      geodesicPending = true;
+      geodesicGeneration = meshGeneration;
+      distances.clear();   // re-uploaded as zeros by the draw
+      maxDistance = 1.0f;
+      std::cout << "Factoring geodesic solver for " << positions.size() << " vertices..." << std::endl;
+      geodesicBuild = std::async(std::launch::async, [&geodesic, p = positions, f = faceIndices]() {
+        Hedge mesh;
+        return mesh.buildFromTriangles(p, f) && geodesic.build(mesh);
+      });
+    }
+    if (geodesicPending &&
+        geodesicBuild.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+    {
+      geodesicPending = false;
+      geodesicReady = geodesicBuild.get() && geodesicGeneration == meshGeneration;
+      if (geodesicReady)
+        std::cout << "Geodesic solver ready, right click to pick a source" << std::endl;
+    }
+
     // Render
     // Clear the colorbuffer
     glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
@@ -182,7 +568,34 @@ int main() {
     glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
     glUniformMatrix4fv(viewLoc,  1, GL_FALSE, glm::value_ptr(view));
     glUniformMatrix4fv(projLoc,  1, GL_FALSE, glm::value_ptr(projection));
-    
+
+    // turn a right click into a distance field
+    if (gPickRequested)
+    {
+      gPickRequested = false;
+      if (drawMode == 6 && geodesicReady)
+      {
+        glm::mat4 invVP = glm::inverse(projection * view * model);
+        float nx = static_cast<float>(2.0 * gPickX / WIDTH - 1.0);
+        float ny = static_cast<float>(1.0 - 2.0 * gPickY / HEIGHT);
+        glm::vec4 nearPt = invVP * glm::vec4(nx, ny, -1.0f, 1.0f);
+        glm::vec4 farPt = invVP * glm::vec4(nx, ny, 1.0f, 1.0f);
+        glm::vec3 origin = glm::vec3(nearPt) / nearPt.w;
+        glm::vec3 dir = glm::normalize(glm::vec3(farPt) / farPt.w - origin);
+
+        int source = pickVertex(positions, origin, dir);
+        auto start = std::chrono::steady_clock::now();
+        if (source >= 0 && geodesic.distance(source, distances))
+        {
+          double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+          maxDistance = *std::max_element(distances.begin(), distances.end());
+          glBindBuffer(GL_ARRAY_BUFFER, distanceVBO);
+          glBufferData(GL_ARRAY_BUFFER, distances.size() * sizeof(float), distances.data(), GL_DYNAMIC_DRAW);
+          std::cout << "Geodesic from vertex " << source << ": " << ms << " ms" << std::endl;
+        }
+      }
+    }
+
     glBindVertexArray(VAO);
 
     GLint colLoc = glGetUniformLocation(ourShader.Program, "uColor");
@@ -221,12 +634,89 @@ int main() {
         glDrawElements(GL_LINES, static_cast<GLsizei>(edgeIndices.size()), GL_UNSIGNED_INT, (void*)0);
         glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
         break;
+      case 6:
+      {
+        // faces shaded by distance from the picked vertex
+        glBindBuffer(GL_ARRAY_BUFFER, distanceVBO);
+        if (distances.size() != positions.size())
+        {
+          distances.assign(positions.size(), 0.0f);
+          glBufferData(GL_ARRAY_BUFFER, distances.size() * sizeof(float), distances.data(), GL_DYNAMIC_DRAW);
+        }
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 1, GL_FLOAT, GL_FALSE, sizeof(float), (void*)0);
+
+        geodesicShader.Use();
+        glUniformMatrix4fv(glGetUniformLocation(geodesicShader.Program, "model"), 1, GL_FALSE, glm::value_ptr(model));
+        glUniformMatrix4fv(glGetUniformLocation(geodesicShader.Program, "view"), 1, GL_FALSE, glm::value_ptr(view));
+        glUniformMatrix4fv(glGetUniformLocation(geodesicShader.Program, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
+        glUniform3f(glGetUniformLocation(geodesicShader.Program, "uColor"), 0.5f, 0.2f, 0.8f);
+        glUniform1f(glGetUniformLocation(geodesicShader.Program, "uMaxDistance"), maxDistance);
+        glUniform1f(glGetUniformLocation(geodesicShader.Program, "uBands"), GEODESIC_BANDS);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBOFaces);
+        glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(faceIndices.size()), GL_UNSIGNED_INT, (void*)0);
+        glDisableVertexAttribArray(1);
+        break;
+      }
+      case 5:
+      {
+        // skinned copies, all deformed on the GPU in one instanced draw
+        glBindVertexArray(0);
+        if (!skinnedReady)
+        {
+          skinnedReady = createSkinDemo(skinned, positions, faceIndices, skinPivot, skinAxis);
+          if (!skinnedReady) break;
+        }
+
+        float time = static_cast<float>(glfwGetTime());
+        float spacing = 1.2f;
+        float scale = 2.0f / SKIN_GRID;
+        for (int i = 0; i < SKIN_GRID * SKIN_GRID; ++i)
+        {
+          float phase = time * 1.5f + i * 0.37f;
+          glm::mat4 instModel(1.0f);
+          instModel = glm::translate(instModel, glm::vec3((i % SKIN_GRID - (SKIN_GRID - 1) * 0.5f) * spacing * scale,
+                                                          (i / SKIN_GRID - (SKIN_GRID - 1) * 0.5f) * spacing * scale,
+                                                          0.0f));
+          instModel = glm::scale(instModel, glm::vec3(scale));
+          instModel = glm::translate(instModel, -skinPivot);
+
+          glm::mat4 twist = glm::translate(glm::mat4(1.0f), skinPivot) *
+                            glm::rotate(glm::mat4(1.0f), std::sin(phase) * 1.2f, skinAxis) *
+                            glm::translate(glm::mat4(1.0f), -skinPivot);
+
+          SkinInstance& inst = skinInstances[i];
+          inst.palette = {instModel, instModel * twist};
+          inst.morphWeights = {0.5f + 0.5f * std::sin(phase * 0.7f)};
+          inst.markDirty();
+        }
+
+        // skip copies whose deformed bounds are off screen
+        glm::mat4 viewProjection = projection * view;
+        skinVisible.clear();
+        for (SkinInstance& inst : skinInstances)
+        {
+          skinned.bounds(inst);
+          if (!boxOffScreen(viewProjection, inst.boundsMin, inst.boundsMax)) skinVisible.push_back(inst);
+        }
+
+        skinShader.Use();
+        glUniformMatrix4fv(glGetUniformLocation(skinShader.Program, "view"), 1, GL_FALSE, glm::value_ptr(view));
+        glUniformMatrix4fv(glGetUniformLocation(skinShader.Program, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
+        glUniform3f(glGetUniformLocation(skinShader.Program, "uColor"), 0.5f, 0.2f, 0.8f);
+        skinned.draw(skinShader.Program, skinVisible);
+        break;
+      }
     }
     glBindVertexArray(0);
     // Swap the screen buffers
     glfwSwapBuffers(window);
   }
 
+  watcher.stop();
+  skinned.destroy();
+  if (geodesicPending) geodesicBuild.wait();
+
   // Terminate GLFW, clearing any resources allocated by GLFW.
   glfwDestroyWindow(window);
   glfwTerminate();
@@ -255,6 +745,14 @@ void keyCallback(GLFWwindow* window, int key, int scancode, int action, int mode
   {
     drawMode = 4;
   }
+  if (key == GLFW_KEY_5 && action == GLFW_PRESS)
+  {
+    drawMode = 5;
+  }
+  if (key == GLFW_KEY_6 && action == GLFW_PRESS)
+  {
+    drawMode = 6;
+  }
 }
 
 void mouseButtonCallback(GLFWwindow* window, int button, int action, int mods)
@@ -270,6 +768,11 @@ void mouseButtonCallback(GLFWwindow* window, int button, int action, int mods)
       gMousePressed = false;
     }
   }
+  if (button == GLFW_MOUSE_BUTTON_RIGHT && action == GLFW_PRESS)
+  {
+    gPickRequested = true;
+    glfwGetCursorPos(window, &gPickX, &gPickY);
+  }
 }
 
 void cursorPosCallback(GLFWwindow* window, double xpos, double ypos)
@@ -289,4 +792,10 @@ void cursorPosCallback(GLFWwindow* window, double xpos, double ypos)
     // clamp pitch so you don't flip over
     if (gPitch > 89.0f)  gPitch = 89.0f;
     if (gPitch < -89.0f) gPitch = -89.0f;
-}
\ No newline at end of file
+}
+
+void scrollCallback(GLFWwindow* window, double xoffset, double yoffset)
+{
+    gZoom *= std::pow(0.9f, static_cast<float>(yoffset));
+    gZoom = glm::clamp(gZoom, 0.01f, 10.0f);
+}
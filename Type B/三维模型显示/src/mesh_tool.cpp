@@ -0,0 +1,296 @@
+// Headless mesh processing tool. Links the same mesh code as the viewer
+// but needs no window or GL context:
+//
+//   g++ -O2 -std=c++17 -pthread mesh_tool.cpp hedge.cpp topology.cpp meshio.cpp meshops.cpp
+//       geodesic.cpp sparse_cholesky.cpp sampling.cpp -o mesh_tool
+//   (link psapi on Windows)
+//
+// Usage:
+//   mesh_tool <input> [passes...] [-o output]
+//
+// Passes run in command line order:
+//   --validate          build the half-edge mesh and check its invariants
+//   --repair            reorient faces and split non-manifold vertices
+//   --weld <eps>        merge vertices closer than eps (0 = exact)
+//   --simplify <res>    vertex-clustering decimation, res cells per axis
+//   --normals           area-weighted vertex normals
+//   --reorder           Morton order vertices and triangles
+//   --geodesic <v>      heat-method distances from vertex v (factor + query time)
+//   --sample <n>        n area-weighted surface points
+//   --poisson <r>       Poisson-disk surface points at least r apart
+//
+// Options:
+//   --seed <s>          seed for the sampling passes (default 1)
+//
+// Per-phase wall time, allocation counts and peak RSS are printed to stdout
+// as one JSON object, so nightly jobs can diff them.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+#include "hedge.h"
+#include "meshio.h"
+#include "meshops.h"
+#include "geodesic.h"
+#include "sampling.h"
+
+// ================== Allocation counting ==================
+
+static std::atomic<unsigned long long> gAllocCount{0};
+static std::atomic<unsigned long long> gAllocBytes{0};
+
+void* operator new(std::size_t size)
+{
+    gAllocCount.fetch_add(1, std::memory_order_relaxed);
+    gAllocBytes.fetch_add(size, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+
+// Peak resident set size of the process so far, in KiB
+static long peakRSSKiB()
+{
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS pmc;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc)))
+        return static_cast<long>(pmc.PeakWorkingSetSize / 1024);
+    return 0;
+#else
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+    return usage.ru_maxrss / 1024;   // bytes on macOS
+#else
+    return usage.ru_maxrss;          // KiB on Linux
+#endif
+#endif
+}
+
+// ================== Phase timing ==================
+
+struct PhaseResult {
+    std::string name;
+    double ms;
+    unsigned long long allocs;
+    unsigned long long allocBytes;
+    long peakRSS;
+    std::string detail;   // extra JSON fields, already formatted
+};
+
+class PhaseTimer {
+public:
+    explicit PhaseTimer(const std::string& n)
+        : name(n),
+          start(std::chrono::steady_clock::now()),
+          allocs(gAllocCount.load()),
+          bytes(gAllocBytes.load()) {}
+
+    PhaseResult finish(const std::string& detail = "") const
+    {
+        PhaseResult r;
+        r.name = name;
+        r.ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        r.allocs = gAllocCount.load() - allocs;
+        r.allocBytes = gAllocBytes.load() - bytes;
+        r.peakRSS = peakRSSKiB();
+        r.detail = detail;
+        return r;
+    }
+
+private:
+    std::string name;
+    std::chrono::steady_clock::time_point start;
+    unsigned long long allocs;
+    unsigned long long bytes;
+};
+
+static std::string jsonEscape(const std::string& s)
+{
+    std::string out;
+    for (char c : s) {
+        if (c == '"' || c == '\\') out += '\\';
+        out += c;
+    }
+    return out;
+}
+
+static void printUsage()
+{
+    std::cerr << "usage: mesh_tool <input> [--validate] [--repair] [--weld eps] [--simplify res]\n"
+                 "                 [--normals] [--reorder] [--geodesic v] [--sample n] [--poisson r]\n"
+                 "                 [--seed s] [-o output]" << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 2) {
+        printUsage();
+        return 2;
+    }
+
+    std::string inputPath = argv[1];
+    std::string outputPath;
+    std::vector<std::string> passes;
+    std::vector<std::string> passArgs;
+    uint64_t seed = 1;
+
+    for (int i = 2; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "-o" && i + 1 < argc) {
+            outputPath = argv[++i];
+        } else if (arg == "--seed" && i + 1 < argc) {
+            seed = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--weld" || arg == "--simplify" || arg == "--geodesic" ||
+                   arg == "--sample" || arg == "--poisson") {
+            if (i + 1 >= argc) {
+                printUsage();
+                return 2;
+            }
+            passes.push_back(arg.substr(2));
+            passArgs.push_back(argv[++i]);
+        } else if (arg == "--validate" || arg == "--repair" || arg == "--normals" || arg == "--reorder") {
+            passes.push_back(arg.substr(2));
+            passArgs.push_back("");
+        } else {
+            std::cerr << "unknown option: " << arg << std::endl;
+            printUsage();
+            return 2;
+        }
+    }
+
+    std::vector<PhaseResult> results;
+    std::vector<glm::vec3> positions;
+    std::vector<unsigned int> indices;
+    bool ok = true;
+
+    {
+        PhaseTimer t("load");
+        ok = readMesh(inputPath, positions, indices);
+        results.push_back(t.finish());
+    }
+
+    for (size_t p = 0; ok && p < passes.size(); ++p) {
+        const std::string& pass = passes[p];
+        PhaseTimer t(pass);
+        std::string detail;
+
+        if (pass == "validate") {
+            Hedge mesh;
+            ok = mesh.buildFromTriangles(positions, indices);
+            TopologyReport report;
+            bool valid = ok && mesh.validate(report);
+            detail = "\"valid\":" + std::string(valid ? "true" : "false") +
+                     ",\"boundary_half_edges\":" + std::to_string(report.boundaryEdges);
+            for (int k = 0; k < static_cast<int>(TopologyIssueKind::Count); ++k) {
+                if (report.counts[k] == 0) continue;
+                detail += ",\"" + std::string(topologyIssueName(static_cast<TopologyIssueKind>(k))) +
+                          "\":" + std::to_string(report.counts[k]);
+            }
+        } else if (pass == "repair") {
+            Hedge mesh;
+            ok = mesh.buildFromTriangles(positions, indices);
+            if (ok) {
+                RepairStats stats = mesh.repair();
+                mesh.buildVertexArray(positions);
+                mesh.buildFaceIndexArray(indices);
+                detail = "\"faces_flipped\":" + std::to_string(stats.facesFlipped) +
+                         ",\"vertices_split\":" + std::to_string(stats.verticesSplit);
+            }
+        } else if (pass == "weld") {
+            size_t merged = weldVertices(positions, indices, std::strtof(passArgs[p].c_str(), nullptr));
+            detail = "\"merged\":" + std::to_string(merged);
+        } else if (pass == "simplify") {
+            std::vector<glm::vec3> outPositions;
+            std::vector<unsigned int> outIndices;
+            clusterDecimate(positions, indices, std::atoi(passArgs[p].c_str()), outPositions, outIndices);
+            positions.swap(outPositions);
+            indices.swap(outIndices);
+        } else if (pass == "normals") {
+            std::vector<glm::vec3> normals;
+            computeVertexNormals(positions, indices, normals);
+        } else if (pass == "reorder") {
+            reorderForLocality(positions, indices);
+        } else if (pass == "geodesic") {
+            Hedge mesh;
+            HeatGeodesic geodesic;
+            auto start = std::chrono::steady_clock::now();
+            ok = mesh.buildFromTriangles(positions, indices) && geodesic.build(mesh);
+            auto factored = std::chrono::steady_clock::now();
+            std::vector<float> distances;
+            ok = ok && geodesic.distance(std::atoi(passArgs[p].c_str()), distances);
+            auto queried = std::chrono::steady_clock::now();
+            if (ok) {
+                float farthest = 0.0f;
+                for (float d : distances) farthest = std::max(farthest, d);
+                char buf[256];
+                std::snprintf(buf, sizeof(buf),
+                              "\"factor_ms\":%.3f,\"query_ms\":%.3f,\"factor_nonzeros\":%zu,\"max_distance\":%g",
+                              std::chrono::duration<double, std::milli>(factored - start).count(),
+                              std::chrono::duration<double, std::milli>(queried - factored).count(),
+                              geodesic.factorSize(), farthest);
+                detail = buf;
+            }
+        } else if (pass == "sample" || pass == "poisson") {
+            Hedge mesh;
+            SurfaceSampler sampler;
+            ok = mesh.buildFromTriangles(positions, indices) && sampler.build(mesh);
+            auto start = std::chrono::steady_clock::now();
+            std::vector<glm::vec3> samples;
+            if (ok && pass == "sample") sampler.sample(std::strtoull(passArgs[p].c_str(), nullptr, 10), seed, samples);
+            if (ok && pass == "poisson") sampler.poissonDisk(std::strtof(passArgs[p].c_str(), nullptr), seed, samples);
+            double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            char buf[128];
+            std::snprintf(buf, sizeof(buf), "\"samples\":%zu,\"sample_ms\":%.3f", samples.size(), ms);
+            detail = buf;
+        }
+
+        results.push_back(t.finish(detail));
+    }
+
+    if (ok && !outputPath.empty()) {
+        PhaseTimer t("save");
+        ok = writeMesh(outputPath, positions, indices);
+        results.push_back(t.finish());
+    }
+
+    // ---- machine readable report
+    std::printf("{\"input\":\"%s\",\"ok\":%s,\"vertices\":%zu,\"faces\":%zu,\"phases\":[",
+                jsonEscape(inputPath).c_str(), ok ? "true" : "false",
+                positions.size(), indices.size() / 3);
+    for (size_t i = 0; i < results.size(); ++i) {
+        const PhaseResult& r = results[i];
+        std::printf("%s{\"name\":\"%s\",\"ms\":%.3f,\"allocs\":%llu,\"alloc_bytes\":%llu,\"peak_rss_kib\":%ld%s%s}",
+                    i ? "," : "", r.name.c_str(), r.ms, r.allocs, r.allocBytes, r.peakRSS,
+                    r.detail.empty() ? "" : ",", r.detail.c_str());
+    }
+    std::printf("],\"peak_rss_kib\":%ld}\n", peakRSSKiB());
+
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,723 @@
+#include "meshio.h"
+#include "mapped_file.h"
+#include "parallel.h"
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <unordered_map>
+#include <algorithm>
+#include <cstring>
+#include <cstdint>
+#include <cctype>
+#include <cstdio>
+#include <cerrno>
+#include <charconv>
+#ifndef _WIN32
+#include <sys/uio.h>
+#endif
+
+// ================== OBJ ==================
+
+bool readOBJ(const std::string& path,
+             std::vector<glm::vec3>& outPositions,
+             std::vector<unsigned int>& outIndices)
+{
+    outPositions.clear();
+    outIndices.clear();
+
+    std::ifstream in(path);
+    if (!in.is_open()) {
+        std::cout << "Cannot open OBJ file: " << path << std::endl;
+        return false;
+    }
+    std::string line;
+
+    while (std::getline(in, line))
+    {
+        std::stringstream ss(line);
+        std::string tag;
+        ss >> tag;
+
+        if (tag == "v")
+        {
+            float x,y,z;
+            ss >> x >> y >> z;
+            outPositions.push_back(glm::vec3(x,y,z));
+        }
+        else if (tag == "f")
+        {
+            std::string vStr;
+            int idx[3];
+            int count = 0;
+
+            // read up to 3 vertices for this face
+            while (count < 3 && (ss >> vStr)) {
+                // handle formats like "3/2/1" or "3//1"
+                size_t slashPos = vStr.find('/');
+                if (slashPos != std::string::npos) {
+                    vStr = vStr.substr(0, slashPos); // keep only the vertex index before '/'
+                }
+
+                int vi = std::stoi(vStr) - 1; // convert 1-based OBJ index to 0-based
+
+                idx[count] = vi;
+                count++;
+            }
+
+            if (count == 3) {
+                outIndices.push_back(static_cast<unsigned int>(idx[0]));
+                outIndices.push_back(static_cast<unsigned int>(idx[1]));
+                outIndices.push_back(static_cast<unsigned int>(idx[2]));
+            }
+        }
+    }
+
+    return true;
+}
+
+// ================== PLY ==================
+
+namespace {
+
+enum class PlyType { Invalid, Int8, UInt8, Int16, UInt16, Int32, UInt32, Float32, Float64 };
+
+struct PlyProperty {
+    std::string name;
+    PlyType type = PlyType::Invalid;
+    bool isList = false;
+    PlyType countType = PlyType::Invalid;  // only for lists
+};
+
+struct PlyElement {
+    std::string name;
+    size_t count = 0;
+    std::vector<PlyProperty> props;
+};
+
+PlyType plyTypeFromName(const std::string& s)
+{
+    if (s == "char"   || s == "int8")    return PlyType::Int8;
+    if (s == "uchar"  || s == "uint8")   return PlyType::UInt8;
+    if (s == "short"  || s == "int16")   return PlyType::Int16;
+    if (s == "ushort" || s == "uint16")  return PlyType::UInt16;
+    if (s == "int"    || s == "int32")   return PlyType::Int32;
+    if (s == "uint"   || s == "uint32")  return PlyType::UInt32;
+    if (s == "float"  || s == "float32") return PlyType::Float32;
+    if (s == "double" || s == "float64") return PlyType::Float64;
+    return PlyType::Invalid;
+}
+
+size_t plyTypeSize(PlyType t)
+{
+    switch (t) {
+        case PlyType::Int8:  case PlyType::UInt8:   return 1;
+        case PlyType::Int16: case PlyType::UInt16:  return 2;
+        case PlyType::Int32: case PlyType::UInt32:
+        case PlyType::Float32:                      return 4;
+        case PlyType::Float64:                      return 8;
+        default:                                    return 0;
+    }
+}
+
+// Load one value of type T at p, swapping bytes when the file endianness
+// differs from the host. Only a register-sized temporary is involved.
+template <bool Swap, class T>
+T loadAs(const unsigned char* p)
+{
+    unsigned char b[sizeof(T)];
+    if (Swap) {
+        for (size_t i = 0; i < sizeof(T); ++i) b[i] = p[sizeof(T) - 1 - i];
+    } else {
+        std::memcpy(b, p, sizeof(T));
+    }
+    T v;
+    std::memcpy(&v, b, sizeof(T));
+    return v;
+}
+
+// Read a property of type t at p and convert it to R
+template <bool Swap, class R>
+R readValue(const unsigned char* p, PlyType t)
+{
+    switch (t) {
+        case PlyType::Int8:    return static_cast<R>(loadAs<Swap, int8_t>(p));
+        case PlyType::UInt8:   return static_cast<R>(loadAs<Swap, uint8_t>(p));
+        case PlyType::Int16:   return static_cast<R>(loadAs<Swap, int16_t>(p));
+        case PlyType::UInt16:  return static_cast<R>(loadAs<Swap, uint16_t>(p));
+        case PlyType::Int32:   return static_cast<R>(loadAs<Swap, int32_t>(p));
+        case PlyType::UInt32:  return static_cast<R>(loadAs<Swap, uint32_t>(p));
+        case PlyType::Float32: return static_cast<R>(loadAs<Swap, float>(p));
+        case PlyType::Float64: return static_cast<R>(loadAs<Swap, double>(p));
+        default:               return R(0);
+    }
+}
+
+bool hostIsLittleEndian()
+{
+    const uint16_t probe = 1;
+    unsigned char first;
+    std::memcpy(&first, &probe, 1);
+    return first == 1;
+}
+
+// Size in bytes of one record of element e starting at p, or 0 on overrun
+template <bool Swap>
+size_t recordSize(const PlyElement& e, const unsigned char* p, const unsigned char* end)
+{
+    size_t size = 0;
+    for (const auto& prop : e.props) {
+        if (!prop.isList) {
+            size += plyTypeSize(prop.type);
+            continue;
+        }
+        size_t countSize = plyTypeSize(prop.countType);
+        if (p + size + countSize > end) return 0;
+        int64_t n = readValue<Swap, int64_t>(p + size, prop.countType);
+        if (n < 0) return 0;
+        size += countSize + static_cast<size_t>(n) * plyTypeSize(prop.type);
+    }
+    return (p + size <= end) ? size : 0;
+}
+
+template <bool Swap>
+bool parsePLYBody(const std::vector<PlyElement>& elements,
+                  const unsigned char* p, const unsigned char* end,
+                  std::vector<glm::vec3>& outPositions,
+                  std::vector<unsigned int>& outIndices)
+{
+    for (const auto& e : elements)
+    {
+        bool fixedSize = std::none_of(e.props.begin(), e.props.end(),
+                                      [](const PlyProperty& pr) { return pr.isList; });
+
+        if (e.name == "vertex")
+        {
+            // locate x/y/z inside the (fixed size) vertex record
+            size_t stride = 0;
+            size_t offs[3] = {0, 0, 0};
+            PlyType types[3] = {PlyType::Invalid, PlyType::Invalid, PlyType::Invalid};
+            if (!fixedSize) {
+                std::cout << "PLY: list properties on vertices are not supported" << std::endl;
+                return false;
+            }
+            for (const auto& prop : e.props) {
+                int axis = prop.name == "x" ? 0 : prop.name == "y" ? 1 : prop.name == "z" ? 2 : -1;
+                if (axis >= 0) {
+                    offs[axis] = stride;
+                    types[axis] = prop.type;
+                }
+                stride += plyTypeSize(prop.type);
+            }
+            if (types[0] == PlyType::Invalid || types[1] == PlyType::Invalid || types[2] == PlyType::Invalid) {
+                std::cout << "PLY: vertex element has no x/y/z" << std::endl;
+                return false;
+            }
+            if (static_cast<size_t>(end - p) < stride * e.count) {
+                std::cout << "PLY: file truncated in vertex block" << std::endl;
+                return false;
+            }
+
+            outPositions.resize(e.count);
+            bool packedFloats = !Swap && stride == 12 &&
+                                types[0] == PlyType::Float32 && types[1] == PlyType::Float32 &&
+                                types[2] == PlyType::Float32 &&
+                                offs[0] == 0 && offs[1] == 4 && offs[2] == 8;
+            if (packedFloats) {
+                // the block already is an array of vec3: one straight copy
+                std::memcpy(outPositions.data(), p, stride * e.count);
+            } else {
+                for (size_t i = 0; i < e.count; ++i) {
+                    const unsigned char* rec = p + i * stride;
+                    outPositions[i] = glm::vec3(
+                        readValue<Swap, float>(rec + offs[0], types[0]),
+                        readValue<Swap, float>(rec + offs[1], types[1]),
+                        readValue<Swap, float>(rec + offs[2], types[2]));
+                }
+            }
+            p += stride * e.count;
+        }
+        else if (e.name == "face")
+        {
+            outIndices.reserve(e.count * 3);
+            for (size_t i = 0; i < e.count; ++i)
+            {
+                size_t size = recordSize<Swap>(e, p, end);
+                if (size == 0) {
+                    std::cout << "PLY: file truncated in face block" << std::endl;
+                    return false;
+                }
+
+                const unsigned char* q = p;
+                for (const auto& prop : e.props) {
+                    if (!prop.isList) {
+                        q += plyTypeSize(prop.type);
+                        continue;
+                    }
+                    int64_t n = readValue<Swap, int64_t>(q, prop.countType);
+                    q += plyTypeSize(prop.countType);
+                    size_t itemSize = plyTypeSize(prop.type);
+
+                    if ((prop.name == "vertex_indices" || prop.name == "vertex_index") && n >= 3) {
+                        // fan-triangulate polygons
+                        int64_t first = readValue<Swap, int64_t>(q, prop.type);
+                        for (int64_t k = 1; k + 1 < n; ++k) {
+                            outIndices.push_back(static_cast<unsigned int>(first));
+                            outIndices.push_back(static_cast<unsigned int>(readValue<Swap, int64_t>(q + k * itemSize, prop.type)));
+                            outIndices.push_back(static_cast<unsigned int>(readValue<Swap, int64_t>(q + (k + 1) * itemSize, prop.type)));
+                        }
+                    }
+                    q += static_cast<size_t>(n) * itemSize;
+                }
+                p += size;
+            }
+        }
+        else
+        {
+            // skip unknown elements
+            if (fixedSize) {
+                size_t stride = recordSize<Swap>(e, p, end);
+                if (e.count > 0 && (stride == 0 || static_cast<size_t>(end - p) < stride * e.count)) {
+                    std::cout << "PLY: file truncated in element " << e.name << std::endl;
+                    return false;
+                }
+                p += stride * e.count;
+            } else {
+                for (size_t i = 0; i < e.count; ++i) {
+                    size_t size = recordSize<Swap>(e, p, end);
+                    if (size == 0) {
+                        std::cout << "PLY: file truncated in element " << e.name << std::endl;
+                        return false;
+                    }
+                    p += size;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+bool readPLY(const std::string& path,
+             std::vector<glm::vec3>& outPositions,
+             std::vector<unsigned int>& outIndices)
+{
+    outPositions.clear();
+    outIndices.clear();
+
+    MappedFile file(path);
+    if (!file.isOpen()) {
+        std::cout << "Cannot open PLY file: " << path << std::endl;
+        return false;
+    }
+
+    const char* text = reinterpret_cast<const char*>(file.data());
+    const unsigned char* end = file.data() + file.size();
+
+    // the header is plain text terminated by "end_header\n"
+    static const char kEndHeader[] = "end_header";
+    const char* headerEnd = std::search(text, text + file.size(),
+                                        kEndHeader, kEndHeader + sizeof(kEndHeader) - 1);
+    if (file.size() < 3 || std::strncmp(text, "ply", 3) != 0 || headerEnd == text + file.size()) {
+        std::cout << "Not a PLY file: " << path << std::endl;
+        return false;
+    }
+    const char* bodyStart = static_cast<const char*>(
+        std::memchr(headerEnd, '\n', static_cast<size_t>(reinterpret_cast<const char*>(end) - headerEnd)));
+    if (!bodyStart) {
+        std::cout << "PLY: header is not terminated" << std::endl;
+        return false;
+    }
+    ++bodyStart;
+
+    std::stringstream header(std::string(text, headerEnd));
+    std::string line;
+    std::string format;
+    std::vector<PlyElement> elements;
+
+    while (std::getline(header, line))
+    {
+        std::stringstream ss(line);
+        std::string tag;
+        ss >> tag;
+
+        if (tag == "format") {
+            ss >> format;
+        }
+        else if (tag == "element") {
+            PlyElement e;
+            ss >> e.name >> e.count;
+            elements.push_back(e);
+        }
+        else if (tag == "property" && !elements.empty()) {
+            PlyProperty prop;
+            std::string typeName;
+            ss >> typeName;
+            if (typeName == "list") {
+                std::string countName, itemName;
+                ss >> countName >> itemName >> prop.name;
+                prop.isList = true;
+                prop.countType = plyTypeFromName(countName);
+                prop.type = plyTypeFromName(itemName);
+            } else {
+                prop.type = plyTypeFromName(typeName);
+                ss >> prop.name;
+            }
+            if (prop.type == PlyType::Invalid || (prop.isList && prop.countType == PlyType::Invalid)) {
+                std::cout << "PLY: unknown property type in line: " << line << std::endl;
+                return false;
+            }
+            elements.back().props.push_back(prop);
+        }
+    }
+
+    bool fileLittle;
+    if (format == "binary_little_endian") {
+        fileLittle = true;
+    } else if (format == "binary_big_endian") {
+        fileLittle = false;
+    } else {
+        std::cout << "PLY: only binary formats are supported, got '" << format << "'" << std::endl;
+        return false;
+    }
+
+    const unsigned char* body = reinterpret_cast<const unsigned char*>(bodyStart);
+    bool ok = (fileLittle == hostIsLittleEndian())
+                  ? parsePLYBody<false>(elements, body, end, outPositions, outIndices)
+                  : parsePLYBody<true>(elements, body, end, outPositions, outIndices);
+    return ok;
+}
+
+// ================== STL ==================
+
+namespace {
+
+struct PositionKey {
+    uint32_t bits[3];
+
+    bool operator==(const PositionKey& other) const {
+        return bits[0] == other.bits[0] && bits[1] == other.bits[1] && bits[2] == other.bits[2];
+    }
+};
+
+struct PositionKeyHash {
+    std::size_t operator()(const PositionKey& k) const {
+        // mix the three words so axis-aligned grids do not collide
+        uint64_t h = k.bits[0] * 0x9E3779B97F4A7C15ull;
+        h ^= (h >> 29) + k.bits[1] * 0xBF58476D1CE4E5B9ull;
+        h ^= (h >> 31) + k.bits[2] * 0x94D049BB133111EBull;
+        return static_cast<std::size_t>(h ^ (h >> 32));
+    }
+};
+
+} // namespace
+
+bool readSTL(const std::string& path,
+             std::vector<glm::vec3>& outPositions,
+             std::vector<unsigned int>& outIndices)
+{
+    outPositions.clear();
+    outIndices.clear();
+
+    MappedFile file(path);
+    if (!file.isOpen()) {
+        std::cout << "Cannot open STL file: " << path << std::endl;
+        return false;
+    }
+
+    // 80 byte header, uint32 triangle count, then 50 bytes per triangle:
+    // normal (3 floats), 3 corners (9 floats), uint16 attribute
+    const size_t kHeader = 84;
+    const size_t kRecord = 50;
+    if (file.size() < kHeader) {
+        std::cout << "STL: file too small: " << path << std::endl;
+        return false;
+    }
+    const unsigned char* p = file.data();
+    uint32_t triCount = static_cast<uint32_t>(p[80]) | (static_cast<uint32_t>(p[81]) << 8) |
+                        (static_cast<uint32_t>(p[82]) << 16) | (static_cast<uint32_t>(p[83]) << 24);
+    if (kHeader + static_cast<size_t>(triCount) * kRecord != file.size()) {
+        std::cout << "STL: size does not match triangle count (ASCII STL is not supported): "
+                  << path << std::endl;
+        return false;
+    }
+
+    // weld identical corners: exact bit pattern, with -0 folded to +0
+    std::unordered_map<PositionKey, unsigned int, PositionKeyHash> weldMap;
+    weldMap.reserve(triCount);   // closed meshes have about half as many vertices as triangles
+    outPositions.reserve(triCount / 2 + 3);
+    outIndices.resize(static_cast<size_t>(triCount) * 3);
+
+    for (uint32_t t = 0; t < triCount; ++t)
+    {
+        const unsigned char* rec = p + kHeader + static_cast<size_t>(t) * kRecord + 12;
+        for (int c = 0; c < 3; ++c)
+        {
+            PositionKey key;
+            for (int k = 0; k < 3; ++k) {
+                const unsigned char* q = rec + (c * 3 + k) * 4;
+                // STL is always little endian
+                uint32_t w = static_cast<uint32_t>(q[0]) | (static_cast<uint32_t>(q[1]) << 8) |
+                             (static_cast<uint32_t>(q[2]) << 16) | (static_cast<uint32_t>(q[3]) << 24);
+                if (w == 0x80000000u) w = 0;
+                key.bits[k] = w;
+            }
+
+            auto inserted = weldMap.emplace(key, static_cast<unsigned int>(outPositions.size()));
+            if (inserted.second) {
+                glm::vec3 pos;
+                std::memcpy(&pos.x, &key.bits[0], 4);
+                std::memcpy(&pos.y, &key.bits[1], 4);
+                std::memcpy(&pos.z, &key.bits[2], 4);
+                outPositions.push_back(pos);
+            }
+            outIndices[static_cast<size_t>(t) * 3 + c] = inserted.first->second;
+        }
+    }
+
+    return true;
+}
+
+// ================== Writers ==================
+
+namespace {
+
+// A piece of output: either an owned formatted buffer or a view of
+// memory that is already laid out the way the file wants it.
+struct OutChunk {
+    std::string text;
+    const char* view = nullptr;
+    size_t viewSize = 0;
+
+    const char* data() const { return view ? view : text.data(); }
+    size_t size() const { return view ? viewSize : text.size(); }
+};
+
+size_t outputChunkCount(size_t records)
+{
+    // a few chunks per worker so uneven record lengths still balance
+    return std::max<size_t>(1, std::min<size_t>(records / 4096 + 1, workerCount() * 4));
+}
+
+// Hand all chunks to the OS in as few calls as possible
+bool writeChunks(const std::string& path, const std::vector<OutChunk>& chunks)
+{
+#ifdef _WIN32
+    FILE* f = std::fopen(path.c_str(), "wb");
+    if (!f) return false;
+    std::setvbuf(f, nullptr, _IONBF, 0);   // chunks are large already
+    bool ok = true;
+    for (const auto& c : chunks) {
+        if (c.size() && std::fwrite(c.data(), 1, c.size(), f) != c.size()) {
+            ok = false;
+            break;
+        }
+    }
+    return std::fclose(f) == 0 && ok;
+#else
+    int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) return false;
+
+    const size_t kBatch = 64;   // well below IOV_MAX everywhere
+    std::vector<iovec> iov;
+    iov.reserve(chunks.size());
+    for (const auto& c : chunks) {
+        if (c.size() == 0) continue;
+        iovec v;
+        v.iov_base = const_cast<char*>(c.data());
+        v.iov_len = c.size();
+        iov.push_back(v);
+    }
+
+    size_t first = 0;
+    while (first < iov.size()) {
+        int n = static_cast<int>(std::min(kBatch, iov.size() - first));
+        ssize_t written = ::writev(fd, &iov[first], n);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            ::close(fd);
+            return false;
+        }
+        // advance past whatever went out, partial writes included
+        size_t left = static_cast<size_t>(written);
+        while (first < iov.size() && left >= iov[first].iov_len) {
+            left -= iov[first].iov_len;
+            ++first;
+        }
+        if (left > 0) {
+            iov[first].iov_base = static_cast<char*>(iov[first].iov_base) + left;
+            iov[first].iov_len -= left;
+        }
+    }
+    return ::close(fd) == 0;
+#endif
+}
+
+inline void appendFloat(std::string& out, float v)
+{
+    char buf[32];
+    // shortest representation that parses back to the same float
+    auto res = std::to_chars(buf, buf + sizeof(buf), v);
+    out.append(buf, res.ptr);
+}
+
+inline void appendUInt(std::string& out, unsigned int v)
+{
+    char buf[16];
+    auto res = std::to_chars(buf, buf + sizeof(buf), v);
+    out.append(buf, res.ptr);
+}
+
+void appendLE32(char* dst, uint32_t v)
+{
+    dst[0] = static_cast<char>(v & 0xFF);
+    dst[1] = static_cast<char>((v >> 8) & 0xFF);
+    dst[2] = static_cast<char>((v >> 16) & 0xFF);
+    dst[3] = static_cast<char>((v >> 24) & 0xFF);
+}
+
+std::string fileExtension(const std::string& path)
+{
+    size_t dot = path.find_last_of('.');
+    std::string ext = (dot == std::string::npos) ? "" : path.substr(dot + 1);
+    std::transform(ext.begin(), ext.end(), ext.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return ext;
+}
+
+} // namespace
+
+bool writeOBJ(const std::string& path,
+              const std::vector<glm::vec3>& positions,
+              const std::vector<unsigned int>& indices)
+{
+    size_t faceCount = indices.size() / 3;
+    size_t vChunks = outputChunkCount(positions.size());
+    size_t fChunks = outputChunkCount(faceCount);
+
+    std::vector<OutChunk> chunks(1 + vChunks + fChunks);
+    chunks[0].text = "# " + std::to_string(positions.size()) + " vertices, " +
+                     std::to_string(faceCount) + " faces\n";
+
+    parallelChunks(positions.size(), vChunks, [&](size_t c, size_t begin, size_t end) {
+        std::string& out = chunks[1 + c].text;
+        out.reserve((end - begin) * 40);
+        for (size_t i = begin; i < end; ++i) {
+            const glm::vec3& p = positions[i];
+            out += "v ";
+            appendFloat(out, p.x);
+            out += ' ';
+            appendFloat(out, p.y);
+            out += ' ';
+            appendFloat(out, p.z);
+            out += '\n';
+        }
+    });
+
+    parallelChunks(faceCount, fChunks, [&](size_t c, size_t begin, size_t end) {
+        std::string& out = chunks[1 + vChunks + c].text;
+        out.reserve((end - begin) * 24);
+        for (size_t f = begin; f < end; ++f) {
+            out += "f ";
+            appendUInt(out, indices[f * 3] + 1);
+            out += ' ';
+            appendUInt(out, indices[f * 3 + 1] + 1);
+            out += ' ';
+            appendUInt(out, indices[f * 3 + 2] + 1);
+            out += '\n';
+        }
+    });
+
+    if (!writeChunks(path, chunks)) {
+        std::cout << "Cannot write OBJ file: " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool writePLY(const std::string& path,
+              const std::vector<glm::vec3>& positions,
+              const std::vector<unsigned int>& indices)
+{
+    size_t faceCount = indices.size() / 3;
+    const size_t kFaceRecord = 13;   // uchar count + 3 int32
+    size_t fChunks = outputChunkCount(faceCount);
+
+    std::vector<OutChunk> chunks;
+    chunks.reserve(2 + fChunks);
+
+    OutChunk header;
+    header.text = "ply\nformat binary_little_endian 1.0\n"
+                  "element vertex " + std::to_string(positions.size()) + "\n"
+                  "property float x\nproperty float y\nproperty float z\n"
+                  "element face " + std::to_string(faceCount) + "\n"
+                  "property list uchar int vertex_indices\n"
+                  "end_header\n";
+    chunks.push_back(std::move(header));
+
+    OutChunk vertexBlock;
+    if (hostIsLittleEndian() && sizeof(glm::vec3) == 12) {
+        // positions already are the vertex block, write them in place
+        vertexBlock.view = reinterpret_cast<const char*>(positions.data());
+        vertexBlock.viewSize = positions.size() * 12;
+    } else {
+        vertexBlock.text.resize(positions.size() * 12);
+        parallelFor(positions.size(), 65536, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) {
+                for (int k = 0; k < 3; ++k) {
+                    uint32_t bits;
+                    std::memcpy(&bits, &positions[i][k], 4);
+                    appendLE32(&vertexBlock.text[i * 12 + k * 4], bits);
+                }
+            }
+        });
+    }
+    chunks.push_back(std::move(vertexBlock));
+
+    size_t faceBase = chunks.size();
+    chunks.resize(faceBase + fChunks);
+    parallelChunks(faceCount, fChunks, [&](size_t c, size_t begin, size_t end) {
+        std::string& out = chunks[faceBase + c].text;
+        out.resize((end - begin) * kFaceRecord);
+        char* dst = &out[0];
+        for (size_t f = begin; f < end; ++f, dst += kFaceRecord) {
+            dst[0] = 3;
+            appendLE32(dst + 1, indices[f * 3]);
+            appendLE32(dst + 5, indices[f * 3 + 1]);
+            appendLE32(dst + 9, indices[f * 3 + 2]);
+        }
+    });
+
+    if (!writeChunks(path, chunks)) {
+        std::cout << "Cannot write PLY file: " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// ================== Dispatch ==================
+
+bool readMesh(const std::string& path,
+              std::vector<glm::vec3>& outPositions,
+              std::vector<unsigned int>& outIndices)
+{
+    std::string ext = fileExtension(path);
+    if (ext == "ply") return readPLY(path, outPositions, outIndices);
+    if (ext == "stl") return readSTL(path, outPositions, outIndices);
+    if (ext == "obj") return readOBJ(path, outPositions, outIndices);
+
+    std::cout << "Unknown mesh format: " << path << std::endl;
+    return false;
+}
+
+bool writeMesh(const std::string& path,
+               const std::vector<glm::vec3>& positions,
+               const std::vector<unsigned int>& indices)
+{
+    std::string ext = fileExtension(path);
+    if (ext == "ply") return writePLY(path, positions, indices);
+    if (ext == "obj") return writeOBJ(path, positions, indices);
+
+    std::cout << "Unknown mesh format: " << path << std::endl;
+    return false;
+}
@@ -0,0 +1,49 @@
+#ifndef MESHIO_H
+#define MESHIO_H
+#include <glm/glm.hpp>
+#include <vector>
+#include <string>
+
+// Raw mesh readers. Each one fills an indexed triangle list
+// (3 indices per triangle, 0-based) that Hedge::buildFromTriangles
+// turns into half-edge connectivity.
+
+// Simple OBJ: only v and f, triangles
+bool readOBJ(const std::string& path,
+             std::vector<glm::vec3>& outPositions,
+             std::vector<unsigned int>& outIndices);
+
+// Binary PLY (little or big endian): vertex x/y/z and face index lists
+bool readPLY(const std::string& path,
+             std::vector<glm::vec3>& outPositions,
+             std::vector<unsigned int>& outIndices);
+
+// Binary STL: unindexed triangles, identical corners are welded
+bool readSTL(const std::string& path,
+             std::vector<glm::vec3>& outPositions,
+             std::vector<unsigned int>& outIndices);
+
+// Pick the reader from the file extension (.obj / .ply / .stl)
+bool readMesh(const std::string& path,
+              std::vector<glm::vec3>& outPositions,
+              std::vector<unsigned int>& outIndices);
+
+// Writers. Records are formatted in parallel chunks and the chunks are
+// handed to the OS in one vectored write.
+
+// OBJ text with shortest round-trip floats (v and f only, 1-based)
+bool writeOBJ(const std::string& path,
+              const std::vector<glm::vec3>& positions,
+              const std::vector<unsigned int>& indices);
+
+// Binary little endian PLY (float x/y/z, uchar/int vertex_indices)
+bool writePLY(const std::string& path,
+              const std::vector<glm::vec3>& positions,
+              const std::vector<unsigned int>& indices);
+
+// Pick the writer from the file extension (.obj / .ply)
+bool writeMesh(const std::string& path,
+               const std::vector<glm::vec3>& positions,
+               const std::vector<unsigned int>& indices);
+
+#endif
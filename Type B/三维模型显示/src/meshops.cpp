@@ -0,0 +1,309 @@
+#include "meshops.h"
+#include "parallel.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <numeric>
+#include <unordered_map>
+
+namespace {
+
+// Bounding box of a point set
+void computeBounds(const std::vector<glm::vec3>& positions, glm::vec3& bmin, glm::vec3& bmax)
+{
+    size_t chunkCount = workerCount();
+    std::vector<glm::vec3> chunkMin(chunkCount, glm::vec3(std::numeric_limits<float>::max()));
+    std::vector<glm::vec3> chunkMax(chunkCount, glm::vec3(-std::numeric_limits<float>::max()));
+    parallelChunks(positions.size(), chunkCount, [&](size_t c, size_t begin, size_t end) {
+        glm::vec3 lo = chunkMin[c], hi = chunkMax[c];
+        for (size_t i = begin; i < end; ++i) {
+            lo = glm::min(lo, positions[i]);
+            hi = glm::max(hi, positions[i]);
+        }
+        chunkMin[c] = lo;
+        chunkMax[c] = hi;
+    });
+    bmin = chunkMin[0];
+    bmax = chunkMax[0];
+    for (size_t c = 1; c < chunkCount; ++c) {
+        bmin = glm::min(bmin, chunkMin[c]);
+        bmax = glm::max(bmax, chunkMax[c]);
+    }
+}
+
+// Spread the low 21 bits of v so there are two zero bits between each
+uint64_t spreadBits(uint64_t v)
+{
+    v &= 0x1FFFFF;
+    v = (v | (v << 32)) & 0x1F00000000FFFFull;
+    v = (v | (v << 16)) & 0x1F0000FF0000FFull;
+    v = (v | (v << 8))  & 0x100F00F00F00F00Full;
+    v = (v | (v << 4))  & 0x10C30C30C30C30C3ull;
+    v = (v | (v << 2))  & 0x1249249249249249ull;
+    return v;
+}
+
+struct CellKeyHash {
+    std::size_t operator()(const glm::ivec3& k) const {
+        uint64_t h = static_cast<uint32_t>(k.x) * 0x9E3779B97F4A7C15ull;
+        h ^= (h >> 29) + static_cast<uint32_t>(k.y) * 0xBF58476D1CE4E5B9ull;
+        h ^= (h >> 31) + static_cast<uint32_t>(k.z) * 0x94D049BB133111EBull;
+        return static_cast<std::size_t>(h ^ (h >> 32));
+    }
+};
+
+} // namespace
+
+void clusterDecimate(const std::vector<glm::vec3>& positions,
+                     const std::vector<unsigned int>& indices,
+                     int resolution,
+                     std::vector<glm::vec3>& outPositions,
+                     std::vector<unsigned int>& outIndices)
+{
+    outPositions.clear();
+    outIndices.clear();
+    if (positions.empty() || resolution < 1) return;
+
+    size_t numVerts = positions.size();
+    size_t chunkCount = workerCount();
+
+    glm::vec3 bmin, bmax;
+    computeBounds(positions, bmin, bmax);
+
+    glm::vec3 extent = bmax - bmin;
+    float longest = std::max(extent.x, std::max(extent.y, extent.z));
+    float cellSize = longest > 0.0f ? longest / resolution : 1.0f;
+    float invCell = 1.0f / cellSize;
+
+    // ---- grid cell per vertex
+    const uint64_t kAxisMax = (1u << 21) - 1;
+    uint64_t dims[3];
+    for (int k = 0; k < 3; ++k) {
+        dims[k] = std::min<uint64_t>(static_cast<uint64_t>(extent[k] * invCell) + 1, kAxisMax + 1);
+    }
+    std::vector<uint64_t> keys(numVerts);
+    parallelFor(numVerts, 65536, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            glm::vec3 g = (positions[i] - bmin) * invCell;
+            uint64_t ix = std::min<uint64_t>(static_cast<uint64_t>(std::max(g.x, 0.0f)), dims[0] - 1);
+            uint64_t iy = std::min<uint64_t>(static_cast<uint64_t>(std::max(g.y, 0.0f)), dims[1] - 1);
+            uint64_t iz = std::min<uint64_t>(static_cast<uint64_t>(std::max(g.z, 0.0f)), dims[2] - 1);
+            keys[i] = (ix * dims[1] + iy) * dims[2] + iz;
+        }
+    });
+
+    // ---- number the occupied cells
+    std::vector<unsigned int> cellOf(numVerts);
+    size_t numCells = 0;
+    const uint64_t kDenseLimit = uint64_t(1) << 24;
+    uint64_t gridCells = dims[0] * dims[1] * dims[2];
+    if (gridCells <= kDenseLimit) {
+        // small grid: mark occupied cells in a dense table, no sorting
+        const unsigned int kEmpty = std::numeric_limits<unsigned int>::max();
+        std::vector<unsigned int> cellId(static_cast<size_t>(gridCells), kEmpty);
+        for (size_t i = 0; i < numVerts; ++i) {
+            unsigned int& id = cellId[static_cast<size_t>(keys[i])];
+            if (id == kEmpty) id = static_cast<unsigned int>(numCells++);
+            cellOf[i] = id;
+        }
+    } else {
+        // fine grid: sort the distinct keys once
+        std::vector<uint64_t> cells(keys);
+        std::sort(cells.begin(), cells.end());
+        cells.erase(std::unique(cells.begin(), cells.end()), cells.end());
+        numCells = cells.size();
+        parallelFor(numVerts, 65536, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) {
+                cellOf[i] = static_cast<unsigned int>(
+                    std::lower_bound(cells.begin(), cells.end(), keys[i]) - cells.begin());
+            }
+        });
+    }
+
+    // ---- representative = mean of the cell members
+    std::vector<glm::vec3> sums(numCells, glm::vec3(0.0f));
+    std::vector<unsigned int> counts(numCells, 0);
+    for (size_t i = 0; i < numVerts; ++i) {
+        sums[cellOf[i]] += positions[i];
+        counts[cellOf[i]]++;
+    }
+    outPositions.resize(numCells);
+    for (size_t c = 0; c < numCells; ++c) {
+        outPositions[c] = sums[c] / static_cast<float>(counts[c]);
+    }
+
+    // ---- remap faces and drop degenerate ones in one parallel pass;
+    // each chunk keeps its survivors, then the chunks are concatenated
+    size_t numFaces = indices.size() / 3;
+    size_t faceChunks = std::max<size_t>(1, std::min(chunkCount * 4, numFaces / 1024 + 1));
+    std::vector<std::vector<unsigned int>> kept(faceChunks);
+    parallelChunks(numFaces, faceChunks, [&](size_t c, size_t begin, size_t end) {
+        std::vector<unsigned int>& out = kept[c];
+        for (size_t f = begin; f < end; ++f) {
+            unsigned int a = cellOf[indices[f * 3]];
+            unsigned int b = cellOf[indices[f * 3 + 1]];
+            unsigned int d = cellOf[indices[f * 3 + 2]];
+            if (a == b || b == d || d == a) continue;
+            out.push_back(a);
+            out.push_back(b);
+            out.push_back(d);
+        }
+    });
+
+    size_t total = 0;
+    for (const auto& k : kept) total += k.size();
+    outIndices.reserve(total);
+    for (const auto& k : kept) outIndices.insert(outIndices.end(), k.begin(), k.end());
+}
+
+size_t weldVertices(std::vector<glm::vec3>& positions,
+                    std::vector<unsigned int>& indices,
+                    float epsilon)
+{
+    size_t numVerts = positions.size();
+    if (numVerts == 0) return 0;
+
+    // quantized key per vertex; with epsilon 0 the raw bits are the key
+    std::vector<glm::ivec3> keys(numVerts);
+    float inv = epsilon > 0.0f ? 1.0f / epsilon : 0.0f;
+    parallelFor(numVerts, 65536, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            if (epsilon > 0.0f) {
+                glm::vec3 g = glm::floor(positions[i] * inv + glm::vec3(0.5f));
+                keys[i] = glm::ivec3(static_cast<int>(g.x), static_cast<int>(g.y), static_cast<int>(g.z));
+            } else {
+                glm::vec3 p = positions[i] + glm::vec3(0.0f);   // folds -0 into +0
+                std::memcpy(&keys[i].x, &p.x, 4);
+                std::memcpy(&keys[i].y, &p.y, 4);
+                std::memcpy(&keys[i].z, &p.z, 4);
+            }
+        }
+    });
+
+    std::unordered_map<glm::ivec3, unsigned int, CellKeyHash> firstInCell;
+    firstInCell.reserve(numVerts);
+    std::vector<unsigned int> remap(numVerts);
+    std::vector<glm::vec3> welded;
+    welded.reserve(numVerts);
+    for (size_t i = 0; i < numVerts; ++i) {
+        auto inserted = firstInCell.emplace(keys[i], static_cast<unsigned int>(welded.size()));
+        if (inserted.second) welded.push_back(positions[i]);
+        remap[i] = inserted.first->second;
+    }
+
+    parallelFor(indices.size(), 65536, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) indices[i] = remap[indices[i]];
+    });
+
+    size_t merged = numVerts - welded.size();
+    positions.swap(welded);
+    return merged;
+}
+
+void computeVertexNormals(const std::vector<glm::vec3>& positions,
+                          const std::vector<unsigned int>& indices,
+                          std::vector<glm::vec3>& outNormals)
+{
+    size_t numVerts = positions.size();
+    size_t numFaces = indices.size() / 3;
+
+    // face normals; the cross product length is twice the area,
+    // which gives the area weighting for free
+    std::vector<glm::vec3> faceNormals(numFaces);
+    parallelFor(numFaces, 16384, [&](size_t begin, size_t end) {
+        for (size_t f = begin; f < end; ++f) {
+            const glm::vec3& a = positions[indices[f * 3]];
+            const glm::vec3& b = positions[indices[f * 3 + 1]];
+            const glm::vec3& c = positions[indices[f * 3 + 2]];
+            faceNormals[f] = glm::cross(b - a, c - a);
+        }
+    });
+
+    // vertex -> face incidence in CSR form, then a race-free gather
+    std::vector<unsigned int> offsets(numVerts + 1, 0);
+    for (unsigned int v : indices) offsets[v + 1]++;
+    for (size_t v = 0; v < numVerts; ++v) offsets[v + 1] += offsets[v];
+    std::vector<unsigned int> incident(indices.size());
+    std::vector<unsigned int> cursor(offsets.begin(), offsets.end() - 1);
+    for (size_t i = 0; i < indices.size(); ++i) {
+        incident[cursor[indices[i]]++] = static_cast<unsigned int>(i / 3);
+    }
+
+    outNormals.resize(numVerts);
+    parallelFor(numVerts, 16384, [&](size_t begin, size_t end) {
+        for (size_t v = begin; v < end; ++v) {
+            glm::vec3 n(0.0f);
+            for (unsigned int k = offsets[v]; k < offsets[v + 1]; ++k) n += faceNormals[incident[k]];
+            float len = glm::length(n);
+            outNormals[v] = len > 0.0f ? n / len : glm::vec3(0.0f, 1.0f, 0.0f);
+        }
+    });
+}
+
+void reorderForLocality(std::vector<glm::vec3>& positions,
+                        std::vector<unsigned int>& indices)
+{
+    size_t numVerts = positions.size();
+    if (numVerts == 0) return;
+
+    glm::vec3 bmin, bmax;
+    computeBounds(positions, bmin, bmax);
+    glm::vec3 extent = bmax - bmin;
+    float longest = std::max(extent.x, std::max(extent.y, extent.z));
+    float scale = longest > 0.0f ? static_cast<float>((1u << 21) - 1) / longest : 0.0f;
+
+    std::vector<uint64_t> codes(numVerts);
+    parallelFor(numVerts, 65536, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            glm::vec3 g = (positions[i] - bmin) * scale;
+            codes[i] = (spreadBits(static_cast<uint64_t>(g.x)) << 2) |
+                       (spreadBits(static_cast<uint64_t>(g.y)) << 1) |
+                        spreadBits(static_cast<uint64_t>(g.z));
+        }
+    });
+
+    std::vector<unsigned int> order(numVerts);
+    std::iota(order.begin(), order.end(), 0u);
+    std::sort(order.begin(), order.end(),
+              [&](unsigned int a, unsigned int b) { return codes[a] < codes[b]; });
+
+    std::vector<unsigned int> newIndex(numVerts);
+    std::vector<glm::vec3> sorted(numVerts);
+    parallelFor(numVerts, 65536, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            newIndex[order[i]] = static_cast<unsigned int>(i);
+            sorted[i] = positions[order[i]];
+        }
+    });
+    positions.swap(sorted);
+
+    // renumber the triangles and sort them by their smallest new vertex
+    size_t numFaces = indices.size() / 3;
+    std::vector<unsigned int> faceKey(numFaces);
+    parallelFor(numFaces, 65536, [&](size_t begin, size_t end) {
+        for (size_t f = begin; f < end; ++f) {
+            unsigned int* t = &indices[f * 3];
+            t[0] = newIndex[t[0]];
+            t[1] = newIndex[t[1]];
+            t[2] = newIndex[t[2]];
+            faceKey[f] = std::min(t[0], std::min(t[1], t[2]));
+        }
+    });
+
+    std::vector<unsigned int> faceOrder(numFaces);
+    std::iota(faceOrder.begin(), faceOrder.end(), 0u);
+    std::stable_sort(faceOrder.begin(), faceOrder.end(),
+                     [&](unsigned int a, unsigned int b) { return faceKey[a] < faceKey[b]; });
+
+    std::vector<unsigned int> sortedIndices(indices.size());
+    parallelFor(numFaces, 65536, [&](size_t begin, size_t end) {
+        for (size_t f = begin; f < end; ++f) {
+            const unsigned int* src = &indices[faceOrder[f] * 3];
+            sortedIndices[f * 3]     = src[0];
+            sortedIndices[f * 3 + 1] = src[1];
+            sortedIndices[f * 3 + 2] = src[2];
+        }
+    });
+    indices.swap(sortedIndices);
+}
@@ -0,0 +1,37 @@
+#ifndef MESHOPS_H
+#define MESHOPS_H
+#include <glm/glm.hpp>
+#include <vector>
+#include <cstddef>
+
+// Passes that work directly on indexed triangle lists
+// (3 indices per triangle), before or after going through Hedge.
+
+// Vertex-clustering decimation: snap vertices to a uniform grid with
+// `resolution` cells along the longest bounding box axis and keep one
+// vertex per occupied cell (the average of its members). Triangles whose
+// corners collapse into fewer than three cells are dropped.
+void clusterDecimate(const std::vector<glm::vec3>& positions,
+                     const std::vector<unsigned int>& indices,
+                     int resolution,
+                     std::vector<glm::vec3>& outPositions,
+                     std::vector<unsigned int>& outIndices);
+
+// Merge vertices that fall into the same cell of a grid with spacing
+// `epsilon` (exact position match when epsilon is 0). Indices are
+// remapped to the merged vertices. Returns how many vertices were merged.
+size_t weldVertices(std::vector<glm::vec3>& positions,
+                    std::vector<unsigned int>& indices,
+                    float epsilon);
+
+// Area-weighted vertex normals
+void computeVertexNormals(const std::vector<glm::vec3>& positions,
+                          const std::vector<unsigned int>& indices,
+                          std::vector<glm::vec3>& outNormals);
+
+// Renumber vertices along a Morton (Z-order) curve and sort triangles by
+// their smallest vertex, so neighbors end up close together in memory.
+void reorderForLocality(std::vector<glm::vec3>& positions,
+                        std::vector<unsigned int>& indices);
+
+#endif
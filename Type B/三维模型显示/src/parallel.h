@@ -0,0 +1,65 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <algorithm>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+// Number of worker threads used by the mesh passes
+inline unsigned int workerCount()
+{
+    // asked once: the query costs microseconds on some systems
+    static const unsigned int n = std::max(std::thread::hardware_concurrency(), 1u);
+    return n;
+}
+
+// Split [0, count) into at most workerCount() contiguous ranges and call
+// fn(begin, end) for each on its own thread. Small inputs (below minPerThread
+// items per thread) stay on the calling thread.
+template <class Fn>
+void parallelFor(size_t count, size_t minPerThread, Fn fn)
+{
+    if (count == 0) return;
+    if (count <= minPerThread) {
+        fn(size_t(0), count);
+        return;
+    }
+
+    size_t threads = std::min<size_t>(workerCount(), (count + minPerThread - 1) / std::max<size_t>(minPerThread, 1));
+    if (threads <= 1) {
+        fn(size_t(0), count);
+        return;
+    }
+
+    std::vector<std::thread> pool;
+    pool.reserve(threads - 1);
+    size_t chunk = (count + threads - 1) / threads;
+    for (size_t t = 1; t < threads; ++t) {
+        size_t begin = t * chunk;
+        size_t end = std::min(count, begin + chunk);
+        if (begin >= end) break;
+        pool.emplace_back([=, &fn]() { fn(begin, end); });
+    }
+    fn(size_t(0), std::min(count, chunk));
+    for (auto& th : pool) th.join();
+}
+
+// Same as parallelFor but over a fixed number of chunks, fn(chunk, begin, end).
+// Useful when each chunk owns a piece of output that is stitched afterwards.
+template <class Fn>
+void parallelChunks(size_t count, size_t chunkCount, Fn fn)
+{
+    if (count == 0 || chunkCount == 0) return;
+
+    size_t chunk = (count + chunkCount - 1) / chunkCount;
+    parallelFor(chunkCount, 1, [&](size_t cBegin, size_t cEnd) {
+        for (size_t c = cBegin; c < cEnd; ++c) {
+            size_t begin = c * chunk;
+            size_t end = std::min(count, begin + chunk);
+            if (begin < end) fn(c, begin, end);
+        }
+    });
+}
+
+#endif
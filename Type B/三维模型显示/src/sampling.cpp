@@ -0,0 +1,326 @@
+#include "sampling.h"
+#include "parallel.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <limits>
+
+namespace {
+
+// Poisson-disk candidates per radius^2 of surface area. A maximal disk
+// set holds roughly 0.7 samples per radius^2, so this is about 10 tries
+// per kept sample.
+const double CANDIDATES_PER_R2 = 7.0;
+
+// Poisson-disk grid cells per axis are capped so the packed cell key
+// stays within 64 bits
+const uint64_t MAX_CELL = 1 << 21;
+
+// splitmix64 finalizer: a good 64-bit hash of a counter
+inline uint64_t mix64(uint64_t x)
+{
+    x += 0x9E3779B97F4A7C15ull;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+    return x ^ (x >> 31);
+}
+
+// Uniform float in [0, 1) from the top 24 bits
+inline float unitFloat(uint64_t h)
+{
+    return static_cast<float>(h >> 40) * (1.0f / 16777216.0f);
+}
+
+} // namespace
+
+bool SurfaceSampler::build(const Hedge& mesh)
+{
+    std::vector<unsigned int> indices;
+    mesh.buildFaceIndexArray(indices);
+    size_t numFaces = indices.size() / 3;
+    if (numFaces == 0) {
+        std::cout << "SurfaceSampler: mesh has no faces" << std::endl;
+        totalArea = 0.0;
+        return false;
+    }
+
+    corners.resize(numFaces * 3);
+    prefix.resize(numFaces);
+    std::vector<double> area(numFaces);
+    parallelFor(numFaces, 4096, [&](size_t begin, size_t end) {
+        for (size_t f = begin; f < end; ++f) {
+            for (int c = 0; c < 3; ++c) corners[f * 3 + c] = mesh.vertices[indices[f * 3 + c]]->position;
+            glm::vec3 n = glm::cross(corners[f * 3 + 1] - corners[f * 3], corners[f * 3 + 2] - corners[f * 3]);
+            area[f] = 0.5 * glm::length(n);
+        }
+    });
+
+    // prefix sum in two passes: per chunk totals, then each chunk
+    // continues from the sum of the chunks before it
+    size_t chunkCount = workerCount();
+    std::vector<double> chunkSum(chunkCount + 1, 0.0);
+    parallelChunks(numFaces, chunkCount, [&](size_t c, size_t begin, size_t end) {
+        double s = 0.0;
+        for (size_t f = begin; f < end; ++f) s += area[f];
+        chunkSum[c + 1] = s;
+    });
+    for (size_t c = 0; c < chunkCount; ++c) chunkSum[c + 1] += chunkSum[c];
+    totalArea = chunkSum[chunkCount];
+    if (!(totalArea > 0.0)) {
+        std::cout << "SurfaceSampler: mesh has zero area" << std::endl;
+        return false;
+    }
+    parallelChunks(numFaces, chunkCount, [&](size_t c, size_t begin, size_t end) {
+        double s = chunkSum[c];
+        for (size_t f = begin; f < end; ++f) {
+            s += area[f];
+            prefix[f] = s / totalArea;
+        }
+    });
+    prefix[numFaces - 1] = 1.0;
+
+    // Vose alias table: every slot holds its own face with probability
+    // aliasProb and its alias otherwise
+    aliasProb.resize(numFaces);
+    alias.resize(numFaces);
+    std::vector<double> scaled(numFaces);
+    std::vector<uint32_t> small, large;
+    for (size_t f = 0; f < numFaces; ++f) {
+        scaled[f] = area[f] * numFaces / totalArea;
+        (scaled[f] < 1.0 ? small : large).push_back(static_cast<uint32_t>(f));
+    }
+    while (!small.empty() && !large.empty()) {
+        uint32_t s = small.back(); small.pop_back();
+        uint32_t l = large.back();
+        aliasProb[s] = static_cast<float>(scaled[s]);
+        alias[s] = l;
+        scaled[l] -= 1.0 - scaled[s];
+        if (scaled[l] < 1.0) {
+            large.pop_back();
+            small.push_back(l);
+        }
+    }
+    for (uint32_t f : large) { aliasProb[f] = 1.0f; alias[f] = f; }
+    for (uint32_t f : small) { aliasProb[f] = 1.0f; alias[f] = f; }   // rounding leftovers
+    return true;
+}
+
+// Uniform point in a triangle from one hash (two 24-bit numbers)
+glm::vec3 SurfaceSampler::pointOnFace(size_t face, uint64_t key) const
+{
+    uint64_t h = mix64(key);
+    float r1 = std::sqrt(unitFloat(h));
+    float r2 = unitFloat(h << 24);
+    const glm::vec3* p = &corners[face * 3];
+    return p[0] * (1.0f - r1) + p[1] * (r1 * (1.0f - r2)) + p[2] * (r1 * r2);
+}
+
+void SurfaceSampler::sample(size_t count, uint64_t seed,
+                            std::vector<glm::vec3>& outPositions,
+                            std::vector<int>* outFaces) const
+{
+    outPositions.resize(count);
+    if (outFaces) outFaces->resize(count);
+    if (count == 0 || prefix.empty()) {
+        outPositions.clear();
+        if (outFaces) outFaces->clear();
+        return;
+    }
+
+    // face f owns samples [floor(P(f-1) * count + u), floor(P(f) * count + u))
+    const double offset = unitFloat(mix64(seed));
+    const double n = static_cast<double>(count);
+    const uint64_t base = mix64(seed ^ 0x5851F42D4C957F2Dull);
+    parallelFor(prefix.size(), 16384, [&](size_t begin, size_t end) {
+        size_t first = begin == 0 ? 0 : static_cast<size_t>(prefix[begin - 1] * n + offset);
+        for (size_t f = begin; f < end; ++f) {
+            size_t last = std::min(count, static_cast<size_t>(prefix[f] * n + offset));
+            if (f + 1 == prefix.size()) last = count;
+            for (size_t i = first; i < last; ++i) {
+                outPositions[i] = pointOnFace(f, base + i);
+                if (outFaces) (*outFaces)[i] = static_cast<int>(f);
+            }
+            first = std::max(first, last);
+        }
+    });
+}
+
+void SurfaceSampler::sampleRandom(size_t count, uint64_t seed,
+                                  std::vector<glm::vec3>& outPositions,
+                                  std::vector<int>* outFaces) const
+{
+    outPositions.resize(count);
+    if (outFaces) outFaces->resize(count);
+    if (aliasProb.empty()) {
+        outPositions.clear();
+        if (outFaces) outFaces->clear();
+        return;
+    }
+
+    const uint64_t numFaces = aliasProb.size();
+    const uint64_t base = mix64(seed);
+    parallelFor(count, 65536, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            uint64_t h = mix64(base + i * 2);
+            // high bits pick the slot, low bits the coin
+            size_t slot = static_cast<size_t>(((h >> 32) * numFaces) >> 32);
+            size_t face = unitFloat(h << 40) < aliasProb[slot] ? slot : alias[slot];
+            outPositions[i] = pointOnFace(face, base + i * 2 + 1);
+            if (outFaces) (*outFaces)[i] = static_cast<int>(face);
+        }
+    });
+}
+
+void SurfaceSampler::poissonDisk(float radius, uint64_t seed,
+                                 std::vector<glm::vec3>& outPositions,
+                                 std::vector<int>* outFaces) const
+{
+    outPositions.clear();
+    if (outFaces) outFaces->clear();
+    if (!(radius > 0.0f) || corners.empty()) return;
+
+    // i.i.d. candidates: their order is already random, so a stable sort
+    // by cell leaves each cell's candidates in random order
+    std::vector<glm::vec3> candidates;
+    std::vector<int> candidateFaces;
+    size_t numCandidates = static_cast<size_t>(std::ceil(CANDIDATES_PER_R2 * totalArea / (double(radius) * radius)));
+    sampleRandom(numCandidates, seed, candidates, &candidateFaces);
+
+    // Cells of side r: conflicts are at most one cell away, so cells whose
+    // coordinates agree mod 2 never interfere and form one parallel phase.
+    // A one cell margin keeps every neighbor key inside the grid.
+    glm::vec3 lo(std::numeric_limits<float>::max());
+    glm::vec3 hi(-std::numeric_limits<float>::max());
+    for (const auto& p : corners) { lo = glm::min(lo, p); hi = glm::max(hi, p); }
+    uint64_t dims[3];
+    for (int a = 0; a < 3; ++a) {
+        dims[a] = std::min<uint64_t>(MAX_CELL, static_cast<uint64_t>((hi[a] - lo[a]) / radius) + 3);
+    }
+    const uint64_t nx = dims[0], nxy = dims[0] * dims[1];
+    auto keyOf = [&](const glm::vec3& p) {
+        uint64_t c[3];
+        for (int a = 0; a < 3; ++a) {
+            c[a] = std::min<uint64_t>(dims[a] - 2, 1 + static_cast<uint64_t>((p[a] - lo[a]) / radius));
+        }
+        return c[0] + nx * c[1] + nxy * c[2];
+    };
+    int keyBits = 1;
+    while (keyBits < 64 && (nxy * dims[2]) >> keyBits) keyBits++;
+
+    struct SortKey { uint64_t cell; uint64_t index; };
+    std::vector<SortKey> keys(candidates.size()), scratch(candidates.size());
+    parallelFor(candidates.size(), 65536, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) keys[i] = {keyOf(candidates[i]), i};
+    });
+
+    // stable LSD radix sort, per chunk histograms so every pass is parallel
+    const int DIGIT_BITS = 11;
+    const size_t BUCKETS = size_t(1) << DIGIT_BITS;
+    size_t chunkCount = workerCount();
+    std::vector<size_t> histogram(chunkCount * BUCKETS);
+    for (int shift = 0; shift < keyBits; shift += DIGIT_BITS) {
+        std::fill(histogram.begin(), histogram.end(), 0);
+        parallelChunks(keys.size(), chunkCount, [&](size_t c, size_t begin, size_t end) {
+            size_t* h = &histogram[c * BUCKETS];
+            for (size_t i = begin; i < end; ++i) h[(keys[i].cell >> shift) & (BUCKETS - 1)]++;
+        });
+        size_t sum = 0;
+        for (size_t d = 0; d < BUCKETS; ++d) {
+            for (size_t c = 0; c < chunkCount; ++c) {
+                size_t n = histogram[c * BUCKETS + d];
+                histogram[c * BUCKETS + d] = sum;
+                sum += n;
+            }
+        }
+        parallelChunks(keys.size(), chunkCount, [&](size_t c, size_t begin, size_t end) {
+            size_t* h = &histogram[c * BUCKETS];
+            for (size_t i = begin; i < end; ++i) scratch[h[(keys[i].cell >> shift) & (BUCKETS - 1)]++] = keys[i];
+        });
+        keys.swap(scratch);
+    }
+    std::vector<SortKey>().swap(scratch);
+
+    // positions travel along so the thinning pass reads memory in order
+    struct Entry { uint64_t key; uint32_t index; glm::vec3 position; };
+    std::vector<Entry> entries(keys.size());
+    parallelFor(keys.size(), 65536, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            entries[i] = {keys[i].cell, static_cast<uint32_t>(keys[i].index), candidates[keys[i].index]};
+        }
+    });
+    std::vector<SortKey>().swap(keys);
+
+    std::vector<uint64_t> cellKeys;
+    std::vector<size_t> cellStart;
+    for (size_t i = 0; i < entries.size(); ++i) {
+        if (i == 0 || entries[i].key != entries[i - 1].key) {
+            cellKeys.push_back(entries[i].key);
+            cellStart.push_back(i);
+        }
+    }
+    cellStart.push_back(entries.size());
+    size_t numCells = cellKeys.size();
+
+    std::vector<std::vector<int>> phases(8);
+    for (size_t c = 0; c < numCells; ++c) {
+        uint64_t k = cellKeys[c];
+        uint64_t x = k % nx, y = (k / nx) % dims[1], z = k / nxy;
+        phases[(x & 1) * 4 + (y & 1) * 2 + (z & 1)].push_back(static_cast<int>(c));
+    }
+
+    // Kept samples are moved to the front of their cell's entry range;
+    // keptCount tells the neighbors how many there are
+    std::vector<int> keptCount(numCells, 0);
+    const float r2 = radius * radius;
+    for (const std::vector<int>& phase : phases) {
+        parallelFor(phase.size(), 256, [&](size_t begin, size_t end) {
+            std::vector<glm::vec3> near;
+            // The 3x3 neighbor rows (x-1 .. x+1 at fixed y, z) are runs of
+            // consecutive keys, and their keys only grow as we walk the
+            // phase in order, so one forward cursor per row replaces any
+            // hash lookups
+            size_t cursor[9];
+            for (size_t pi = begin; pi < end; ++pi) {
+                int cell = phase[pi];
+                uint64_t k = cellKeys[cell];
+
+                // samples kept around this cell in earlier phases
+                near.clear();
+                for (int row = 0; row < 9; ++row) {
+                    uint64_t rowKey = k - 1 + (row % 3 - 1) * nx + (row / 3 - 1) * nxy;
+                    size_t& c = cursor[row];
+                    if (pi == begin) {
+                        c = std::lower_bound(cellKeys.begin(), cellKeys.end(), rowKey) - cellKeys.begin();
+                    }
+                    while (c < numCells && cellKeys[c] < rowKey) ++c;
+                    for (size_t other = c; other < numCells && cellKeys[other] <= rowKey + 2; ++other) {
+                        if (static_cast<int>(other) == cell) continue;
+                        for (int q = 0; q < keptCount[other]; ++q) near.push_back(entries[cellStart[other] + q].position);
+                    }
+                }
+
+                size_t kept = cellStart[cell];
+                for (size_t e = cellStart[cell]; e < cellStart[cell + 1]; ++e) {
+                    const glm::vec3 p = entries[e].position;
+                    bool free = true;
+                    for (size_t q = 0; q < near.size() && free; ++q) {
+                        glm::vec3 d = p - near[q];
+                        free = glm::dot(d, d) >= r2;
+                    }
+                    if (!free) continue;
+                    near.push_back(p);
+                    std::swap(entries[kept++], entries[e]);
+                }
+                keptCount[cell] = static_cast<int>(kept - cellStart[cell]);
+            }
+        });
+    }
+
+    for (size_t c = 0; c < numCells; ++c) {
+        for (int q = 0; q < keptCount[c]; ++q) {
+            const Entry& kept = entries[cellStart[c] + q];
+            outPositions.push_back(kept.position);
+            if (outFaces) outFaces->push_back(candidateFaces[kept.index]);
+        }
+    }
+}
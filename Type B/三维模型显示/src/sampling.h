@@ -0,0 +1,50 @@
+#ifndef SAMPLING_H
+#define SAMPLING_H
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <vector>
+#include "hedge.h"
+
+// Area-weighted point sampling on the faces of a Hedge mesh.
+// Every sample is derived from (seed, sample index) only, so results are
+// identical for a given seed no matter how many threads run.
+class SurfaceSampler
+{
+public:
+    bool build(const Hedge& mesh);
+
+    // Exactly `count` samples, stratified over the faces: the running area
+    // prefix sum is cut into `count` equal steps with one random offset, so
+    // every face gets its share rounded up or down. Output is grouped by
+    // face, which keeps neighbors close in memory.
+    void sample(size_t count, uint64_t seed,
+                std::vector<glm::vec3>& outPositions,
+                std::vector<int>* outFaces = nullptr) const;
+
+    // `count` independent samples, faces drawn from the alias table
+    void sampleRandom(size_t count, uint64_t seed,
+                      std::vector<glm::vec3>& outPositions,
+                      std::vector<int>* outFaces = nullptr) const;
+
+    // Poisson-disk set with minimum distance `radius`: dense stratified
+    // candidates, thinned on a spatial hash grid. Cells in the same one of
+    // 8 phases never see each other's neighborhoods, so each phase is
+    // processed in parallel.
+    void poissonDisk(float radius, uint64_t seed,
+                     std::vector<glm::vec3>& outPositions,
+                     std::vector<int>* outFaces = nullptr) const;
+
+    double area() const { return totalArea; }
+    size_t faceCount() const { return corners.size() / 3; }
+
+private:
+    glm::vec3 pointOnFace(size_t face, uint64_t key) const;
+
+    std::vector<glm::vec3> corners;   // 3 per face, so a sample reads one cache line
+    std::vector<double> prefix;       // normalized area up to and including each face
+    std::vector<float> aliasProb;     // Vose alias table
+    std::vector<uint32_t> alias;
+    double totalArea = 0.0;
+};
+
+#endif
@@ -0,0 +1,318 @@
+#include "scene.h"
+#include "meshio.h"
+#include "meshops.h"
+#include <glm/gtc/matrix_transform.hpp>
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <future>
+#include <iostream>
+#include <limits>
+#include <sstream>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define SCENE_SSE 1
+#endif
+
+namespace {
+
+// Six normalized planes (xyz normal pointing inwards, w offset) of the
+// frustum of a view-projection matrix (Gribb & Hartmann)
+void frustumPlanes(const glm::mat4& m, glm::vec4 planes[6])
+{
+    glm::vec4 rows[4];
+    for (int i = 0; i < 4; ++i) rows[i] = glm::vec4(m[0][i], m[1][i], m[2][i], m[3][i]);
+    planes[0] = rows[3] + rows[0];   // left
+    planes[1] = rows[3] - rows[0];   // right
+    planes[2] = rows[3] + rows[1];   // bottom
+    planes[3] = rows[3] - rows[1];   // top
+    planes[4] = rows[3] + rows[2];   // near
+    planes[5] = rows[3] - rows[2];   // far
+    for (int p = 0; p < 6; ++p) {
+        float len = glm::length(glm::vec3(planes[p]));
+        if (len > 0.0f) planes[p] = planes[p] * (1.0f / len);
+    }
+}
+
+std::string directoryOf(const std::string& path)
+{
+    size_t slash = path.find_last_of("/\\");
+    return (slash == std::string::npos) ? "" : path.substr(0, slash + 1);
+}
+
+} // namespace
+
+Scene::~Scene()
+{
+    destroy();
+}
+
+void Scene::destroy()
+{
+    if (VAO) glDeleteVertexArrays(1, &VAO);
+    GLuint buffers[] = {VBO, EBO, instanceVBO};
+    for (GLuint b : buffers) {
+        if (b) glDeleteBuffers(1, &b);
+    }
+    VAO = VBO = EBO = instanceVBO = 0;
+    instanceCapacity = 0;
+}
+
+bool Scene::load(const std::string& path)
+{
+    std::ifstream file(path);
+    if (!file) {
+        std::cout << "Cannot open scene file: " << path << std::endl;
+        return false;
+    }
+
+    meshes.clear();
+    std::vector<std::pair<int, glm::mat4>> instances;
+    std::string dir = directoryOf(path);
+
+    std::string line;
+    int lineNo = 0;
+    while (std::getline(file, line))
+    {
+        lineNo++;
+        std::istringstream ss(line);
+        std::string kind;
+        if (!(ss >> kind) || kind[0] == '#') continue;
+
+        if (kind == "mesh") {
+            MeshRange m;
+            if (!(ss >> m.name >> m.path)) {
+                std::cout << path << ":" << lineNo << ": expected 'mesh <name> <path>'" << std::endl;
+                return false;
+            }
+            if (m.path.empty() || (m.path[0] != '/' && m.path.find(':') == std::string::npos)) m.path = dir + m.path;
+            meshes.push_back(m);
+        } else if (kind == "inst") {
+            std::string name;
+            glm::vec3 t(0.0f), r(0.0f);
+            float s = 1.0f;
+            if (!(ss >> name >> t.x >> t.y >> t.z)) {
+                std::cout << path << ":" << lineNo << ": expected 'inst <name> tx ty tz [rx ry rz [s]]'" << std::endl;
+                return false;
+            }
+            if (ss >> r.x >> r.y >> r.z) ss >> s;
+
+            auto it = std::find_if(meshes.begin(), meshes.end(), [&](const MeshRange& m) { return m.name == name; });
+            if (it == meshes.end()) {
+                std::cout << path << ":" << lineNo << ": unknown mesh '" << name << "'" << std::endl;
+                return false;
+            }
+            glm::mat4 model(1.0f);
+            model = glm::translate(model, t);
+            model = glm::rotate(model, glm::radians(r.z), glm::vec3(0.0f, 0.0f, 1.0f));
+            model = glm::rotate(model, glm::radians(r.y), glm::vec3(0.0f, 1.0f, 0.0f));
+            model = glm::rotate(model, glm::radians(r.x), glm::vec3(1.0f, 0.0f, 0.0f));
+            model = glm::scale(model, glm::vec3(s));
+            instances.push_back({static_cast<int>(it - meshes.begin()), model});
+        } else {
+            std::cout << path << ":" << lineNo << ": unknown directive '" << kind << "'" << std::endl;
+            return false;
+        }
+    }
+
+    // every unique mesh is read once, all of them at the same time
+    std::vector<std::vector<glm::vec3>> meshPositions(meshes.size());
+    std::vector<std::vector<unsigned int>> meshIndices(meshes.size());
+    std::vector<std::future<bool>> reads;
+    for (size_t i = 0; i < meshes.size(); ++i) {
+        reads.push_back(std::async(std::launch::async, [&, i]() {
+            return readMesh(meshes[i].path, meshPositions[i], meshIndices[i]);
+        }));
+    }
+    bool ok = true;
+    for (size_t i = 0; i < reads.size(); ++i) {
+        if (!reads[i].get()) {
+            std::cout << "Failed to load scene mesh: " << meshes[i].path << std::endl;
+            ok = false;
+        }
+    }
+    if (!ok) return false;
+
+    vertexData.clear();
+    indexData.clear();
+    for (size_t i = 0; i < meshes.size(); ++i) {
+        MeshRange& m = meshes[i];
+        const std::vector<glm::vec3>& pos = meshPositions[i];
+        std::vector<glm::vec3> normals;
+        computeVertexNormals(pos, meshIndices[i], normals);
+
+        m.baseVertex = static_cast<GLint>(vertexData.size() / 2);
+        m.firstIndex = static_cast<GLsizei>(indexData.size());
+        m.indexCount = static_cast<GLsizei>(meshIndices[i].size());
+        for (size_t v = 0; v < pos.size(); ++v) {
+            vertexData.push_back(pos[v]);
+            vertexData.push_back(normals[v]);
+        }
+        indexData.insert(indexData.end(), meshIndices[i].begin(), meshIndices[i].end());
+
+        glm::vec3 lo(std::numeric_limits<float>::max()), hi(-std::numeric_limits<float>::max());
+        for (const auto& p : pos) { lo = glm::min(lo, p); hi = glm::max(hi, p); }
+        m.sphereCenter = pos.empty() ? glm::vec3(0.0f) : (lo + hi) * 0.5f;
+        m.sphereRadius = 0.0f;
+        for (const auto& p : pos) m.sphereRadius = std::max(m.sphereRadius, glm::length(p - m.sphereCenter));
+    }
+
+    // group instances by mesh so each mesh draws one contiguous range
+    std::stable_sort(instances.begin(), instances.end(),
+                     [](const std::pair<int, glm::mat4>& a, const std::pair<int, glm::mat4>& b) { return a.first < b.first; });
+
+    size_t n = instances.size();
+    // three spare lanes, so a four wide load from any instance stays in bounds
+    size_t padded = n + 3;
+    transforms.resize(n);
+    sphereX.assign(padded, 0.0f);
+    sphereY.assign(padded, 0.0f);
+    sphereZ.assign(padded, 0.0f);
+    sphereR.assign(padded, -1.0f);   // padding lanes are never visible
+    for (auto& m : meshes) { m.firstInstance = 0; m.instanceCount = 0; }
+
+    glm::vec3 lo(std::numeric_limits<float>::max()), hi(-std::numeric_limits<float>::max());
+    for (size_t i = 0; i < n; ++i) {
+        MeshRange& m = meshes[instances[i].first];
+        if (m.instanceCount == 0) m.firstInstance = i;
+        m.instanceCount++;
+
+        const glm::mat4& model = instances[i].second;
+        transforms[i] = model;
+        glm::vec3 c = glm::vec3(model * glm::vec4(m.sphereCenter, 1.0f));
+        float scale = std::max(glm::length(glm::vec3(model[0])),
+                               std::max(glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2]))));
+        sphereX[i] = c.x;
+        sphereY[i] = c.y;
+        sphereZ[i] = c.z;
+        sphereR[i] = m.sphereRadius * scale;
+        lo = glm::min(lo, c - glm::vec3(sphereR[i]));
+        hi = glm::max(hi, c + glm::vec3(sphereR[i]));
+    }
+    sceneCenter = n ? (lo + hi) * 0.5f : glm::vec3(0.0f);
+    sceneRadius = n ? std::max(glm::length(hi - lo) * 0.5f, 1e-3f) : 1.0f;
+
+    std::cout << "Scene: " << meshes.size() << " meshes, " << n << " instances" << std::endl;
+    return true;
+}
+
+bool Scene::upload()
+{
+    destroy();
+    if (meshes.empty()) return false;
+
+    glGenVertexArrays(1, &VAO);
+    glGenBuffers(1, &VBO);
+    glGenBuffers(1, &EBO);
+    glGenBuffers(1, &instanceVBO);
+    glBindVertexArray(VAO);
+
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    glBufferData(GL_ARRAY_BUFFER, vertexData.size() * sizeof(glm::vec3), vertexData.data(), GL_STATIC_DRAW);
+    // layout (location = 0) position, 1 normal
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 2 * sizeof(glm::vec3), (void*)0);
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 2 * sizeof(glm::vec3), (void*)sizeof(glm::vec3));
+
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexData.size() * sizeof(unsigned int), indexData.data(), GL_STATIC_DRAW);
+
+    // layout (location = 2..5) instance matrix, one column per location;
+    // the pointers are set per mesh in draw()
+    glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+    for (int c = 0; c < 4; ++c) {
+        glEnableVertexAttribArray(2 + c);
+        glVertexAttribDivisor(2 + c, 1);
+    }
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    return true;
+}
+
+size_t Scene::cull(const glm::mat4& viewProjection)
+{
+    glm::vec4 planes[6];
+    frustumPlanes(viewProjection, planes);
+
+    visible.clear();
+    for (MeshRange& m : meshes)
+    {
+        m.firstVisible = visible.size();
+        size_t begin = m.firstInstance;
+        size_t end = m.firstInstance + m.instanceCount;
+
+#ifdef SCENE_SSE
+        __m128 px[6], py[6], pz[6], pw[6];
+        for (int p = 0; p < 6; ++p) {
+            px[p] = _mm_set1_ps(planes[p].x);
+            py[p] = _mm_set1_ps(planes[p].y);
+            pz[p] = _mm_set1_ps(planes[p].z);
+            pw[p] = _mm_set1_ps(planes[p].w);
+        }
+        // four spheres per step; a sphere is out once it is fully behind
+        // any plane
+        for (size_t i = begin; i < end; i += 4) {
+            __m128 x = _mm_loadu_ps(&sphereX[i]);
+            __m128 y = _mm_loadu_ps(&sphereY[i]);
+            __m128 z = _mm_loadu_ps(&sphereZ[i]);
+            __m128 negR = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(&sphereR[i]));
+            __m128 inside = _mm_cmpge_ps(negR, negR);   // all ones
+            for (int p = 0; p < 6; ++p) {
+                __m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, px[p]), _mm_mul_ps(y, py[p])),
+                                      _mm_add_ps(_mm_mul_ps(z, pz[p]), pw[p]));
+                inside = _mm_and_ps(inside, _mm_cmpgt_ps(d, negR));
+            }
+            int mask = _mm_movemask_ps(inside);
+            if (end - i < 4) mask &= (1 << (end - i)) - 1;   // lanes past this mesh
+            for (int lane = 0; mask && lane < 4; ++lane, mask >>= 1) {
+                if (mask & 1) visible.push_back(static_cast<unsigned int>(i + lane));
+            }
+        }
+#else
+        for (size_t i = begin; i < end; ++i) {
+            bool inside = true;
+            for (int p = 0; p < 6 && inside; ++p) {
+                float d = planes[p].x * sphereX[i] + planes[p].y * sphereY[i] + planes[p].z * sphereZ[i] + planes[p].w;
+                inside = d > -sphereR[i];
+            }
+            if (inside) visible.push_back(static_cast<unsigned int>(i));
+        }
+#endif
+        m.visibleCount = visible.size() - m.firstVisible;
+    }
+
+    visibleTransforms.resize(visible.size());
+    for (size_t v = 0; v < visible.size(); ++v) visibleTransforms[v] = transforms[visible[v]];
+    return visible.size();
+}
+
+void Scene::draw()
+{
+    if (!VAO || visibleTransforms.empty()) return;
+
+    // orphan the old storage so the driver does not wait on last frame
+    glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+    instanceCapacity = std::max(instanceCapacity, visibleTransforms.size());
+    glBufferData(GL_ARRAY_BUFFER, instanceCapacity * sizeof(glm::mat4), nullptr, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, visibleTransforms.size() * sizeof(glm::mat4), visibleTransforms.data());
+
+    glBindVertexArray(VAO);
+    for (const MeshRange& m : meshes)
+    {
+        if (m.visibleCount == 0) continue;
+        // GL 3.3 has no base instance, so point the matrix attributes at
+        // this mesh's slice of the instance buffer instead
+        size_t offset = m.firstVisible * sizeof(glm::mat4);
+        for (int c = 0; c < 4; ++c) {
+            glVertexAttribPointer(2 + c, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4),
+                                  (void*)(offset + c * sizeof(glm::vec4)));
+        }
+        glDrawElementsInstancedBaseVertex(GL_TRIANGLES, m.indexCount, GL_UNSIGNED_INT,
+                                          (void*)(m.firstIndex * sizeof(unsigned int)),
+                                          static_cast<GLsizei>(m.visibleCount), m.baseVertex);
+    }
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
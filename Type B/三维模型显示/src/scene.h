@@ -0,0 +1,85 @@
+#ifndef SCENE_H
+#define SCENE_H
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <string>
+#include <vector>
+
+// Many instances of a few meshes, read from a text scene file:
+//
+//   # comment
+//   mesh <name> <path>                      .obj / .ply / .stl, relative to the scene file
+//   inst <name> tx ty tz [rx ry rz [s]]     euler angles in degrees, uniform scale
+//
+// Each unique mesh is uploaded once into a shared vertex/index buffer.
+// Every frame the instances are culled against the view frustum on the
+// CPU (bounding spheres, four at a time with SSE), the surviving
+// transforms are written to one instance buffer, and each mesh is drawn
+// with a single glDrawElementsInstancedBaseVertex.
+class Scene
+{
+public:
+    Scene() = default;
+    ~Scene();
+
+    Scene(const Scene&) = delete;
+    Scene& operator=(const Scene&) = delete;
+
+    // Parse the scene file and load its meshes (no GL calls)
+    bool load(const std::string& path);
+
+    // Create the GL buffers; call with a current context after load()
+    bool upload();
+
+    // Frustum cull all instances, returns how many are visible
+    size_t cull(const glm::mat4& viewProjection);
+
+    // Upload the transforms that survived the last cull() and draw them
+    void draw();
+
+    // Free the GL objects; call while the context is still alive
+    void destroy();
+
+    size_t instanceCount() const { return transforms.size(); }
+    size_t meshCount() const { return meshes.size(); }
+    size_t visibleCount() const { return visible.size(); }
+
+    // Bounding sphere of all instances
+    glm::vec3 center() const { return sceneCenter; }
+    float radius() const { return sceneRadius; }
+
+private:
+    struct MeshRange {
+        std::string name;
+        std::string path;
+        GLint baseVertex = 0;
+        GLsizei firstIndex = 0;
+        GLsizei indexCount = 0;
+        glm::vec3 sphereCenter = glm::vec3(0.0f);  // local space
+        float sphereRadius = 0.0f;
+        size_t firstInstance = 0;                  // instances are sorted by mesh
+        size_t instanceCount = 0;
+        size_t firstVisible = 0;                   // filled by cull()
+        size_t visibleCount = 0;
+    };
+
+    std::vector<MeshRange> meshes;
+    std::vector<glm::vec3> vertexData;    // position, normal interleaved
+    std::vector<unsigned int> indexData;
+
+    // per instance, sorted by mesh
+    std::vector<glm::mat4> transforms;
+    // world space bounding spheres, structure of arrays with 3 padding lanes
+    std::vector<float> sphereX, sphereY, sphereZ, sphereR;
+
+    std::vector<unsigned int> visible;         // instance indices, grouped by mesh
+    std::vector<glm::mat4> visibleTransforms;
+
+    glm::vec3 sceneCenter = glm::vec3(0.0f);
+    float sceneRadius = 1.0f;
+
+    GLuint VAO = 0, VBO = 0, EBO = 0, instanceVBO = 0;
+    size_t instanceCapacity = 0;
+};
+
+#endif
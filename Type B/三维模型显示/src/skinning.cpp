@@ -0,0 +1,293 @@
+#include "skinning.h"
+#include "meshops.h"
+#include <glm/gtc/type_ptr.hpp>
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <limits>
+
+namespace {
+
+// Interleaved static vertex stream
+struct SkinVertex {
+    glm::vec3  position;
+    glm::vec3  normal;
+    glm::ivec4 boneIds;
+    glm::vec4  weights;
+};
+
+// One sparse morph entry, two RGBA32F texels in the texture buffer:
+// (position delta, target index) and (normal delta, 0)
+struct MorphEntry {
+    unsigned int vertex;
+    int target;
+    glm::vec3 dPos;
+    glm::vec3 dNormal;
+};
+
+// Normal deltas below this are not worth a texel fetch
+const float NORMAL_DELTA_EPS = 1e-4f;
+
+} // namespace
+
+SkinnedMesh::~SkinnedMesh()
+{
+    destroy();
+}
+
+void SkinnedMesh::destroy()
+{
+    if (VAO) glDeleteVertexArrays(1, &VAO);
+    GLuint buffers[] = {VBO, EBO, rangeVBO, paletteUBO, morphWeightUBO, deltaBuffer};
+    for (GLuint b : buffers) {
+        if (b) glDeleteBuffers(1, &b);
+    }
+    if (deltaTexture) glDeleteTextures(1, &deltaTexture);
+    VAO = VBO = EBO = rangeVBO = paletteUBO = morphWeightUBO = deltaBuffer = deltaTexture = 0;
+}
+
+bool SkinnedMesh::create(const std::vector<glm::vec3>& positions,
+                         const std::vector<unsigned int>& indices,
+                         const SkinWeights& skin,
+                         int boneCount,
+                         const std::vector<MorphTarget>& morphs)
+{
+    destroy();
+
+    if (skin.boneIds.size() != positions.size() || skin.weights.size() != positions.size()) {
+        std::cout << "SkinnedMesh: need one bone id/weight set per vertex" << std::endl;
+        return false;
+    }
+    if (boneCount < 1 || boneCount > MAX_PALETTE) {
+        std::cout << "SkinnedMesh: bone count must be 1.." << MAX_PALETTE << std::endl;
+        return false;
+    }
+    if (static_cast<int>(morphs.size()) > MAX_MORPH_WEIGHTS) {
+        std::cout << "SkinnedMesh: too many morph targets" << std::endl;
+        return false;
+    }
+
+    numBones = boneCount;
+    restPositions = positions;
+    restIndices = indices;
+    morphTargets = morphs;
+    morphDeltasDirty = true;
+
+    std::vector<glm::vec3> normals;
+    computeVertexNormals(positions, indices, normals);
+
+    // rest pose box per bone, for the lazy bounds
+    boneMin.assign(numBones, glm::vec3(std::numeric_limits<float>::max()));
+    boneMax.assign(numBones, glm::vec3(-std::numeric_limits<float>::max()));
+    std::vector<SkinVertex> verts(positions.size());
+    for (size_t i = 0; i < positions.size(); ++i) {
+        verts[i].position = positions[i];
+        verts[i].normal = normals[i];
+        verts[i].boneIds = skin.boneIds[i];
+        verts[i].weights = skin.weights[i];
+        for (int k = 0; k < 4; ++k) {
+            int b = skin.boneIds[i][k];
+            if (b < 0 || b >= numBones || skin.weights[i][k] <= 0.0f) continue;
+            boneMin[b] = glm::min(boneMin[b], positions[i]);
+            boneMax[b] = glm::max(boneMax[b], positions[i]);
+        }
+    }
+
+    morphReach.assign(morphs.size(), 0.0f);
+    for (size_t t = 0; t < morphs.size(); ++t) {
+        for (const auto& d : morphs[t].deltas) morphReach[t] = std::max(morphReach[t], glm::length(d));
+    }
+
+    glGenVertexArrays(1, &VAO);
+    glGenBuffers(1, &VBO);
+    glGenBuffers(1, &EBO);
+    glGenBuffers(1, &rangeVBO);
+    glBindVertexArray(VAO);
+
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    glBufferData(GL_ARRAY_BUFFER, verts.size() * sizeof(SkinVertex), verts.data(), GL_STATIC_DRAW);
+
+    // layout (location = 0) position, 1 normal, 2 bone ids, 3 weights
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(SkinVertex), (void*)offsetof(SkinVertex, position));
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(SkinVertex), (void*)offsetof(SkinVertex, normal));
+    glEnableVertexAttribArray(2);
+    glVertexAttribIPointer(2, 4, GL_INT, sizeof(SkinVertex), (void*)offsetof(SkinVertex, boneIds));
+    glEnableVertexAttribArray(3);
+    glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, sizeof(SkinVertex), (void*)offsetof(SkinVertex, weights));
+
+    // layout (location = 4) morph range (first entry, entry count), filled lazily
+    std::vector<glm::ivec2> noMorphs(positions.size(), glm::ivec2(0, 0));
+    glBindBuffer(GL_ARRAY_BUFFER, rangeVBO);
+    glBufferData(GL_ARRAY_BUFFER, noMorphs.size() * sizeof(glm::ivec2), noMorphs.data(), GL_STATIC_DRAW);
+    glEnableVertexAttribArray(4);
+    glVertexAttribIPointer(4, 2, GL_INT, sizeof(glm::ivec2), (void*)0);
+
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), indices.data(), GL_STATIC_DRAW);
+    indexCount = static_cast<GLsizei>(indices.size());
+    glBindVertexArray(0);
+
+    // per-instance data blocks, refilled for every batch
+    glGenBuffers(1, &paletteUBO);
+    glBindBuffer(GL_UNIFORM_BUFFER, paletteUBO);
+    glBufferData(GL_UNIFORM_BUFFER, MAX_PALETTE * sizeof(glm::mat4), nullptr, GL_STREAM_DRAW);
+    glGenBuffers(1, &morphWeightUBO);
+    glBindBuffer(GL_UNIFORM_BUFFER, morphWeightUBO);
+    glBufferData(GL_UNIFORM_BUFFER, MAX_MORPH_WEIGHTS * sizeof(float), nullptr, GL_STREAM_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+    glGenBuffers(1, &deltaBuffer);
+    glGenTextures(1, &deltaTexture);
+    return true;
+}
+
+// Build the sparse delta table on first use. Normal deltas are taken from
+// the fully applied target, so they include the neighbors of moved vertices.
+void SkinnedMesh::uploadMorphDeltas()
+{
+    morphDeltasDirty = false;
+
+    std::vector<MorphEntry> entries;
+    if (!morphTargets.empty()) {
+        std::vector<glm::vec3> baseNormals, morphedNormals;
+        computeVertexNormals(restPositions, restIndices, baseNormals);
+
+        std::vector<glm::vec3> morphed;
+        std::vector<glm::vec3> dPos(restPositions.size());
+        for (size_t t = 0; t < morphTargets.size(); ++t) {
+            const MorphTarget& m = morphTargets[t];
+            morphed = restPositions;
+            std::fill(dPos.begin(), dPos.end(), glm::vec3(0.0f));
+            for (size_t k = 0; k < m.vertices.size() && k < m.deltas.size(); ++k) {
+                if (m.vertices[k] >= restPositions.size()) continue;
+                morphed[m.vertices[k]] += m.deltas[k];
+                dPos[m.vertices[k]] += m.deltas[k];
+            }
+            computeVertexNormals(morphed, restIndices, morphedNormals);
+
+            for (size_t v = 0; v < restPositions.size(); ++v) {
+                glm::vec3 dn = morphedNormals[v] - baseNormals[v];
+                if (dPos[v] == glm::vec3(0.0f) && glm::dot(dn, dn) < NORMAL_DELTA_EPS * NORMAL_DELTA_EPS) continue;
+                entries.push_back({static_cast<unsigned int>(v), static_cast<int>(t), dPos[v], dn});
+            }
+        }
+    }
+
+    std::stable_sort(entries.begin(), entries.end(),
+                     [](const MorphEntry& a, const MorphEntry& b) { return a.vertex < b.vertex; });
+
+    std::vector<glm::ivec2> ranges(restPositions.size(), glm::ivec2(0, 0));
+    std::vector<glm::vec4> texels(entries.size() * 2);
+    for (size_t i = 0; i < entries.size(); ++i) {
+        glm::ivec2& r = ranges[entries[i].vertex];
+        if (r.y == 0) r.x = static_cast<int>(i);
+        r.y++;
+        texels[i * 2]     = glm::vec4(entries[i].dPos, static_cast<float>(entries[i].target));
+        texels[i * 2 + 1] = glm::vec4(entries[i].dNormal, 0.0f);
+    }
+    if (texels.empty()) texels.push_back(glm::vec4(0.0f));   // keep the texture valid
+
+    glBindBuffer(GL_ARRAY_BUFFER, rangeVBO);
+    glBufferData(GL_ARRAY_BUFFER, ranges.size() * sizeof(glm::ivec2), ranges.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    glBindBuffer(GL_TEXTURE_BUFFER, deltaBuffer);
+    glBufferData(GL_TEXTURE_BUFFER, texels.size() * sizeof(glm::vec4), texels.data(), GL_STATIC_DRAW);
+    glBindTexture(GL_TEXTURE_BUFFER, deltaTexture);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, deltaBuffer);
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+void SkinnedMesh::draw(GLuint program, const std::vector<SkinInstance>& instances)
+{
+    if (!VAO || instances.empty()) return;
+    if (morphDeltasDirty) uploadMorphDeltas();
+
+    glUseProgram(program);
+    GLuint paletteBlock = glGetUniformBlockIndex(program, "SkinPalette");
+    GLuint weightBlock = glGetUniformBlockIndex(program, "MorphWeights");
+    if (paletteBlock != GL_INVALID_INDEX) glUniformBlockBinding(program, paletteBlock, 0);
+    if (weightBlock != GL_INVALID_INDEX) glUniformBlockBinding(program, weightBlock, 1);
+    glBindBufferBase(GL_UNIFORM_BUFFER, 0, paletteUBO);
+    glBindBufferBase(GL_UNIFORM_BUFFER, 1, morphWeightUBO);
+
+    int targets = morphCount();
+    glUniform1i(glGetUniformLocation(program, "uBonesPerInstance"), numBones);
+    glUniform1i(glGetUniformLocation(program, "uTargetsPerInstance"), targets);
+    glUniform1i(glGetUniformLocation(program, "uMorphDeltas"), 1);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_BUFFER, deltaTexture);
+    glActiveTexture(GL_TEXTURE0);
+
+    // as many instances per draw as both blocks can hold
+    size_t perBatch = MAX_PALETTE / numBones;
+    if (targets > 0) perBatch = std::min<size_t>(perBatch, MAX_MORPH_WEIGHTS / targets);
+
+    std::vector<glm::mat4> palettes(perBatch * numBones);
+    std::vector<float> weights(std::max<size_t>(perBatch * targets, 1));
+
+    glBindVertexArray(VAO);
+    for (size_t first = 0; first < instances.size(); first += perBatch)
+    {
+        size_t count = std::min(perBatch, instances.size() - first);
+        for (size_t i = 0; i < count; ++i) {
+            const SkinInstance& inst = instances[first + i];
+            for (int b = 0; b < numBones; ++b) {
+                palettes[i * numBones + b] = b < static_cast<int>(inst.palette.size()) ? inst.palette[b] : glm::mat4(1.0f);
+            }
+            for (int t = 0; t < targets; ++t) {
+                weights[i * targets + t] = t < static_cast<int>(inst.morphWeights.size()) ? inst.morphWeights[t] : 0.0f;
+            }
+        }
+
+        // orphan, then fill: the previous batch may still be in flight
+        glBindBuffer(GL_UNIFORM_BUFFER, paletteUBO);
+        glBufferData(GL_UNIFORM_BUFFER, MAX_PALETTE * sizeof(glm::mat4), nullptr, GL_STREAM_DRAW);
+        glBufferSubData(GL_UNIFORM_BUFFER, 0, count * numBones * sizeof(glm::mat4), palettes.data());
+        if (targets > 0) {
+            glBindBuffer(GL_UNIFORM_BUFFER, morphWeightUBO);
+            glBufferData(GL_UNIFORM_BUFFER, MAX_MORPH_WEIGHTS * sizeof(float), nullptr, GL_STREAM_DRAW);
+            glBufferSubData(GL_UNIFORM_BUFFER, 0, count * targets * sizeof(float), weights.data());
+        }
+
+        glDrawElementsInstanced(GL_TRIANGLES, indexCount, GL_UNSIGNED_INT, (void*)0, static_cast<GLsizei>(count));
+    }
+    glBindVertexArray(0);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+void SkinnedMesh::bounds(SkinInstance& instance) const
+{
+    if (!instance.boundsDirty) return;
+    instance.boundsDirty = false;
+
+    glm::vec3 lo(std::numeric_limits<float>::max());
+    glm::vec3 hi(-std::numeric_limits<float>::max());
+
+    // morphs run before skinning; grow every bone box by their reach
+    float reach = 0.0f;
+    for (size_t t = 0; t < morphReach.size() && t < instance.morphWeights.size(); ++t) {
+        reach += std::abs(instance.morphWeights[t]) * morphReach[t];
+    }
+
+    for (int b = 0; b < numBones; ++b) {
+        if (boneMin[b].x > boneMax[b].x) continue;   // bone moves no vertex
+        glm::mat4 m = b < static_cast<int>(instance.palette.size()) ? instance.palette[b] : glm::mat4(1.0f);
+        glm::vec3 bmin = boneMin[b] - glm::vec3(reach);
+        glm::vec3 bmax = boneMax[b] + glm::vec3(reach);
+        for (int corner = 0; corner < 8; ++corner) {
+            glm::vec3 c((corner & 1) ? bmax.x : bmin.x,
+                        (corner & 2) ? bmax.y : bmin.y,
+                        (corner & 4) ? bmax.z : bmin.z);
+            glm::vec3 w = glm::vec3(m * glm::vec4(c, 1.0f));
+            lo = glm::min(lo, w);
+            hi = glm::max(hi, w);
+        }
+    }
+
+    instance.boundsMin = lo;
+    instance.boundsMax = hi;
+}
@@ -0,0 +1,93 @@
+#ifndef SKINNING_H
+#define SKINNING_H
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <vector>
+
+// Up to four bone influences per vertex
+struct SkinWeights
+{
+    std::vector<glm::ivec4> boneIds;   // one per vertex
+    std::vector<glm::vec4>  weights;   // one per vertex, should sum to 1
+};
+
+// Sparse blend shape: only the vertices it moves are stored
+struct MorphTarget
+{
+    std::vector<unsigned int> vertices;
+    std::vector<glm::vec3>    deltas;    // same size as vertices
+};
+
+// Pose of one drawn copy of a SkinnedMesh
+struct SkinInstance
+{
+    // Skin matrices (model * bone pose * inverse bind), one per bone
+    std::vector<glm::mat4> palette;
+    // One weight per morph target
+    std::vector<float> morphWeights;
+
+    // Call after changing palette or morphWeights
+    void markDirty() { boundsDirty = true; }
+
+    // World space bounds, refreshed by SkinnedMesh::bounds() when dirty
+    glm::vec3 boundsMin = glm::vec3(0.0f);
+    glm::vec3 boundsMax = glm::vec3(0.0f);
+    bool boundsDirty = true;
+};
+
+// Mesh deformed entirely in the vertex shader (resources/shaders/skinned.vert).
+// Bone palettes and morph weights of many instances go into uniform buffers
+// and are drawn with glDrawElementsInstanced; the sparse morph deltas live in
+// a texture buffer. No vertex data is touched on the CPU per frame.
+class SkinnedMesh
+{
+public:
+    // Must match the array sizes in skinned.vert (16 KiB per block,
+    // the minimum GL_MAX_UNIFORM_BLOCK_SIZE)
+    static const int MAX_PALETTE = 256;
+    static const int MAX_MORPH_WEIGHTS = 1024;
+
+    SkinnedMesh() = default;
+    ~SkinnedMesh();
+
+    SkinnedMesh(const SkinnedMesh&) = delete;
+    SkinnedMesh& operator=(const SkinnedMesh&) = delete;
+
+    bool create(const std::vector<glm::vec3>& positions,
+                const std::vector<unsigned int>& indices,
+                const SkinWeights& skin,
+                int boneCount,
+                const std::vector<MorphTarget>& morphs);
+
+    // Draw all instances, batching as many as fit in the uniform blocks
+    void draw(GLuint program, const std::vector<SkinInstance>& instances);
+
+    // Conservative world space bounds of an instance, recomputed only
+    // when the instance is dirty
+    void bounds(SkinInstance& instance) const;
+
+    // Free the GL objects; call while the context is still alive
+    void destroy();
+
+    int boneCount() const { return numBones; }
+    int morphCount() const { return static_cast<int>(morphTargets.size()); }
+
+private:
+    void uploadMorphDeltas();
+
+    GLuint VAO = 0, VBO = 0, EBO = 0, rangeVBO = 0;
+    GLuint paletteUBO = 0, morphWeightUBO = 0;
+    GLuint deltaBuffer = 0, deltaTexture = 0;
+    GLsizei indexCount = 0;
+    int numBones = 0;
+
+    // kept for the lazy morph normal deltas and bounds
+    std::vector<glm::vec3> restPositions;
+    std::vector<unsigned int> restIndices;
+    std::vector<MorphTarget> morphTargets;
+    std::vector<glm::vec3> boneMin, boneMax;   // rest pose box per bone
+    std::vector<float> morphReach;             // longest delta per target
+    bool morphDeltasDirty = true;
+};
+
+#endif
@@ -0,0 +1,328 @@
+#include "sparse_cholesky.h"
+#include "parallel.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <iostream>
+#include <limits>
+
+namespace {
+
+// Sets at or below this size are numbered as they are
+const size_t ND_LEAF_SIZE = 64;
+
+// Elimination subtrees handed to the factor threads: about this many per
+// worker, none smaller than n / SUBTREE_MIN_FRACTION
+const size_t SUBTREES_PER_WORKER = 4;
+const size_t SUBTREE_MIN_FRACTION = 256;
+
+struct Dissector
+{
+    const SparseMatrix& A;
+    const std::vector<glm::vec3>& points;
+    std::vector<int>& order;
+    std::vector<unsigned int> stamp;   // which call last touched a vertex
+    std::vector<unsigned char> right;  // side of the split in that call
+    unsigned int nextStamp = 0;
+
+    Dissector(const SparseMatrix& a, const std::vector<glm::vec3>& p, std::vector<int>& o)
+        : A(a), points(p), order(o), stamp(a.n, 0), right(a.n, 0) {}
+
+    void run(std::vector<int>& set)
+    {
+        if (set.size() <= ND_LEAF_SIZE) {
+            order.insert(order.end(), set.begin(), set.end());
+            return;
+        }
+
+        glm::vec3 lo(std::numeric_limits<float>::max());
+        glm::vec3 hi(-std::numeric_limits<float>::max());
+        for (int v : set) {
+            lo = glm::min(lo, points[v]);
+            hi = glm::max(hi, points[v]);
+        }
+        glm::vec3 extent = hi - lo;
+        int axis = 0;
+        if (extent.y > extent[axis]) axis = 1;
+        if (extent.z > extent[axis]) axis = 2;
+
+        size_t mid = set.size() / 2;
+        std::nth_element(set.begin(), set.begin() + mid, set.end(),
+                         [&](int a, int b) { return points[a][axis] < points[b][axis]; });
+
+        unsigned int s = ++nextStamp;
+        for (size_t i = 0; i < set.size(); ++i) {
+            stamp[set[i]] = s;
+            right[set[i]] = i >= mid;
+        }
+
+        // left vertices with a neighbor on the right form the separator
+        std::vector<int> left, separator;
+        for (size_t i = 0; i < mid; ++i) {
+            int v = set[i];
+            bool touches = false;
+            for (int p = A.colPtr[v]; p < A.colPtr[v + 1] && !touches; ++p) {
+                int u = A.rowIdx[p];
+                touches = stamp[u] == s && right[u];
+            }
+            (touches ? separator : left).push_back(v);
+        }
+        std::vector<int> rightSet(set.begin() + mid, set.end());
+        std::vector<int>().swap(set);
+
+        run(left);
+        run(rightSet);
+        order.insert(order.end(), separator.begin(), separator.end());
+    }
+};
+
+} // namespace
+
+void nestedDissectionOrder(const SparseMatrix& A,
+                           const std::vector<glm::vec3>& points,
+                           std::vector<int>& order)
+{
+    order.clear();
+    order.reserve(A.n);
+    std::vector<int> all(A.n);
+    for (int i = 0; i < A.n; ++i) all[i] = i;
+
+    if (static_cast<int>(points.size()) < A.n) {
+        order = all;   // no geometry, keep the natural order
+        return;
+    }
+
+    Dissector d(A, points, order);
+    d.run(all);
+}
+
+// Nonzero pattern of row k of L, in topological order, in stack[top..n).
+// Walks up the elimination tree from every entry of column k of C.
+int SparseCholesky::ereach(int k, std::vector<int>& stack, std::vector<int>& mark) const
+{
+    int top = n;
+    mark[k] = k;
+    for (int p = Cp[k]; p < Cp[k + 1]; ++p) {
+        int i = Ci[p];
+        int len = 0;
+        for (; mark[i] != k; i = parent[i]) {
+            stack[len++] = i;
+            mark[i] = k;
+        }
+        while (len > 0) stack[--top] = stack[--len];
+    }
+    return top;
+}
+
+bool SparseCholesky::analyze(const SparseMatrix& A, const std::vector<int>& order)
+{
+    factored = false;
+    n = A.n;
+    if (static_cast<int>(order.size()) != n) {
+        std::cout << "SparseCholesky: ordering does not match the matrix" << std::endl;
+        return false;
+    }
+
+    perm = order;
+    std::vector<int> pinv(n, -1);
+    for (int i = 0; i < n; ++i) pinv[perm[i]] = i;
+
+    // upper triangle of the permuted matrix, remembering where each
+    // value comes from so factor() only has to gather
+    Cp.assign(n + 1, 0);
+    for (int j = 0; j < n; ++j) {
+        for (int p = A.colPtr[j]; p < A.colPtr[j + 1]; ++p) {
+            int ni = pinv[A.rowIdx[p]], nj = pinv[j];
+            if (ni <= nj) Cp[nj + 1]++;
+        }
+    }
+    for (int j = 0; j < n; ++j) Cp[j + 1] += Cp[j];
+
+    Ci.resize(Cp[n]);
+    valueMap.resize(Cp[n]);
+    Cx.resize(Cp[n]);
+    std::vector<int> next(Cp.begin(), Cp.end() - 1);
+    for (int j = 0; j < n; ++j) {
+        for (int p = A.colPtr[j]; p < A.colPtr[j + 1]; ++p) {
+            int ni = pinv[A.rowIdx[p]], nj = pinv[j];
+            if (ni > nj) continue;
+            int slot = next[nj]++;
+            Ci[slot] = ni;
+            valueMap[slot] = p;
+        }
+    }
+
+    // elimination tree, with path compression through ancestor
+    parent.assign(n, -1);
+    std::vector<int> ancestor(n, -1);
+    for (int k = 0; k < n; ++k) {
+        for (int p = Cp[k]; p < Cp[k + 1]; ++p) {
+            for (int i = Ci[p]; i != -1 && i < k;) {
+                int inext = ancestor[i];
+                ancestor[i] = k;
+                if (inext == -1) parent[i] = k;
+                i = inext;
+            }
+        }
+    }
+
+    // column counts of L from the row patterns
+    std::vector<int> counts(n, 1);   // diagonal
+    std::vector<int> stack(n), mark(n, -1);
+    for (int k = 0; k < n; ++k) {
+        for (int top = ereach(k, stack, mark); top < n; ++top) counts[stack[top]]++;
+    }
+
+    Lp.assign(n + 1, 0);
+    for (int j = 0; j < n; ++j) Lp[j + 1] = Lp[j] + counts[j];
+    Li.resize(Lp[n]);
+    Lx.resize(Lp[n]);
+
+    // Row k only reads rows of its own descendants, so disjoint subtrees
+    // can be factored independently. Split the largest subtree at its root
+    // until there is enough work to go around.
+    std::vector<int> childStart(n + 1, 0), children(n), subtreeSize(n, 1);
+    std::vector<int> roots;
+    for (int j = 0; j < n; ++j) {
+        if (parent[j] == -1) roots.push_back(j);
+        else childStart[parent[j] + 1]++;
+    }
+    for (int j = 0; j < n; ++j) childStart[j + 1] += childStart[j];
+    {
+        std::vector<int> next(childStart.begin(), childStart.end() - 1);
+        for (int j = 0; j < n; ++j) {
+            if (parent[j] != -1) children[next[parent[j]]++] = j;
+        }
+    }
+    for (int j = 0; j < n; ++j) {   // children always come before parents
+        if (parent[j] != -1) subtreeSize[parent[j]] += subtreeSize[j];
+    }
+
+    auto smaller = [&](int a, int b) { return subtreeSize[a] < subtreeSize[b]; };
+    std::vector<int> heap = roots;
+    std::make_heap(heap.begin(), heap.end(), smaller);
+    size_t wanted = workerCount() * SUBTREES_PER_WORKER;
+    size_t minSize = std::max<size_t>(n / SUBTREE_MIN_FRACTION, 1);
+    topRows.clear();
+    while (!heap.empty() && heap.size() < wanted && static_cast<size_t>(subtreeSize[heap.front()]) > minSize) {
+        std::pop_heap(heap.begin(), heap.end(), smaller);
+        int r = heap.back();
+        heap.pop_back();
+        topRows.push_back(r);
+        for (int p = childStart[r]; p < childStart[r + 1]; ++p) {
+            heap.push_back(children[p]);
+            std::push_heap(heap.begin(), heap.end(), smaller);
+        }
+    }
+    std::sort(topRows.begin(), topRows.end());
+
+    // largest first, so the work queue ends with the short tasks
+    std::sort(heap.begin(), heap.end(), [&](int a, int b) { return subtreeSize[a] > subtreeSize[b]; });
+    subtreeRows.assign(heap.size(), std::vector<int>());
+    std::vector<int> dfs;
+    for (size_t s = 0; s < heap.size(); ++s) {
+        std::vector<int>& rows = subtreeRows[s];
+        rows.reserve(subtreeSize[heap[s]]);
+        dfs.assign(1, heap[s]);
+        while (!dfs.empty()) {
+            int j = dfs.back();
+            dfs.pop_back();
+            rows.push_back(j);
+            for (int p = childStart[j]; p < childStart[j + 1]; ++p) dfs.push_back(children[p]);
+        }
+        std::sort(rows.begin(), rows.end());
+    }
+    return true;
+}
+
+// Up-looking factorization: row k of L is a sparse triangular solve
+// against the rows above it, restricted to the pattern from ereach().
+// Rows must come in increasing order so every column fills top down.
+bool SparseCholesky::factorRows(const std::vector<int>& rows, std::vector<int>& c, std::vector<int>& stack,
+                                std::vector<int>& mark, std::vector<double>& x)
+{
+    for (int k : rows) {
+        int top = ereach(k, stack, mark);
+        x[k] = 0.0;
+        for (int p = Cp[k]; p < Cp[k + 1]; ++p) x[Ci[p]] += Cx[p];
+
+        double d = x[k];
+        x[k] = 0.0;
+        for (; top < n; ++top) {
+            int i = stack[top];
+            double lki = x[i] / Lx[Lp[i]];
+            x[i] = 0.0;
+            for (int p = Lp[i] + 1; p < c[i]; ++p) x[Li[p]] -= Lx[p] * lki;
+            d -= lki * lki;
+            int p = c[i]++;
+            Li[p] = k;
+            Lx[p] = lki;
+        }
+
+        if (!(d > 0.0)) {
+            std::cout << "SparseCholesky: matrix is not positive definite (pivot " << k << ")" << std::endl;
+            return false;
+        }
+        int p = c[k]++;
+        Li[p] = k;
+        Lx[p] = std::sqrt(d);
+    }
+    return true;
+}
+
+bool SparseCholesky::factor(const SparseMatrix& A)
+{
+    factored = false;
+    if (A.n != n || Cp.empty()) {
+        std::cout << "SparseCholesky: factor() before analyze()" << std::endl;
+        return false;
+    }
+    for (size_t p = 0; p < Cx.size(); ++p) Cx[p] = A.values[valueMap[p]];
+
+    // Subtrees touch disjoint rows and columns, so c, mark and x can be
+    // shared; only the ereach stack is per thread
+    std::vector<int> c(Lp.begin(), Lp.end() - 1);   // next free slot per column
+    std::vector<int> mark(n, -1);
+    std::vector<double> x(n, 0.0);
+
+    std::atomic<size_t> nextTask{0};
+    std::atomic<bool> ok{true};
+    parallelFor(std::min<size_t>(workerCount(), subtreeRows.size()), 1, [&](size_t begin, size_t end) {
+        for (size_t w = begin; w < end; ++w) {
+            std::vector<int> stack(n);
+            for (size_t s = nextTask++; s < subtreeRows.size() && ok; s = nextTask++) {
+                if (!factorRows(subtreeRows[s], c, stack, mark, x)) ok = false;
+            }
+        }
+    });
+    if (!ok) return false;
+
+    std::vector<int> stack(n);
+    if (!factorRows(topRows, c, stack, mark, x)) return false;
+
+    factored = true;
+    return true;
+}
+
+void SparseCholesky::solve(std::vector<double>& b) const
+{
+    if (!factored || static_cast<int>(b.size()) != n) return;
+
+    std::vector<double> x(n);
+    for (int i = 0; i < n; ++i) x[i] = b[perm[i]];
+
+    // L y = P b
+    for (int j = 0; j < n; ++j) {
+        x[j] /= Lx[Lp[j]];
+        double xj = x[j];
+        for (int p = Lp[j] + 1; p < Lp[j + 1]; ++p) x[Li[p]] -= Lx[p] * xj;
+    }
+    // L^T z = y
+    for (int j = n - 1; j >= 0; --j) {
+        double xj = x[j];
+        for (int p = Lp[j] + 1; p < Lp[j + 1]; ++p) xj -= Lx[p] * x[Li[p]];
+        x[j] = xj / Lx[Lp[j]];
+    }
+
+    for (int i = 0; i < n; ++i) b[perm[i]] = x[i];
+}
@@ -0,0 +1,68 @@
+#ifndef SPARSE_CHOLESKY_H
+#define SPARSE_CHOLESKY_H
+#include <glm/glm.hpp>
+#include <vector>
+#include <cstddef>
+
+// Symmetric sparse matrix in compressed sparse column form. Both triangles
+// are stored; row indices inside a column are sorted.
+struct SparseMatrix
+{
+    int n = 0;
+    std::vector<int>    colPtr;   // size = n + 1
+    std::vector<int>    rowIdx;
+    std::vector<double> values;   // same size as rowIdx
+};
+
+// Fill reducing ordering for a matrix whose rows belong to points in space
+// (mesh vertices): recursive bisection along the longest axis, with the
+// vertices that touch the other half numbered last. order[new] = old.
+void nestedDissectionOrder(const SparseMatrix& A,
+                           const std::vector<glm::vec3>& points,
+                           std::vector<int>& order);
+
+// Sparse LL^T factorization of a symmetric positive definite matrix.
+// analyze() does the ordering dependent work once per sparsity pattern;
+// factor() can then be called for any matrix with that pattern, and
+// solve() is two triangular sweeps.
+class SparseCholesky
+{
+public:
+    // order[new] = old, e.g. from nestedDissectionOrder
+    bool analyze(const SparseMatrix& A, const std::vector<int>& order);
+
+    // Returns false if the matrix is not positive definite
+    bool factor(const SparseMatrix& A);
+
+    // Solve A x = b in place
+    void solve(std::vector<double>& b) const;
+
+    bool isFactored() const { return factored; }
+    int size() const { return n; }
+    size_t nonZeros() const { return Li.size(); }
+
+private:
+    int ereach(int k, std::vector<int>& stack, std::vector<int>& mark) const;
+    bool factorRows(const std::vector<int>& rows, std::vector<int>& c, std::vector<int>& stack,
+                    std::vector<int>& mark, std::vector<double>& x);
+
+    int n = 0;
+    bool factored = false;
+    std::vector<int> perm;       // perm[new] = old
+    std::vector<int> parent;     // elimination tree
+
+    // Rows of disjoint elimination subtrees are factored in parallel,
+    // the rows above them (topRows) afterwards
+    std::vector<std::vector<int>> subtreeRows;
+    std::vector<int> topRows;
+
+    // upper triangle of P A P^T, values taken from A through valueMap
+    std::vector<int> Cp, Ci, valueMap;
+    std::vector<double> Cx;
+
+    // L by columns, diagonal first in each column
+    std::vector<int> Lp, Li;
+    std::vector<double> Lx;
+};
+
+#endif
@@ -0,0 +1,384 @@
+#include "hedge.h"
+#include "parallel.h"
+#include <algorithm>
+#include <cstdint>
+#include <numeric>
+
+// Longest face loop accepted before a cycle is considered broken
+static const int MAX_FACE_DEGREE = 64;
+
+const char* topologyIssueName(TopologyIssueKind kind)
+{
+    switch (kind) {
+        case TopologyIssueKind::DanglingPointer:         return "dangling_pointer";
+        case TopologyIssueKind::BrokenCycle:             return "broken_cycle";
+        case TopologyIssueKind::TwinAsymmetric:          return "twin_asymmetric";
+        case TopologyIssueKind::TwinMismatch:            return "twin_mismatch";
+        case TopologyIssueKind::WrongVertex:             return "wrong_vertex";
+        case TopologyIssueKind::BadVertexEdge:           return "bad_vertex_edge";
+        case TopologyIssueKind::InconsistentOrientation: return "inconsistent_orientation";
+        case TopologyIssueKind::NonManifoldEdge:         return "non_manifold_edge";
+        case TopologyIssueKind::NonManifoldVertex:       return "non_manifold_vertex";
+        default:                                         return "unknown";
+    }
+}
+
+bool TopologyReport::ok() const
+{
+    for (size_t c : counts) {
+        if (c != 0) return false;
+    }
+    return true;
+}
+
+namespace {
+
+// Issues found by one chunk of a parallel pass
+struct ChunkIssues {
+    size_t counts[static_cast<int>(TopologyIssueKind::Count)] = {};
+    std::vector<TopologyIssue> issues;
+    size_t boundary = 0;
+
+    void add(TopologyIssueKind kind, size_t element, size_t maxIssues) {
+        counts[static_cast<int>(kind)]++;
+        if (issues.size() < maxIssues) issues.push_back({kind, static_cast<int>(element)});
+    }
+};
+
+template <class T>
+bool owns(const std::vector<const T*>& sorted, const T* p)
+{
+    return p && std::binary_search(sorted.begin(), sorted.end(), p);
+}
+
+// One record per half-edge, keyed by its undirected vertex pair
+struct EdgeRecord {
+    uint64_t key;
+    unsigned int item;   // half-edge index (validate) or face index (repair)
+    bool forward;        // from < to
+};
+
+uint64_t undirectedKey(unsigned int a, unsigned int b)
+{
+    unsigned int lo = std::min(a, b), hi = std::max(a, b);
+    return (static_cast<uint64_t>(lo) << 32) | hi;
+}
+
+void sortRecords(std::vector<EdgeRecord>& recs)
+{
+    std::sort(recs.begin(), recs.end(), [](const EdgeRecord& x, const EdgeRecord& y) {
+        return x.key < y.key || (x.key == y.key && x.item < y.item);
+    });
+}
+
+struct UnionFind {
+    std::vector<unsigned int> parent;
+
+    explicit UnionFind(size_t n) : parent(n) { std::iota(parent.begin(), parent.end(), 0u); }
+
+    unsigned int find(unsigned int x) {
+        while (parent[x] != x) {
+            parent[x] = parent[parent[x]];
+            x = parent[x];
+        }
+        return x;
+    }
+
+    void unite(unsigned int a, unsigned int b) {
+        a = find(a);
+        b = find(b);
+        if (a != b) parent[std::max(a, b)] = std::min(a, b);
+    }
+};
+
+} // namespace
+
+bool Hedge::validate(TopologyReport& report, size_t maxIssues) const
+{
+    report = TopologyReport();
+
+    // sorted pointer tables, so every pointer can be checked for ownership
+    std::vector<const HalfEdge*> edgeSet(edges.begin(), edges.end());
+    std::vector<const HEFace*>   faceSet(faces.begin(), faces.end());
+    std::vector<const HEVertex*> vertSet(vertices.begin(), vertices.end());
+    std::sort(edgeSet.begin(), edgeSet.end());
+    std::sort(faceSet.begin(), faceSet.end());
+    std::sort(vertSet.begin(), vertSet.end());
+
+    const int numVerts = static_cast<int>(vertices.size());
+    size_t chunkCount = workerCount() * 4;
+    std::vector<ChunkIssues> edgeResults(chunkCount);
+    std::vector<char> edgeUsable(edges.size(), 0);
+
+    // ---- per half-edge invariants
+    parallelChunks(edges.size(), chunkCount, [&](size_t c, size_t begin, size_t end) {
+        ChunkIssues& r = edgeResults[c];
+        for (size_t i = begin; i < end; ++i) {
+            const HalfEdge* e = edges[i];
+            if (!e || !owns(edgeSet, e->next) || !owns(edgeSet, e->prev) ||
+                !owns(faceSet, e->face) || !owns(vertSet, e->vert) ||
+                (e->twin && !owns(edgeSet, e->twin)))
+            {
+                r.add(TopologyIssueKind::DanglingPointer, i, maxIssues);
+                continue;
+            }
+
+            // next/prev form one closed loop on this face
+            bool cycleOk = e->next->prev == e && e->prev->next == e;
+            const HalfEdge* w = e->next;
+            for (int steps = 1; cycleOk && w != e; ++steps) {
+                if (steps > MAX_FACE_DEGREE || w->face != e->face || !owns(edgeSet, w->next)) cycleOk = false;
+                else w = w->next;
+            }
+            if (!cycleOk) r.add(TopologyIssueKind::BrokenCycle, i, maxIssues);
+
+            bool vertexOk = e->toIndex >= 0 && e->toIndex < numVerts &&
+                            e->fromIndex >= 0 && e->fromIndex < numVerts &&
+                            vertices[e->toIndex] == e->vert &&
+                            e->prev->toIndex == e->fromIndex;
+            if (!vertexOk) r.add(TopologyIssueKind::WrongVertex, i, maxIssues);
+
+            if (!e->twin) {
+                r.boundary++;
+            } else {
+                if (e->twin->twin != e) r.add(TopologyIssueKind::TwinAsymmetric, i, maxIssues);
+                if (e->twin->fromIndex != e->toIndex || e->twin->toIndex != e->fromIndex)
+                    r.add(TopologyIssueKind::TwinMismatch, i, maxIssues);
+            }
+
+            edgeUsable[i] = cycleOk && vertexOk;
+        }
+    });
+
+    // ---- edges shared by the wrong number of faces or in the wrong direction
+    std::vector<EdgeRecord> recs;
+    recs.reserve(edges.size());
+    for (size_t i = 0; i < edges.size(); ++i) {
+        if (!edgeUsable[i]) continue;
+        const HalfEdge* e = edges[i];
+        recs.push_back({undirectedKey(e->fromIndex, e->toIndex), static_cast<unsigned int>(i),
+                        e->fromIndex < e->toIndex});
+    }
+    sortRecords(recs);
+
+    ChunkIssues edgeShare;
+    for (size_t i = 0; i < recs.size();) {
+        size_t j = i + 1;
+        while (j < recs.size() && recs[j].key == recs[i].key) ++j;
+        if (j - i > 2) {
+            for (size_t k = i; k < j; ++k) edgeShare.add(TopologyIssueKind::NonManifoldEdge, recs[k].item, maxIssues);
+        } else if (j - i == 2 && recs[i].forward == recs[i + 1].forward) {
+            edgeShare.add(TopologyIssueKind::InconsistentOrientation, recs[i + 1].item, maxIssues);
+        }
+        i = j;
+    }
+
+    // ---- one-ring closure: rotating around a vertex must reach all of
+    // its outgoing half-edges, otherwise the faces form several fans
+    std::vector<int> degree(vertices.size(), 0);
+    for (size_t i = 0; i < edges.size(); ++i) {
+        if (edgeUsable[i]) degree[edges[i]->fromIndex]++;
+    }
+
+    std::vector<ChunkIssues> vertResults(chunkCount);
+    parallelChunks(vertices.size(), chunkCount, [&](size_t c, size_t begin, size_t end) {
+        ChunkIssues& r = vertResults[c];
+        for (size_t vi = begin; vi < end; ++vi) {
+            const HEVertex* v = vertices[vi];
+            if (!v) {
+                r.add(TopologyIssueKind::DanglingPointer, vi, maxIssues);
+                continue;
+            }
+            if (!v->edge) {
+                if (degree[vi] > 0) r.add(TopologyIssueKind::BadVertexEdge, vi, maxIssues);
+                continue;
+            }
+            // an outgoing edge whose prev and twin can be followed; the edge
+            // pass reports whatever is wrong with the others
+            auto outgoingOk = [&](const HalfEdge* h) {
+                return owns(edgeSet, h) && h->fromIndex == static_cast<int>(vi) && h->next &&
+                       owns(edgeSet, h->prev) &&
+                       (!h->twin || owns(edgeSet, h->twin));
+            };
+            if (!outgoingOk(v->edge)) {
+                r.add(TopologyIssueKind::BadVertexEdge, vi, maxIssues);
+                continue;
+            }
+
+            int visited = 1;
+            bool closed = false;
+            const HalfEdge* h = v->edge;
+            // clockwise: the twin of the incoming edge
+            while (visited <= degree[vi]) {
+                const HalfEdge* n = h->prev->twin;
+                if (!n || !outgoingOk(n)) break;
+                if (n == v->edge) {
+                    closed = true;
+                    break;
+                }
+                h = n;
+                visited++;
+            }
+            if (!closed) {
+                // open fan: walk the other way from the start
+                h = v->edge;
+                while (visited <= degree[vi]) {
+                    if (!h->twin) break;
+                    const HalfEdge* n = h->twin->next;
+                    if (!n || !outgoingOk(n) || n == v->edge) break;
+                    h = n;
+                    visited++;
+                }
+            }
+            if (visited != degree[vi]) r.add(TopologyIssueKind::NonManifoldVertex, vi, maxIssues);
+        }
+    });
+
+    // ---- merge
+    auto merge = [&](const ChunkIssues& r) {
+        for (int k = 0; k < static_cast<int>(TopologyIssueKind::Count); ++k) report.counts[k] += r.counts[k];
+        report.boundaryEdges += r.boundary;
+        for (const auto& issue : r.issues) {
+            if (report.issues.size() >= maxIssues) break;
+            report.issues.push_back(issue);
+        }
+    };
+    for (const auto& r : edgeResults) merge(r);
+    merge(edgeShare);
+    for (const auto& r : vertResults) merge(r);
+
+    return report.ok();
+}
+
+RepairStats Hedge::repair()
+{
+    RepairStats stats;
+
+    std::vector<glm::vec3> positions;
+    std::vector<unsigned int> indices;
+    buildVertexArray(positions);
+    buildFaceIndexArray(indices);
+    size_t numFaces = indices.size() / 3;
+    if (numFaces == 0) return stats;
+
+    // ---- undirected edge records, three per face
+    std::vector<EdgeRecord> recs(numFaces * 3);
+    parallelFor(numFaces, 16384, [&](size_t begin, size_t end) {
+        for (size_t f = begin; f < end; ++f) {
+            for (int k = 0; k < 3; ++k) {
+                unsigned int a = indices[f * 3 + k];
+                unsigned int b = indices[f * 3 + (k + 1) % 3];
+                recs[f * 3 + k] = {undirectedKey(a, b), static_cast<unsigned int>(f), a < b};
+            }
+        }
+    });
+    sortRecords(recs);
+
+    // ---- dual graph over manifold edges; 'same' marks two faces that
+    // run along the shared edge in the same direction
+    struct Link { unsigned int face; bool same; };
+    std::vector<unsigned int> offsets(numFaces + 1, 0);
+    std::vector<std::pair<size_t, size_t>> pairs;   // record index of both sides
+    for (size_t i = 0; i < recs.size();) {
+        size_t j = i + 1;
+        while (j < recs.size() && recs[j].key == recs[i].key) ++j;
+        if (j - i == 2 && recs[i].item != recs[i + 1].item) {
+            pairs.push_back({i, i + 1});
+            offsets[recs[i].item + 1]++;
+            offsets[recs[i + 1].item + 1]++;
+        }
+        i = j;
+    }
+    for (size_t f = 0; f < numFaces; ++f) offsets[f + 1] += offsets[f];
+    std::vector<Link> links(offsets[numFaces]);
+    {
+        std::vector<unsigned int> cursor(offsets.begin(), offsets.end() - 1);
+        for (const auto& p : pairs) {
+            const EdgeRecord& x = recs[p.first];
+            const EdgeRecord& y = recs[p.second];
+            bool same = x.forward == y.forward;
+            links[cursor[x.item]++] = {y.item, same};
+            links[cursor[y.item]++] = {x.item, same};
+        }
+    }
+
+    // ---- BFS per component; keep the orientation of the majority
+    std::vector<signed char> flip(numFaces, -1);
+    std::vector<unsigned int> component;
+    for (size_t seed = 0; seed < numFaces; ++seed) {
+        if (flip[seed] != -1) continue;
+
+        component.clear();
+        component.push_back(static_cast<unsigned int>(seed));
+        flip[seed] = 0;
+        size_t flipped = 0;
+        for (size_t head = 0; head < component.size(); ++head) {
+            unsigned int f = component[head];
+            for (unsigned int k = offsets[f]; k < offsets[f + 1]; ++k) {
+                unsigned int g = links[k].face;
+                if (flip[g] != -1) continue;   // already placed; conflicts mean non-orientable
+                flip[g] = static_cast<signed char>(flip[f] ^ (links[k].same ? 1 : 0));
+                flipped += flip[g];
+                component.push_back(g);
+            }
+        }
+        if (flipped * 2 > component.size()) {
+            for (unsigned int f : component) flip[f] ^= 1;
+        }
+    }
+
+    for (size_t f = 0; f < numFaces; ++f) {
+        if (flip[f]) {
+            std::swap(indices[f * 3 + 1], indices[f * 3 + 2]);
+            stats.facesFlipped++;
+        }
+    }
+
+    // ---- split non-manifold vertices: corners of a vertex that are
+    // connected through manifold edges belong to the same fan
+    auto cornerOf = [&](unsigned int face, unsigned int v) {
+        for (unsigned int k = 0; k < 3; ++k) {
+            if (indices[face * 3 + k] == v) return face * 3 + k;
+        }
+        return face * 3;
+    };
+    UnionFind fans(indices.size());
+    for (const auto& p : pairs) {
+        unsigned int f1 = recs[p.first].item, f2 = recs[p.second].item;
+        unsigned int a = static_cast<unsigned int>(recs[p.first].key >> 32);
+        unsigned int b = static_cast<unsigned int>(recs[p.first].key & 0xFFFFFFFFu);
+        fans.unite(cornerOf(f1, a), cornerOf(f2, a));
+        fans.unite(cornerOf(f1, b), cornerOf(f2, b));
+    }
+
+    std::vector<unsigned int> corners(indices.size());
+    std::iota(corners.begin(), corners.end(), 0u);
+    std::vector<unsigned int> root(indices.size());
+    for (size_t c = 0; c < indices.size(); ++c) root[c] = fans.find(static_cast<unsigned int>(c));
+    std::sort(corners.begin(), corners.end(), [&](unsigned int x, unsigned int y) {
+        return indices[x] < indices[y] || (indices[x] == indices[y] && root[x] < root[y]);
+    });
+
+    for (size_t i = 0; i < corners.size();) {
+        unsigned int v = indices[corners[i]];
+        unsigned int target = v;
+        unsigned int fan = root[corners[i]];
+        size_t j = i;
+        while (j < corners.size() && indices[corners[j]] == v) {
+            unsigned int c = corners[j];
+            if (root[c] != fan) {
+                // another fan on the same vertex gets its own copy
+                fan = root[c];
+                target = static_cast<unsigned int>(positions.size());
+                positions.push_back(positions[v]);
+                stats.verticesSplit++;
+            }
+            indices[c] = target;
+            ++j;
+        }
+        i = j;
+    }
+
+    buildFromTriangles(positions, indices);
+    return stats;
+}
@@ -0,0 +1,53 @@
+#version 330 core
+
+in vec3 viewPos;
+flat in vec3 sphereCenter;
+flat in float sphereRadius;
+flat in float pixelRadius;
+flat in vec2 spinLayer;
+
+uniform mat4 view;
+uniform mat4 projection;
+uniform sampler2DArray uTexture;
+uniform vec4 uColor;              // bodies without a texture (layer < 0)
+uniform bool uDepthZeroToOne;     // clip control's depth range, else -1 .. 1
+
+out vec4 color;
+
+const float PI = 3.14159265358979;
+
+void main()
+{
+  // nearest hit of the eye ray through this fragment with the sphere
+  vec3 dir = normalize(viewPos);
+  float b = dot(dir, sphereCenter);
+  float h = b * b - dot(sphereCenter, sphereCenter) + sphereRadius * sphereRadius;
+  if (h < 0.0)
+    discard;
+  float t = b - sqrt(h);
+  if (t <= 0.0)
+    discard;
+  vec3 hit = dir * t;
+  vec3 normal = (hit - sphereCenter) / sphereRadius;
+
+  vec4 clip = projection * vec4(hit, 1.0f);
+  float z = clip.z / clip.w;
+  gl_FragDepth = uDepthZeroToOne ? z : 0.5 * z + 0.5;
+
+  if (spinLayer.y < 0.0) {
+    color = uColor;
+    return;
+  }
+
+  // back to the body's frame (undo the view, then the spin about Y) and
+  // the same equirectangular mapping as the sphere mesh
+  vec3 n = transpose(mat3(view)) * normal;
+  float c = cos(spinLayer.x);
+  float s = sin(spinLayer.x);
+  vec3 local = vec3(c * n.x - s * n.z, n.y, s * n.x + c * n.z);
+  vec2 uv = vec2(fract(atan(local.z, local.x) / (2.0 * PI)), 0.5 + asin(clamp(local.y, -1.0, 1.0)) / PI);
+
+  // a mip level for the size on screen; derivatives jump at the seam
+  float lod = max(log2(float(textureSize(uTexture, 0).y) / (2.0 * pixelRadius)), 0.0);
+  color = textureLod(uTexture, vec3(uv, spinLayer.y), lod);
+}
@@ -0,0 +1,44 @@
+#version 330 core
+layout (location = 0) in vec2 corner;               // -1 .. 1
+layout (location = 2) in vec4 instanceCenterRadius;
+layout (location = 3) in vec2 instanceSpinLayer;
+
+out vec3 viewPos;                 // point on the quad, view space
+flat out vec3 sphereCenter;       // view space
+flat out float sphereRadius;
+flat out float pixelRadius;
+flat out vec2 spinLayer;
+
+uniform mat4 view;
+uniform mat4 projection;
+uniform float uPixelsPerUnit;     // screen pixels per unit of size at distance 1
+uniform float uMinPixels;         // smallest radius drawn, in pixels
+
+void main()
+{
+  // the eye is the origin, the view only rotates
+  vec3 c = (view * vec4(instanceCenterRadius.xyz, 1.0f)).xyz;
+  float d = length(c);
+  float r = instanceCenterRadius.w;
+
+  // bodies smaller than a pixel or two are blown up so they stay visible
+  float px = r / d * uPixelsPerUnit;
+  if (px < uMinPixels) {
+    r = uMinPixels * d / uPixelsPerUnit;
+    px = uMinPixels;
+  }
+
+  // quad through the center, facing the eye, as wide as the cone of rays
+  // touching the sphere is there
+  vec3 w = c / d;
+  vec3 u = normalize(cross(abs(w.y) < 0.99f ? vec3(0.0f, 1.0f, 0.0f) : vec3(1.0f, 0.0f, 0.0f), w));
+  vec3 v = cross(w, u);
+  float halfSize = r * d / sqrt(max(d * d - r * r, 1e-12f));
+  viewPos = c + (u * corner.x + v * corner.y) * halfSize;
+
+  gl_Position = projection * vec4(viewPos, 1.0f);
+  sphereCenter = c;
+  sphereRadius = r;
+  pixelRadius = px;
+  spinLayer = instanceSpinLayer;
+}
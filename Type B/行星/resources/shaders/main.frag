@@ -1,12 +1,12 @@
 #version 330 core
 
-in vec2 texCoord;
+in vec3 texCoord;
 
 //uniform means the variable comes from CPU
-//sampler2D is a GLSL type = a regular 2D texture (PNG, JPG, etc.)
-//shader variable that receive 2d texture from CPU
+//sampler2DArray is a stack of same-sized 2D textures; texCoord.z picks the layer
+//shader variable that receive the texture array from CPU
 
-uniform sampler2D uTexture; 
+uniform sampler2DArray uTexture; 
 
 out vec4 color;
 
@@ -19,4 +19,3 @@ void main()
 
   color = texColor;
 }
-
@@ -1,15 +1,22 @@
 #version 330 core
 layout (location = 0) in vec3 position;
 layout (location = 1) in vec2 aTexCoord;
+layout (location = 2) in vec4 instanceCenterRadius;
+layout (location = 3) in vec2 instanceSpinLayer;
 
-out vec2 texCoord;
+out vec3 texCoord;
 
-uniform mat4 model;
 uniform mat4 view;
 uniform mat4 projection;
 
 void main()
 {
-  gl_Position = projection * view * model * vec4(position, 1.0f);
-  texCoord = aTexCoord;
+  // spin about the local Y axis, then scale and move into place
+  float c = cos(instanceSpinLayer.x);
+  float s = sin(instanceSpinLayer.x);
+  vec3 p = vec3(c * position.x + s * position.z, position.y, -s * position.x + c * position.z);
+  vec3 world = instanceCenterRadius.xyz + p * instanceCenterRadius.w;
+
+  gl_Position = projection * view * vec4(world, 1.0f);
+  texCoord = vec3(aTexCoord, instanceSpinLayer.y);
 }
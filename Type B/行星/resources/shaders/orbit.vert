@@ -0,0 +1,12 @@
+#version 330 core
+layout (location = 0) in vec4 aPosition;   // relative to the parent, origin slot
+
+uniform samplerBuffer uOrigins;             // parents relative to the eye
+uniform mat4 view;
+uniform mat4 projection;
+
+void main()
+{
+  vec3 origin = texelFetch(uOrigins, int(aPosition.w)).xyz;
+  gl_Position = projection * view * vec4(origin + aPosition.xyz, 1.0f);
+}
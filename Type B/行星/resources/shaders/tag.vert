@@ -0,0 +1,15 @@
+#version 330 core
+layout (location = 0) in vec3 position;
+layout (location = 1) in vec2 aTexCoord;
+layout (location = 2) in vec4 instanceCenterLayer;
+
+out vec3 texCoord;
+
+uniform mat4 view;
+uniform mat4 projection;
+
+void main()
+{
+  gl_Position = projection * view * vec4(instanceCenterLayer.xyz + position, 1.0f);
+  texCoord = vec3(aTexCoord, instanceCenterLayer.w);
+}
@@ -0,0 +1,13 @@
+#version 330 core
+
+in float fade;
+
+uniform vec4 uColor;
+
+out vec4 color;
+
+void main()
+{
+  // oldest samples fade out
+  color = vec4(uColor.rgb, uColor.a * fade * fade);
+}
@@ -0,0 +1,27 @@
+#version 330 core
+// No attributes: gl_InstanceID is the body, gl_VertexID the sample, oldest first
+
+uniform samplerBuffer uTrail;     // per row, per body: high half, low half
+uniform mat4 view;
+uniform mat4 projection;
+uniform vec3 uEyeHigh;
+uniform vec3 uEyeLow;
+uniform int uBodies;
+uniform int uRows;
+uniform int uHead;                // row the next sample goes to
+uniform int uCount;               // samples drawn
+
+out float fade;
+
+void main()
+{
+  int row = (uHead - uCount + gl_VertexID + uRows) % uRows;
+  int texel = 2 * (row * uBodies + gl_InstanceID);
+  vec3 high = texelFetch(uTrail, texel).xyz;
+  vec3 low = texelFetch(uTrail, texel + 1).xyz;
+
+  // subtract the eye before adding the halves, so large values cancel first
+  vec3 position = (high - uEyeHigh) + (low - uEyeLow);
+  gl_Position = projection * view * vec4(position, 1.0f);
+  fade = float(gl_VertexID + 1) / float(uCount);
+}
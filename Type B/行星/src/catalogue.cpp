@@ -0,0 +1,320 @@
+#include "catalogue.h"
+#include "mapped_file.h"
+#include "parallel.h"
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <unordered_map>
+
+namespace {
+
+const char BINARY_MAGIC[8] = {'P', 'L', 'C', 'A', 'T', '0', '0', '2'};
+const size_t BINARY_VERSION_AT = 5;   // "PLCAT" then three version digits
+
+// Smallest piece of a CSV file worth its own thread
+const size_t MIN_BYTES_PER_CHUNK = 1 << 20;
+const size_t MIN_RECORDS_PER_THREAD = 4096;
+
+const int NUMERIC_FIELDS = 14;   // N1 .. M2, rotPeriod, radius
+const int MAX_FIELDS = 19;
+
+struct BinaryRecord {
+    double elements[13];   // N1 .. M2, rotPeriod
+    double mass;           // solar masses
+    int32_t parent;        // index, -1 for none
+    float radius;
+    uint32_t name, texture, nameTag;   // offsets into the string table
+    uint32_t reserved;     // 0
+};
+static_assert(sizeof(BinaryRecord) == 136, "catalogue record layout");
+
+inline const char* trimFront(const char* b, const char* e)
+{
+    while (b < e && (*b == ' ' || *b == '\t')) ++b;
+    return b;
+}
+
+inline const char* trimBack(const char* b, const char* e)
+{
+    while (e > b && (e[-1] == ' ' || e[-1] == '\t' || e[-1] == '\r')) --e;
+    return e;
+}
+
+// One CSV line into out; returns false with a message on bad input
+bool parseLine(const char* b, const char* e, BodyRecord& out, std::string& error)
+{
+    const char* fields[MAX_FIELDS][2];
+    int count = 0;
+    for (const char* p = b;; ++p) {
+        if (p == e || *p == ',') {
+            if (count < MAX_FIELDS) {
+                fields[count][0] = trimFront(b, p);
+                fields[count][1] = trimBack(fields[count][0], p);
+            }
+            ++count;
+            b = p + 1;
+            if (p == e) break;
+        }
+    }
+    if (count != 16 && count != 18 && count != 19) {
+        error = "expected 16, 18 or 19 fields, found " + std::to_string(count);
+        return false;
+    }
+
+    auto parseNumber = [&](int field, double& value) {
+        const char* vb = fields[field][0];
+        const char* ve = fields[field][1];
+        if (vb < ve && *vb == '+') ++vb;
+        auto res = std::from_chars(vb, ve, value);
+        if (res.ec != std::errc() || res.ptr != ve) {
+            error = "bad number '" + std::string(fields[field][0], fields[field][1]) + "'";
+            return false;
+        }
+        return true;
+    };
+    double values[NUMERIC_FIELDS];
+    for (int f = 0; f < NUMERIC_FIELDS; ++f) {
+        if (!parseNumber(f + 2, values[f])) return false;
+    }
+
+    out.name.assign(fields[0][0], fields[0][1]);
+    out.parent.assign(fields[1][0], fields[1][1]);
+    out.elem = {values[0], values[1], values[2], values[3], values[4], values[5],
+                values[6], values[7], values[8], values[9], values[10], values[11],
+                values[12], -1};
+    out.radius = static_cast<float>(values[13]);
+    if (count >= 18) {
+        out.texture.assign(fields[16][0], fields[16][1]);
+        out.nameTag.assign(fields[17][0], fields[17][1]);
+    }
+    if (count == 19) {
+        if (!parseNumber(18, out.mass)) return false;
+        if (out.mass < 0.0) {
+            error = "negative mass";
+            return false;
+        }
+    }
+    if (out.name.empty()) {
+        error = "body without a name";
+        return false;
+    }
+    return true;
+}
+
+struct CsvChunk {
+    std::vector<BodyRecord> bodies;
+    std::vector<const char*> lines;   // start of each body's line
+    const char* errorAt = nullptr;
+    std::string error;
+};
+
+void parseChunk(const char* b, const char* e, CsvChunk& chunk)
+{
+    // about one line per 80 bytes
+    chunk.bodies.reserve(static_cast<size_t>(e - b) / 80 + 1);
+    chunk.lines.reserve(chunk.bodies.capacity());
+    while (b < e) {
+        const char* lineEnd = static_cast<const char*>(std::memchr(b, '\n', static_cast<size_t>(e - b)));
+        if (!lineEnd) lineEnd = e;
+        const char* first = trimFront(b, lineEnd);
+        const char* last = trimBack(first, lineEnd);
+        if (first < last && *first != '#') {
+            chunk.bodies.emplace_back();
+            chunk.lines.push_back(b);
+            if (!parseLine(first, last, chunk.bodies.back(), chunk.error)) {
+                chunk.errorAt = b;
+                return;
+            }
+        }
+        b = lineEnd + 1;
+    }
+}
+
+// Line number of a position in the file, only worked out for messages
+size_t lineNumber(const char* data, const char* at)
+{
+    return 1 + static_cast<size_t>(std::count(data, at, '\n'));
+}
+
+bool parseCsv(const char* data, size_t size, std::vector<BodyRecord>& outBodies,
+              std::vector<const char*>& outLines, const std::string& path)
+{
+    const char* end = data + size;
+    size_t chunkCount = std::max<size_t>(1, std::min<size_t>(workerCount(), size / MIN_BYTES_PER_CHUNK));
+
+    // chunk boundaries moved forward to the next line start
+    std::vector<const char*> starts(chunkCount + 1, end);
+    starts[0] = data;
+    for (size_t c = 1; c < chunkCount; ++c) {
+        const char* p = std::max(data + size * c / chunkCount, starts[c - 1]);
+        const char* nl = static_cast<const char*>(std::memchr(p, '\n', static_cast<size_t>(end - p)));
+        starts[c] = nl ? nl + 1 : end;
+    }
+
+    std::vector<CsvChunk> chunks(chunkCount);
+    parallelFor(chunkCount, 1, [&](size_t begin, size_t stop) {
+        for (size_t c = begin; c < stop; ++c) parseChunk(starts[c], starts[c + 1], chunks[c]);
+    });
+
+    size_t total = 0;
+    for (const auto& chunk : chunks) {
+        if (chunk.errorAt) {
+            std::cout << "Catalogue " << path << " line " << lineNumber(data, chunk.errorAt) << ": "
+                      << chunk.error << std::endl;
+            return false;
+        }
+        total += chunk.bodies.size();
+    }
+
+    outBodies.reserve(total);
+    outLines.reserve(total);
+    for (auto& chunk : chunks) {
+        std::move(chunk.bodies.begin(), chunk.bodies.end(), std::back_inserter(outBodies));
+        outLines.insert(outLines.end(), chunk.lines.begin(), chunk.lines.end());
+    }
+    return true;
+}
+
+bool parseBinary(const unsigned char* data, size_t size, std::vector<BodyRecord>& outBodies, const std::string& path)
+{
+    uint32_t count = 0, stringBytes = 0;
+    if (size >= 16) {
+        std::memcpy(&count, data + 8, 4);
+        std::memcpy(&stringBytes, data + 12, 4);
+    }
+    if (size < 16 || size != 16 + static_cast<size_t>(count) * sizeof(BinaryRecord) + stringBytes) {
+        std::cout << "Catalogue " << path << ": truncated binary file" << std::endl;
+        return false;
+    }
+
+    const unsigned char* records = data + 16;
+    const char* strings = reinterpret_cast<const char*>(records + static_cast<size_t>(count) * sizeof(BinaryRecord));
+    if (stringBytes > 0 && strings[stringBytes - 1] != '\0') {
+        std::cout << "Catalogue " << path << ": unterminated string table" << std::endl;
+        return false;
+    }
+
+    outBodies.resize(count);
+    std::atomic<bool> ok{true};
+    parallelFor(count, MIN_RECORDS_PER_THREAD, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            BinaryRecord r;
+            std::memcpy(&r, records + i * sizeof(BinaryRecord), sizeof(r));
+            if (r.name >= stringBytes || r.texture >= stringBytes || r.nameTag >= stringBytes ||
+                !(r.mass >= 0.0) || r.parent < -1 || r.parent >= static_cast<int32_t>(count)) {
+                ok = false;
+                continue;
+            }
+            BodyRecord& b = outBodies[i];
+            const double* v = r.elements;
+            b.elem = {v[0], v[1], v[2], v[3], v[4], v[5], v[6], v[7], v[8], v[9], v[10], v[11], v[12], r.parent};
+            b.radius = r.radius;
+            b.mass = r.mass;
+            b.name = strings + r.name;
+            b.texture = strings + r.texture;
+            b.nameTag = strings + r.nameTag;
+        }
+    });
+    if (!ok) {
+        std::cout << "Catalogue " << path << ": corrupt record" << std::endl;
+        return false;
+    }
+    for (auto& b : outBodies) {
+        if (b.elem.centerOfOrbit >= 0) b.parent = outBodies[b.elem.centerOfOrbit].name;
+    }
+    return true;
+}
+
+} // namespace
+
+bool loadCatalogue(const std::string& path, std::vector<BodyRecord>& outBodies)
+{
+    outBodies.clear();
+
+    MappedFile file(path);
+    if (!file.isOpen()) {
+        std::cout << "Cannot open catalogue: " << path << std::endl;
+        return false;
+    }
+
+    if (file.size() >= sizeof(BINARY_MAGIC) && std::memcmp(file.data(), BINARY_MAGIC, BINARY_VERSION_AT) == 0) {
+        if (std::memcmp(file.data(), BINARY_MAGIC, sizeof(BINARY_MAGIC)) != 0) {
+            std::cout << "Catalogue " << path << ": unsupported binary version "
+                      << std::string(reinterpret_cast<const char*>(file.data()), sizeof(BINARY_MAGIC)) << std::endl;
+            return false;
+        }
+        return parseBinary(file.data(), file.size(), outBodies, path);
+    }
+    const char* text = reinterpret_cast<const char*>(file.data());
+    std::vector<const char*> lines;
+    if (!parseCsv(text, file.size(), outBodies, lines, path)) return false;
+
+    // resolve parents by name
+    std::unordered_map<std::string, int> index;
+    index.reserve(outBodies.size());
+    for (size_t i = 0; i < outBodies.size(); ++i) {
+        if (!index.emplace(outBodies[i].name, static_cast<int>(i)).second) {
+            std::cout << "Catalogue " << path << " line " << lineNumber(text, lines[i]) << ": duplicate body "
+                      << outBodies[i].name << std::endl;
+            return false;
+        }
+    }
+    for (size_t i = 0; i < outBodies.size(); ++i) {
+        BodyRecord& b = outBodies[i];
+        if (b.parent.empty()) continue;
+        auto found = index.find(b.parent);
+        if (found == index.end() || b.parent == b.name) {
+            std::cout << "Catalogue " << path << " line " << lineNumber(text, lines[i]) << ": " << b.name
+                      << " orbits unknown body " << b.parent << std::endl;
+            return false;
+        }
+        b.elem.centerOfOrbit = found->second;
+    }
+    return true;
+}
+
+bool saveCatalogueBinary(const std::string& path, const std::vector<BodyRecord>& bodies)
+{
+    std::string strings(1, '\0');   // offset 0 is the empty string
+    auto addString = [&](const std::string& s) -> uint32_t {
+        if (s.empty()) return 0;
+        uint32_t offset = static_cast<uint32_t>(strings.size());
+        strings.append(s.c_str(), s.size() + 1);
+        return offset;
+    };
+
+    std::vector<BinaryRecord> records(bodies.size());
+    for (size_t i = 0; i < bodies.size(); ++i) {
+        const BodyRecord& b = bodies[i];
+        const OrbitalElements& e = b.elem;
+        BinaryRecord& r = records[i];
+        double v[13] = {e.N1, e.N2, e.i1, e.i2, e.w1, e.w2, e.a1, e.a2, e.e1, e.e2, e.M1, e.M2, e.rotPeriod};
+        std::memcpy(r.elements, v, sizeof(v));
+        r.parent = e.centerOfOrbit;
+        r.radius = b.radius;
+        r.name = addString(b.name);
+        r.texture = addString(b.texture);
+        r.nameTag = addString(b.nameTag);
+        r.mass = b.mass;
+        r.reserved = 0;
+    }
+
+    std::ofstream out(path, std::ios::binary);
+    if (!out.is_open()) {
+        std::cout << "Cannot write catalogue: " << path << std::endl;
+        return false;
+    }
+    uint32_t count = static_cast<uint32_t>(records.size());
+    uint32_t stringBytes = static_cast<uint32_t>(strings.size());
+    out.write(BINARY_MAGIC, sizeof(BINARY_MAGIC));
+    out.write(reinterpret_cast<const char*>(&count), 4);
+    out.write(reinterpret_cast<const char*>(&stringBytes), 4);
+    out.write(reinterpret_cast<const char*>(records.data()), static_cast<std::streamsize>(records.size() * sizeof(BinaryRecord)));
+    out.write(strings.data(), static_cast<std::streamsize>(strings.size()));
+    return out.good();
+}
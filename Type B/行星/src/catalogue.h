@@ -0,0 +1,34 @@
+#ifndef CATALOGUE_H
+#define CATALOGUE_H
+
+#include <string>
+#include <vector>
+#include "kepler.h"
+
+// One body of a catalogue file
+struct BodyRecord {
+    std::string name;
+    std::string parent;        // name of the body it orbits, empty for the origin
+    OrbitalElements elem;      // centerOfOrbit is the parent's index, -1 for none
+    float radius = 0.0f;       // display radius in GL units
+    std::string texture;       // surface map under resources/tex, empty for small bodies
+    std::string nameTag;       // label image under resources/tex, may be empty
+    double mass = 0.0;         // solar masses, 0 for a test particle (N-body mode)
+};
+
+// Catalogues come in two forms, told apart by the first bytes:
+//
+// CSV, one body per line, '#' starts a comment:
+//   name,parent,N1,N2,i1,i2,w1,w2,a1,a2,e1,e2,M1,M2,rotPeriod,radius,texture,tag,mass
+// (texture, tag and mass may be left off, or just mass)
+//
+// Binary (what saveCatalogueBinary writes, native little-endian):
+//   "PLCAT002", uint32 body count, uint32 string table size,
+//   one fixed size record per body, then the string table.
+//
+// Parents may appear after their children; they are matched by name once
+// the whole file is read.
+bool loadCatalogue(const std::string& path, std::vector<BodyRecord>& outBodies);
+bool saveCatalogueBinary(const std::string& path, const std::vector<BodyRecord>& bodies);
+
+#endif
@@ -0,0 +1,209 @@
+#include "encounter.h"
+#include "parallel.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// Smallest share of bodies (or hash buckets) worth a thread
+const size_t MIN_ITEMS_PER_THREAD = 4096;
+
+// Cells are this many times the mean swept box, and never smaller than
+// the alert distance
+const double CELL_SCALE = 4.0;
+
+// Boxes spanning more cells than this along an axis skip the grid
+const int64_t MAX_CELLS_PER_AXIS = 4;
+
+// Cell indices are clamped to this, far beyond any sensible catalogue
+const double MAX_CELL_INDEX = 1073741824.0;
+
+const double MIN_DISTANCE_AU = 1e-9;
+
+inline int32_t cellIndex(double x, double invCellSize)
+{
+    double i = std::floor(x * invCellSize);
+    return static_cast<int32_t>(std::min(std::max(i, -MAX_CELL_INDEX), MAX_CELL_INDEX));
+}
+
+inline uint32_t cellHash(int32_t ix, int32_t iy, int32_t iz)
+{
+    return (static_cast<uint32_t>(ix) * 73856093u) ^ (static_cast<uint32_t>(iy) * 19349663u)
+         ^ (static_cast<uint32_t>(iz) * 83492791u);
+}
+
+inline bool overlaps(const glm::dvec3& loA, const glm::dvec3& hiA, const glm::dvec3& loB, const glm::dvec3& hiB)
+{
+    return loA.x <= hiB.x && loB.x <= hiA.x && loA.y <= hiB.y && loB.y <= hiA.y
+        && loA.z <= hiB.z && loB.z <= hiA.z;
+}
+
+} // namespace
+
+void EncounterDetector::init(const std::vector<int>& bodyParents, double distanceAU)
+{
+    parents = bodyParents;
+    setDistance(distanceAU);
+    prev.assign(parents.size(), glm::dvec3(0.0));
+    curr.assign(parents.size(), glm::dvec3(0.0));
+    reset();
+    newEvents.clear();
+}
+
+void EncounterDetector::setDistance(double au)
+{
+    alertDistance = std::max(au, MIN_DISTANCE_AU);
+    active.clear();   // pairs inside the old distance would all be reported again
+}
+
+// Either body orbits the other, however many levels down
+bool EncounterDetector::related(uint32_t a, uint32_t b) const
+{
+    for (int p = parents[a]; p >= 0; p = parents[p]) if (p == static_cast<int>(b)) return true;
+    for (int p = parents[b]; p >= 0; p = parents[p]) if (p == static_cast<int>(a)) return true;
+    return false;
+}
+
+// Closest approach of two bodies moving linearly over the step
+bool EncounterDetector::test(uint32_t a, uint32_t b, Hit& hit) const
+{
+    if (related(a, b)) return false;
+    glm::dvec3 d0 = prev[b] - prev[a];
+    glm::dvec3 v = (curr[b] - curr[a]) - d0;
+    double vv = glm::dot(v, v);
+    double s = vv > 0.0 ? std::min(std::max(-glm::dot(d0, v) / vv, 0.0), 1.0) : 0.0;
+    double d = glm::length(d0 + v * s);
+    if (d > alertDistance) return false;
+    hit.pair = (static_cast<uint64_t>(std::min(a, b)) << 32) | std::max(a, b);
+    hit.s = s;
+    hit.distance = d;
+    return true;
+}
+
+void EncounterDetector::update(double t, const std::function<glm::dvec3(size_t)>& position)
+{
+    size_t n = parents.size();
+    std::swap(prev, curr);
+    parallelFor(n, MIN_ITEMS_PER_THREAD, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) curr[i] = position(i);
+    });
+    double startTime = prevTime;
+    prevTime = t;
+    if (!havePrevious) {
+        havePrevious = true;
+        return;
+    }
+
+    // swept boxes, and the cell size from their mean width
+    boxLo.resize(n);
+    boxHi.resize(n);
+    double pad = 0.5 * alertDistance;
+    size_t workers = n > MIN_ITEMS_PER_THREAD ? workerCount() : 1;
+    size_t chunkCount = std::max<size_t>(1, std::min<size_t>(workers, (n + MIN_ITEMS_PER_THREAD - 1) / MIN_ITEMS_PER_THREAD));
+    chunkWidth.assign(chunkCount, 0.0);
+    parallelChunks(n, chunkCount, [&](size_t c, size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            boxLo[i] = glm::min(prev[i], curr[i]) - pad;
+            boxHi[i] = glm::max(prev[i], curr[i]) + pad;
+            glm::dvec3 w = boxHi[i] - boxLo[i];
+            chunkWidth[c] += std::max(w.x, std::max(w.y, w.z));
+        }
+    });
+    double widthSum = 0.0;
+    for (double w : chunkWidth) widthSum += w;
+    double cellSize = std::max(alertDistance, CELL_SCALE * widthSum / std::max<size_t>(n, 1));
+    double invCell = 1.0 / cellSize;
+
+    // cells per body, then every (cell, body) entry
+    cellLo.resize(n);
+    cellHi.resize(n);
+    cellCount.resize(n);
+    parallelFor(n, MIN_ITEMS_PER_THREAD, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            int64_t cells = 1;
+            for (int k = 0; k < 3; ++k) {
+                cellLo[i][k] = cellIndex(boxLo[i][k], invCell);
+                cellHi[i][k] = cellIndex(boxHi[i][k], invCell);
+                int64_t span = int64_t(cellHi[i][k]) - cellLo[i][k] + 1;
+                if (span > MAX_CELLS_PER_AXIS) cells = 0;
+                cells *= span;
+            }
+            cellCount[i] = static_cast<uint32_t>(cells);
+        }
+    });
+    entryStart.resize(n + 1);
+    entryStart[0] = 0;
+    large.clear();
+    for (size_t i = 0; i < n; ++i) {
+        if (cellCount[i] == 0) large.push_back(static_cast<uint32_t>(i));
+        entryStart[i + 1] = entryStart[i] + cellCount[i];
+    }
+    entries.resize(entryStart[n]);
+    parallelFor(n, MIN_ITEMS_PER_THREAD, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            if (cellCount[i] == 0) continue;
+            Entry* out = &entries[entryStart[i]];
+            for (int32_t x = cellLo[i].x; x <= cellHi[i].x; ++x)
+                for (int32_t y = cellLo[i].y; y <= cellHi[i].y; ++y)
+                    for (int32_t z = cellLo[i].z; z <= cellHi[i].z; ++z) *out++ = {static_cast<uint32_t>(i), x, y, z};
+        }
+    });
+
+    // counting sort into a power of two table with room for every entry
+    size_t tableSize = 1;
+    while (tableSize < entries.size()) tableSize <<= 1;
+    uint32_t mask = static_cast<uint32_t>(tableSize - 1);
+    bucketStart.assign(tableSize + 1, 0);
+    for (const Entry& e : entries) bucketStart[(cellHash(e.ix, e.iy, e.iz) & mask) + 1]++;
+    for (size_t k = 0; k < tableSize; ++k) bucketStart[k + 1] += bucketStart[k];
+    sorted.resize(entries.size());
+    bucketNext.assign(bucketStart.begin(), bucketStart.end() - 1);
+    for (const Entry& e : entries) sorted[bucketNext[cellHash(e.ix, e.iy, e.iz) & mask]++] = e;
+
+    // pairs sharing a cell, each tested in one cell only
+    chunkCount = std::max<size_t>(1, std::min<size_t>(tableSize > MIN_ITEMS_PER_THREAD ? workerCount() : 1,
+                                                      tableSize / MIN_ITEMS_PER_THREAD));
+    if (chunkHits.size() < chunkCount) chunkHits.resize(chunkCount);
+    for (size_t c = 0; c < chunkCount; ++c) chunkHits[c].clear();
+    parallelChunks(tableSize, chunkCount, [&](size_t c, size_t begin, size_t end) {
+        Hit hit;
+        for (size_t k = begin; k < end; ++k) {
+            for (uint32_t i = bucketStart[k]; i < bucketStart[k + 1]; ++i) {
+                const Entry& ei = sorted[i];
+                for (uint32_t j = i + 1; j < bucketStart[k + 1]; ++j) {
+                    const Entry& ej = sorted[j];
+                    if (ei.ix != ej.ix || ei.iy != ej.iy || ei.iz != ej.iz) continue;
+                    uint32_t a = ei.body, b = ej.body;
+                    if (!overlaps(boxLo[a], boxHi[a], boxLo[b], boxHi[b])) continue;
+                    glm::dvec3 corner = glm::max(boxLo[a], boxLo[b]);
+                    if (cellIndex(corner.x, invCell) != ei.ix || cellIndex(corner.y, invCell) != ei.iy
+                        || cellIndex(corner.z, invCell) != ei.iz) continue;
+                    if (test(a, b, hit)) chunkHits[c].push_back(hit);
+                }
+            }
+        }
+    });
+
+    // the few bodies too fast for the grid, against everything
+    hits.clear();
+    for (size_t c = 0; c < chunkCount; ++c) hits.insert(hits.end(), chunkHits[c].begin(), chunkHits[c].end());
+    for (size_t k = 0; k < large.size(); ++k) {
+        uint32_t a = large[k];
+        Hit hit;
+        for (uint32_t b = 0; b < n; ++b) {
+            if (b == a || (cellCount[b] == 0 && b < a)) continue;
+            if (overlaps(boxLo[a], boxHi[a], boxLo[b], boxHi[b]) && test(a, b, hit)) hits.push_back(hit);
+        }
+    }
+
+    // report the pairs that were not already close
+    std::sort(hits.begin(), hits.end(), [](const Hit& x, const Hit& y) { return x.pair < y.pair; });
+    nowActive.clear();
+    for (const Hit& h : hits) {
+        nowActive.push_back(h.pair);
+        if (std::binary_search(active.begin(), active.end(), h.pair)) continue;
+        newEvents.push_back({static_cast<uint32_t>(h.pair >> 32), static_cast<uint32_t>(h.pair),
+                             startTime + (t - startTime) * h.s, h.distance});
+    }
+    active.swap(nowActive);
+}
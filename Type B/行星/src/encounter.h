@@ -0,0 +1,91 @@
+#ifndef ENCOUNTER_H
+#define ENCOUNTER_H
+
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+// Two bodies coming within the alert distance
+struct Encounter {
+    uint32_t a, b;          // body indices, a < b
+    double timeDays;        // time of closest approach within the step
+    double distanceAU;      // distance then
+};
+
+// Close approaches between bodies, checked once per clock step.
+//
+// Each body's path over the step is taken as a straight segment. The
+// broad phase is a uniform grid: every body is entered in each cell its
+// swept box (padded by half the alert distance) overlaps, the entries are
+// counting sorted into a hash table, and only bodies sharing a cell are
+// compared, so the cost follows the body count rather than its square.
+// A pair sharing several cells is only tested in the one holding the
+// larger of its two box corners. Bodies whose box spans too many cells
+// are tested against everyone instead.
+//
+// The narrow phase solves for the closest approach of the two segments
+// in closed form. A pair is reported when it first comes within the
+// distance and again only after it has left; a body and its parents or
+// moons are never paired.
+class EncounterDetector
+{
+public:
+    // parents[i] is the body i orbits, -1 for none
+    void init(const std::vector<int>& parents, double distanceAU);
+
+    void setDistance(double au);
+    double distance() const { return alertDistance; }
+
+    // The next update() only records positions, e.g. after they jump
+    void reset() { havePrevious = false; active.clear(); }
+
+    // Same, but pairs already close are not reported again if they still are
+    void skip() { havePrevious = false; }
+
+    // Positions at day t, position(b) in AU. Encounters that began since
+    // the previous update are appended to events().
+    void update(double t, const std::function<glm::dvec3(size_t)>& position);
+
+    const std::vector<Encounter>& events() const { return newEvents; }
+    void clearEvents() { newEvents.clear(); }
+    size_t activePairs() const { return active.size(); }
+
+private:
+    struct Entry {
+        uint32_t body;
+        int32_t ix, iy, iz;   // cell
+    };
+    struct Hit {
+        uint64_t pair;        // a << 32 | b
+        double s;             // fraction of the step at closest approach
+        double distance;
+    };
+
+    bool related(uint32_t a, uint32_t b) const;
+    bool test(uint32_t a, uint32_t b, Hit& hit) const;
+
+    std::vector<int> parents;
+    double alertDistance = 0.0;
+
+    std::vector<glm::dvec3> prev, curr;
+    double prevTime = 0.0;
+    bool havePrevious = false;
+
+    // Broad phase scratch, kept between steps
+    std::vector<glm::dvec3> boxLo, boxHi;
+    std::vector<glm::ivec3> cellLo, cellHi;
+    std::vector<uint32_t> cellCount, entryStart, large;
+    std::vector<Entry> entries, sorted;
+    std::vector<uint32_t> bucketStart, bucketNext;
+    std::vector<double> chunkWidth;
+    std::vector<std::vector<Hit>> chunkHits;
+    std::vector<Hit> hits;
+    std::vector<uint64_t> nowActive;
+
+    std::vector<uint64_t> active;        // pairs within the distance, sorted
+    std::vector<Encounter> newEvents;
+};
+
+#endif
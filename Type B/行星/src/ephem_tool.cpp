@@ -0,0 +1,296 @@
+// Headless ephemeris tool. Links the orbit code of the viewer but needs no
+// window or GL context:
+//
+//   g++ -O2 -std=c++17 -pthread ephem_tool.cpp orbit_system.cpp catalogue.cpp kepler.cpp
+//       ephemeris.cpp nbody.cpp -o ephem_tool
+//   (add -mavx2 -mfma for the vectorised orbit solver)
+//
+// Usage:
+//   ephem_tool <catalogue> [options] [-o output]
+//
+// Options:
+//   --start <day>       first day, days since 2000 Jan 0.0 (default 0)
+//   --end <day>         last day, included if the steps land on it (default 365)
+//   --step <days>       days between output rows (default 1)
+//   --ephemeris         orbits from the Chebyshev cache instead of the elements
+//   --nbody             integrate under gravity, in substeps no longer than
+//                       the viewer's clock step
+//   --format csv|bin    output format (default csv)
+//   --bench             compute every step but write nothing
+//
+// Output goes to the -o file, or to stdout. Positions are true positions
+// in AU, parents included, Y up as in the viewer.
+//
+// CSV: a "day,body,x,y,z" header, then one line per body per day.
+//
+// Binary (native little-endian):
+//   "PLEPH001", uint32 body count, uint64 day count,
+//   per body a uint32 name length and the name,
+//   then per day a double day and body count x, y, z doubles.
+//
+// Each day is one OrbitSystem::update() over all bodies; the CSV text is
+// formatted on all threads and written by a second thread while the next
+// block is computed. Timing and body-evaluations per second are printed as
+// one JSON object, to stdout when the data goes elsewhere: load_ms reads
+// the catalogue (and fits the cache with --ephemeris), evaluate_ms is the
+// updates alone, run_ms adds formatting and writing, total_ms is both.
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "catalogue.h"
+#include "orbit_system.h"
+#include "parallel.h"
+
+// Output is handed to the writer thread in blocks of about this size
+static const size_t WRITE_BLOCK_BYTES = 4 << 20;
+
+// Smallest share of bodies worth a thread when formatting
+static const size_t MIN_BODIES_PER_THREAD = 1024;
+
+// Days within this of --end still get a row
+static const double DAY_EPSILON = 1e-9;
+
+static void printUsage()
+{
+    std::cerr << "usage: ephem_tool <catalogue> [--start day] [--end day] [--step days]\n"
+                 "                  [--ephemeris] [--nbody] [--format csv|bin] [--bench] [-o output]" << std::endl;
+}
+
+// Hands finished blocks to a thread that writes them while the next fills
+class BlockWriter {
+public:
+    explicit BlockWriter(FILE* f) : file(f) {}
+    ~BlockWriter() { finish(); }
+
+    std::string& buffer() { return filling; }
+
+    void flushIfFull()
+    {
+        if (filling.size() >= WRITE_BLOCK_BYTES) flush();
+    }
+
+    void flush()
+    {
+        if (worker.joinable()) worker.join();
+        writing.swap(filling);
+        filling.clear();
+        if (writing.empty()) return;
+        worker = std::thread([this]() {
+            if (std::fwrite(writing.data(), 1, writing.size(), file) != writing.size()) failed = true;
+        });
+    }
+
+    // Write what is left; false if any write fell short
+    bool finish()
+    {
+        flush();
+        if (worker.joinable()) worker.join();
+        return !failed;
+    }
+
+private:
+    FILE* file;
+    std::string filling, writing;
+    std::thread worker;
+    bool failed = false;
+};
+
+static std::string jsonEscape(const std::string& s)
+{
+    std::string out;
+    for (char c : s) {
+        if (c == '"' || c == '\\') out += '\\';
+        out += c;
+    }
+    return out;
+}
+
+// Whole argument as a finite number
+static bool parseDays(const char* text, double& out)
+{
+    char* end = nullptr;
+    out = std::strtod(text, &end);
+    return end != text && *end == '\0' && std::isfinite(out);
+}
+
+// Shortest text that parses back to the same double
+static void appendDouble(std::string& out, double v)
+{
+    char buf[32];
+    auto res = std::to_chars(buf, buf + sizeof(buf), v);
+    out.append(buf, res.ptr);
+}
+
+template <class T>
+static void appendRaw(std::string& out, const T& value)
+{
+    out.append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 2) {
+        printUsage();
+        return 2;
+    }
+
+    std::string cataloguePath = argv[1];
+    std::string outputPath;
+    std::string format = "csv";
+    double startDay = 0.0, endDay = 365.0, stepDays = 1.0;
+    bool useEphemeris = false, useNBody = false, bench = false;
+
+    for (int i = 2; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "-o" && i + 1 < argc) {
+            outputPath = argv[++i];
+        } else if ((arg == "--start" || arg == "--end" || arg == "--step") && i + 1 < argc) {
+            double& value = arg == "--start" ? startDay : (arg == "--end" ? endDay : stepDays);
+            if (!parseDays(argv[++i], value)) {
+                std::cerr << "not a number of days: " << arg << " " << argv[i] << std::endl;
+                printUsage();
+                return 2;
+            }
+        } else if (arg == "--format" && i + 1 < argc) {
+            format = argv[++i];
+        } else if (arg == "--ephemeris") {
+            useEphemeris = true;
+        } else if (arg == "--nbody") {
+            useNBody = true;
+        } else if (arg == "--bench") {
+            bench = true;
+        } else {
+            std::cerr << "unknown option: " << arg << std::endl;
+            printUsage();
+            return 2;
+        }
+    }
+    if (!(stepDays > 0.0) || endDay < startDay || (format != "csv" && format != "bin")) {
+        printUsage();
+        return 2;
+    }
+    bool binary = format == "bin";
+    FILE* report = (bench || !outputPath.empty()) ? stdout : stderr;
+
+    // ---- load
+    auto loadStart = std::chrono::steady_clock::now();
+    std::vector<BodyRecord> bodies;
+    OrbitSystem orbit;
+    if (!loadCatalogue(cataloguePath, bodies) || !orbit.init(bodies, startDay)) return 1;
+    if (useEphemeris) {
+        orbit.setUseEphemeris(true);
+        orbit.prebuildEphemeris(startDay, endDay);
+    }
+    if (useNBody && !orbit.setUseNBody(true)) return 1;
+    double loadMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - loadStart).count();
+
+    size_t n = orbit.size();
+    uint64_t days = static_cast<uint64_t>(std::floor((endDay - startDay) / stepDays + DAY_EPSILON)) + 1;
+    int substeps = useNBody ? std::max(1, static_cast<int>(std::ceil(stepDays / orbit.maxStepDays()))) : 1;
+
+    FILE* out = nullptr;
+    if (!bench) {
+        out = outputPath.empty() ? stdout : std::fopen(outputPath.c_str(), binary ? "wb" : "w");
+        if (!out) {
+            std::cerr << "Cannot open output: " << outputPath << std::endl;
+            return 1;
+        }
+    }
+
+    // ---- run
+    double evaluateMs = 0.0;
+    auto runStart = std::chrono::steady_clock::now();
+    bool ok = true;
+    {
+        BlockWriter writer(out);
+        std::string& block = writer.buffer();
+        if (out && binary) {
+            block.append("PLEPH001", 8);
+            appendRaw(block, static_cast<uint32_t>(n));
+            appendRaw(block, days);
+            for (size_t i = 0; i < n; ++i) {
+                appendRaw(block, static_cast<uint32_t>(orbit.name(i).size()));
+                block.append(orbit.name(i));
+            }
+        } else if (out) {
+            block.append("day,body,x,y,z\n");
+        }
+
+        size_t chunkCount = std::max<size_t>(1, std::min<size_t>(workerCount(), n / MIN_BODIES_PER_THREAD));
+        std::vector<std::string> chunkText(chunkCount);
+        std::vector<double> row(binary ? 1 + 3 * n : 0);
+        for (uint64_t k = 0; k < days; ++k) {
+            double day = startDay + static_cast<double>(k) * stepDays;
+
+            auto evaluateStart = std::chrono::steady_clock::now();
+            if (k > 0) {
+                double from = orbit.time();
+                for (int s = 1; s <= substeps; ++s) orbit.update(from + (day - from) * s / substeps);
+            }
+            evaluateMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - evaluateStart).count();
+            if (!out) continue;
+
+            if (binary) {
+                row[0] = day;
+                parallelFor(n, MIN_BODIES_PER_THREAD, [&](size_t begin, size_t end) {
+                    for (size_t i = begin; i < end; ++i) {
+                        const glm::dvec3& p = orbit.position(i);
+                        row[1 + 3 * i] = p.x;
+                        row[2 + 3 * i] = p.y;
+                        row[3 + 3 * i] = p.z;
+                    }
+                });
+                block.append(reinterpret_cast<const char*>(row.data()), row.size() * sizeof(double));
+            } else {
+                parallelChunks(n, chunkCount, [&](size_t c, size_t begin, size_t end) {
+                    std::string& text = chunkText[c];
+                    text.clear();
+                    char dayText[64];
+                    auto dayEnd = std::to_chars(dayText, dayText + sizeof(dayText), day, std::chars_format::fixed, 6).ptr;
+                    for (size_t i = begin; i < end; ++i) {
+                        const glm::dvec3& p = orbit.position(i);
+                        text.append(dayText, dayEnd);
+                        text += ',';
+                        text += orbit.name(i);
+                        text += ',';
+                        appendDouble(text, p.x);
+                        text += ',';
+                        appendDouble(text, p.y);
+                        text += ',';
+                        appendDouble(text, p.z);
+                        text += '\n';
+                    }
+                });
+                for (const std::string& text : chunkText) block.append(text);
+            }
+            writer.flushIfFull();
+        }
+        if (out) ok = writer.finish();
+    }
+    double runMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - runStart).count();
+    if (out && out != stdout) ok = std::fclose(out) == 0 && ok;
+    else if (out) ok = std::fflush(out) == 0 && ok;
+    if (!ok) std::cerr << "Writing the output failed" << std::endl;
+
+    // ---- machine readable report
+    double evaluations = static_cast<double>(n) * static_cast<double>(days > 0 ? days - 1 : 0) * substeps;
+    const char* mode = useNBody ? "nbody" : (useEphemeris ? "ephemeris" : "elements");
+    std::fprintf(report,
+                 "{\"catalogue\":\"%s\",\"ok\":%s,\"bodies\":%zu,\"days\":%llu,\"substeps\":%d,\"mode\":\"%s\","
+                 "\"threads\":%u,\"load_ms\":%.3f,\"evaluate_ms\":%.3f,\"run_ms\":%.3f,\"total_ms\":%.3f,"
+                 "\"evaluations_per_second\":%.6g}\n",
+                 jsonEscape(cataloguePath).c_str(), ok ? "true" : "false", n, static_cast<unsigned long long>(days), substeps, mode,
+                 workerCount(), loadMs, evaluateMs, runMs, loadMs + runMs,
+                 evaluateMs > 0.0 ? evaluations / (evaluateMs * 1e-3) : 0.0);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,225 @@
+#include "ephemeris.h"
+#include "parallel.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+const double PI = 3.14159265358979323846;
+const int NODES = EPHEMERIS_DEGREE + 1;
+
+// First window tried is the orbital period over this, then halved until
+// the fit is good enough
+const double INITIAL_WINDOWS_PER_ORBIT = 8.0;
+const int MAX_HALVINGS = 24;
+
+// Window for bodies without a mean motion (elements that only drift)
+const double DRIFT_WINDOW_DAYS = 3652.5;
+
+// Points per segment where the fit is compared against the exact orbit
+const int CHECK_POINTS = 4 * NODES;
+
+// Segments a track may keep even when the catalogue is huge
+const size_t MIN_SEGMENTS_PER_TRACK = 4;
+
+// Bodies per build() thread
+const size_t MIN_BODIES_PER_THREAD = 64;
+
+// cos(pi * j * (k + 0.5) / NODES), the fit matrix shared by all segments
+struct NodeTable
+{
+    double node[NODES];
+    double weight[NODES][NODES];
+
+    NodeTable()
+    {
+        for (int k = 0; k < NODES; ++k) node[k] = std::cos(PI * (k + 0.5) / NODES);
+        for (int j = 0; j < NODES; ++j) {
+            for (int k = 0; k < NODES; ++k) {
+                weight[j][k] = (j == 0 ? 1.0 : 2.0) / NODES * std::cos(PI * j * (k + 0.5) / NODES);
+            }
+        }
+    }
+};
+
+const NodeTable& nodeTable()
+{
+    static const NodeTable table;
+    return table;
+}
+
+// Coefficients of the fit over [t0, t0 + window], written to out[3 * (DEGREE + 1)]
+void fitSegment(const OrbitalElements& elem, double t0, double window, double* out)
+{
+    const NodeTable& table = nodeTable();
+    glm::dvec3 samples[NODES];
+    for (int k = 0; k < NODES; ++k) {
+        samples[k] = orbitPosition(elem, t0 + 0.5 * (table.node[k] + 1.0) * window);
+    }
+    for (int j = 0; j < NODES; ++j) {
+        glm::dvec3 c(0.0);
+        for (int k = 0; k < NODES; ++k) c += table.weight[j][k] * samples[k];
+        out[3 * j + 0] = c.x;
+        out[3 * j + 1] = c.y;
+        out[3 * j + 2] = c.z;
+    }
+}
+
+// Clenshaw recurrence at s in [-1, 1]
+inline glm::dvec3 evalSegment(const double* c, double s)
+{
+    double s2 = 2.0 * s;
+    double bx1 = 0.0, by1 = 0.0, bz1 = 0.0;
+    double bx2 = 0.0, by2 = 0.0, bz2 = 0.0;
+    for (int j = EPHEMERIS_DEGREE; j >= 1; --j) {
+        double bx = s2 * bx1 - bx2 + c[3 * j + 0];
+        double by = s2 * by1 - by2 + c[3 * j + 1];
+        double bz = s2 * bz1 - bz2 + c[3 * j + 2];
+        bx2 = bx1; by2 = by1; bz2 = bz1;
+        bx1 = bx;  by1 = by;  bz1 = bz;
+    }
+    return glm::dvec3(s * bx1 - bx2 + c[0],
+                      s * by1 - by2 + c[1],
+                      s * bz1 - bz2 + c[2]);
+}
+
+// Largest distance between the fit and the orbit over one segment
+double fitError(const OrbitalElements& elem, double t0, double window, const double* c)
+{
+    double worst = 0.0;
+    for (int k = 0; k <= CHECK_POINTS; ++k) {
+        double s = -1.0 + 2.0 * k / CHECK_POINTS;
+        glm::dvec3 exact = orbitPosition(elem, t0 + 0.5 * (s + 1.0) * window);
+        worst = std::max(worst, glm::length(evalSegment(c, s) - exact));
+    }
+    return worst;
+}
+
+bool isStatic(const OrbitalElements& e)
+{
+    return e.N2 == 0.0 && e.i2 == 0.0 && e.w2 == 0.0 && e.a2 == 0.0 && e.e2 == 0.0 && e.M2 == 0.0;
+}
+
+} // namespace
+
+void EphemerisCache::init(const std::vector<OrbitalElements>& elements, double toleranceAU)
+{
+    tolerance = toleranceAU;
+    tracks.clear();
+    tracks.resize(elements.size());
+    maxSegmentsPerTrack = std::max(MIN_SEGMENTS_PER_TRACK, EPHEMERIS_MAX_SEGMENTS / std::max<size_t>(tracks.size(), 1));
+
+    parallelFor(tracks.size(), MIN_BODIES_PER_THREAD, [&](size_t begin, size_t end) {
+        double c[COEFFS];
+        for (size_t i = begin; i < end; ++i) {
+            Track& track = tracks[i];
+            const OrbitalElements& e = elements[i];
+            track.elem = e;
+            if (isStatic(e)) {
+                track.fixedPosition = orbitPosition(e, 0.0);
+                continue;
+            }
+
+            // the segment centered on the perihelion passage nearest t = 0
+            double period = DRIFT_WINDOW_DAYS * INITIAL_WINDOWS_PER_ORBIT;
+            double perihelion = 0.0;
+            if (e.M2 != 0.0) {
+                period = 360.0 / std::fabs(e.M2);
+                perihelion = -(e.M1 - 360.0 * std::nearbyint(e.M1 / 360.0)) / e.M2;
+            }
+
+            double window = period / INITIAL_WINDOWS_PER_ORBIT;
+            double error = 0.0;
+            for (int h = 0; h < MAX_HALVINGS; ++h) {
+                double t0 = perihelion - 0.5 * window;
+                fitSegment(e, t0, window, c);
+                error = fitError(e, t0, window, c);
+                if (error <= tolerance) break;
+                window *= 0.5;
+            }
+            track.window = window;
+            track.errorBound = error;
+        }
+    });
+}
+
+uint32_t EphemerisCache::segment(Track& track, int64_t k)
+{
+    if (k == track.lastSegment) return track.lastOffset;
+
+    auto found = track.index.find(k);
+    uint32_t offset;
+    if (found != track.index.end()) {
+        offset = found->second;
+    } else {
+        uint32_t slot;
+        if (track.slotSegment.size() < maxSegmentsPerTrack) {
+            slot = static_cast<uint32_t>(track.slotSegment.size());
+            track.slotSegment.push_back(k);
+            track.coeffs.resize((slot + 1) * COEFFS);
+        } else {
+            // full: refit the oldest slot
+            slot = track.nextSlot;
+            track.nextSlot = static_cast<uint32_t>((slot + 1) % maxSegmentsPerTrack);
+            track.index.erase(track.slotSegment[slot]);
+            track.slotSegment[slot] = k;
+        }
+        offset = slot * COEFFS;
+        fitSegment(track.elem, k * track.window, track.window, &track.coeffs[offset]);
+        track.index.emplace(k, offset);
+    }
+    track.lastSegment = k;
+    track.lastOffset = offset;
+    return offset;
+}
+
+glm::dvec3 EphemerisCache::position(size_t body, double t)
+{
+    Track& track = tracks[body];
+    if (track.window == 0.0) return track.fixedPosition;
+
+    double u = t / track.window;
+    double k = std::floor(u);
+    uint32_t offset = segment(track, static_cast<int64_t>(k));
+    return evalSegment(&track.coeffs[offset], 2.0 * (u - k) - 1.0);
+}
+
+void EphemerisCache::build(double t0, double t1)
+{
+    if (t1 < t0) std::swap(t0, t1);
+    parallelFor(tracks.size(), MIN_BODIES_PER_THREAD, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            Track& track = tracks[i];
+            if (track.window == 0.0) continue;
+            int64_t first = static_cast<int64_t>(std::floor(t0 / track.window));
+            int64_t last = static_cast<int64_t>(std::floor(t1 / track.window));
+            // no more than the track keeps, around the middle of the range
+            int64_t keep = static_cast<int64_t>(maxSegmentsPerTrack);
+            if (last - first + 1 > keep) {
+                int64_t middle = static_cast<int64_t>(std::floor(0.5 * (t0 + t1) / track.window));
+                first = std::max(first, std::min(middle - keep / 2, last - keep + 1));
+                last = first + keep - 1;
+            }
+            track.index.reserve(std::min(track.index.size() + static_cast<size_t>(last - first + 1), maxSegmentsPerTrack));
+            for (int64_t k = first; k <= last; ++k) segment(track, k);
+        }
+    });
+}
+
+void EphemerisCache::clear()
+{
+    for (auto& track : tracks) {
+        track.index.clear();
+        std::vector<double>().swap(track.coeffs);
+        std::vector<int64_t>().swap(track.slotSegment);
+        track.nextSlot = 0;
+        track.lastSegment = INT64_MIN;
+    }
+}
+
+size_t EphemerisCache::segmentCount() const
+{
+    size_t count = 0;
+    for (const auto& track : tracks) count += track.index.size();
+    return count;
+}
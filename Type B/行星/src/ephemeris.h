@@ -0,0 +1,79 @@
+#ifndef EPHEMERIS_H
+#define EPHEMERIS_H
+
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#include "kepler.h"
+
+// Chebyshev degree of every segment
+const int EPHEMERIS_DEGREE = 12;
+
+// Default position error allowed per body, in AU (1e-9 AU is about 150 m)
+const double EPHEMERIS_TOLERANCE_AU = 1e-9;
+
+// Fitted segments kept over all bodies (about 80 MB of coefficients)
+const size_t EPHEMERIS_MAX_SEGMENTS = 1 << 18;
+
+// Piecewise Chebyshev fits of orbitPosition(), one track per body.
+// Each body's time axis is cut into windows of a fixed length, chosen at
+// init() so the fit around perihelion (the fastest-turning part of the
+// orbit) stays within the tolerance. Segments are fitted on first use or
+// ahead of time with build(); a lookup is then a hash probe (skipped when
+// the segment is the same as last time) and a Clenshaw sum per axis.
+//
+// Each track keeps at most its share of EPHEMERIS_MAX_SEGMENTS. Once full,
+// a new segment replaces the oldest fitted one of that track, so memory
+// stays bounded however far the clock runs; going back to a dropped
+// segment just fits it again.
+//
+// errorBound() is the error measured between the fit nodes on that
+// perihelion segment, not a proven bound, but every other segment of the
+// same window length is smoother.
+class EphemerisCache
+{
+public:
+    void init(const std::vector<OrbitalElements>& elements,
+              double toleranceAU = EPHEMERIS_TOLERANCE_AU);
+
+    // Fit every segment touching [t0, t1] for all bodies, in parallel; a
+    // track with room for fewer gets the ones around the middle of the range
+    void build(double t0, double t1);
+
+    // Position of a body at day t, fitting its segment if needed. Calls for
+    // different bodies may run on different threads at the same time.
+    glm::dvec3 position(size_t body, double t);
+
+    // Drop all fitted segments, keeping the tuned windows
+    void clear();
+
+    size_t size() const { return tracks.size(); }
+    double window(size_t body) const { return tracks[body].window; }
+    double errorBound(size_t body) const { return tracks[body].errorBound; }
+    size_t segmentCount() const;
+
+private:
+    static const int COEFFS = 3 * (EPHEMERIS_DEGREE + 1);   // x, y, z interleaved
+
+    struct Track {
+        OrbitalElements elem;
+        double window = 0.0;       // days, 0 for a body that never moves
+        glm::dvec3 fixedPosition = glm::dvec3(0.0);   // used when window is 0
+        double errorBound = 0.0;
+        std::unordered_map<int64_t, uint32_t> index;   // segment -> offset into coeffs
+        std::vector<double> coeffs;
+        std::vector<int64_t> slotSegment;   // segment held by each COEFFS slot
+        uint32_t nextSlot = 0;              // oldest slot, replaced next once full
+        int64_t lastSegment = INT64_MIN;
+        uint32_t lastOffset = 0;
+    };
+
+    uint32_t segment(Track& track, int64_t k);
+
+    std::vector<Track> tracks;
+    double tolerance = EPHEMERIS_TOLERANCE_AU;
+    size_t maxSegmentsPerTrack = 0;
+};
+
+#endif
@@ -0,0 +1,250 @@
+#include "kepler.h"
+#include "parallel.h"
+#include <algorithm>
+#include <cmath>
+
+#if defined(__AVX2__) && defined(__FMA__)
+#include <immintrin.h>
+#define KEPLER_AVX2 1
+#endif
+
+namespace {
+
+const double PI = 3.14159265358979323846;
+const double TWO_PI = 2.0 * PI;
+const double DEG2RAD = PI / 180.0;
+
+// Smallest share of bodies worth a thread in evaluateAll()
+const size_t MIN_BODIES_PER_THREAD = 4096;
+
+// Degrees wrapped to [-180, 180] before converting, so the trig
+// reductions never see large arguments as t grows
+inline double wrapDegrees(double deg)
+{
+    return deg - 360.0 * std::nearbyint(deg / 360.0);
+}
+
+inline double clampEccentricity(double e)
+{
+    return std::min(std::max(e, 0.0), KEPLER_MAX_ECCENTRICITY);
+}
+
+// Rotate the in-plane position (xv, yv) by the argument of perihelion,
+// inclination and node into the reference frame (Y up)
+inline glm::dvec3 toReferenceFrame(double xv, double yv,
+                                   double sinN, double cosN, double sini, double cosi,
+                                   double sinw, double cosw)
+{
+    double X = xv * cosw - yv * sinw;   // r cos(v + w)
+    double Y = xv * sinw + yv * cosw;   // r sin(v + w)
+    return glm::dvec3(cosN * X - sinN * cosi * Y,
+                      sini * Y,
+                      -(sinN * X + cosN * cosi * Y));
+}
+
+#ifdef KEPLER_AVX2
+
+// pi/2 in three parts for Cody-Waite reduction (fdlibm)
+const double PIO2_1 = 1.57079632673412561417e+00;
+const double PIO2_2 = 6.07710050650619224932e-11;
+const double PIO2_3 = 2.02226624879595063154e-21;
+
+// sin and cos of four doubles: reduce by pi/2 to [-pi/4, pi/4], evaluate
+// the Cephes minimax polynomials, then rotate by the quadrant. Good to a
+// couple of ulp for the wrapped angles used here.
+inline void sincos4(__m256d x, __m256d& s, __m256d& c)
+{
+    __m256d j = _mm256_round_pd(_mm256_mul_pd(x, _mm256_set1_pd(2.0 / PI)),
+                                _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+    __m256d r = _mm256_fnmadd_pd(j, _mm256_set1_pd(PIO2_1), x);
+    r = _mm256_fnmadd_pd(j, _mm256_set1_pd(PIO2_2), r);
+    r = _mm256_fnmadd_pd(j, _mm256_set1_pd(PIO2_3), r);
+    __m256d z = _mm256_mul_pd(r, r);
+
+    __m256d ps = _mm256_set1_pd(1.58962301576546568060e-10);
+    ps = _mm256_fmadd_pd(ps, z, _mm256_set1_pd(-2.50507477628578072866e-8));
+    ps = _mm256_fmadd_pd(ps, z, _mm256_set1_pd(2.75573136213857245213e-6));
+    ps = _mm256_fmadd_pd(ps, z, _mm256_set1_pd(-1.98412698295895385996e-4));
+    ps = _mm256_fmadd_pd(ps, z, _mm256_set1_pd(8.33333333332211858878e-3));
+    ps = _mm256_fmadd_pd(ps, z, _mm256_set1_pd(-1.66666666666666307295e-1));
+    __m256d sr = _mm256_fmadd_pd(_mm256_mul_pd(r, z), ps, r);
+
+    __m256d pc = _mm256_set1_pd(-1.13585365213876817300e-11);
+    pc = _mm256_fmadd_pd(pc, z, _mm256_set1_pd(2.08757008419747316778e-9));
+    pc = _mm256_fmadd_pd(pc, z, _mm256_set1_pd(-2.75573141792967388112e-7));
+    pc = _mm256_fmadd_pd(pc, z, _mm256_set1_pd(2.48015872888517045348e-5));
+    pc = _mm256_fmadd_pd(pc, z, _mm256_set1_pd(-1.38888888888730564116e-3));
+    pc = _mm256_fmadd_pd(pc, z, _mm256_set1_pd(4.16666666666665929218e-2));
+    __m256d cr = _mm256_fmadd_pd(_mm256_mul_pd(z, z), pc,
+                                 _mm256_fnmadd_pd(_mm256_set1_pd(0.5), z, _mm256_set1_pd(1.0)));
+
+    // quadrant q: odd swaps sin and cos, bit 1 of q (or q + 1) flips the sign
+    __m256i q = _mm256_cvtepi32_epi64(_mm256_cvtpd_epi32(j));
+    __m256i one = _mm256_set1_epi64x(1);
+    __m256i two = _mm256_set1_epi64x(2);
+    __m256d swap = _mm256_castsi256_pd(_mm256_cmpeq_epi64(_mm256_and_si256(q, one), one));
+    __m256d sinSign = _mm256_castsi256_pd(_mm256_slli_epi64(_mm256_and_si256(q, two), 62));
+    __m256d cosSign = _mm256_castsi256_pd(
+        _mm256_slli_epi64(_mm256_and_si256(_mm256_add_epi64(q, one), two), 62));
+
+    s = _mm256_xor_pd(_mm256_blendv_pd(sr, cr, swap), sinSign);
+    c = _mm256_xor_pd(_mm256_blendv_pd(cr, sr, swap), cosSign);
+}
+
+inline __m256d wrapRadians4(__m256d deg)
+{
+    __m256d turns = _mm256_round_pd(_mm256_mul_pd(deg, _mm256_set1_pd(1.0 / 360.0)),
+                                    _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+    return _mm256_mul_pd(_mm256_fnmadd_pd(turns, _mm256_set1_pd(360.0), deg), _mm256_set1_pd(DEG2RAD));
+}
+
+#endif
+
+} // namespace
+
+double solveKepler(double M, double e)
+{
+    e = clampEccentricity(e);
+    M -= TWO_PI * std::nearbyint(M / TWO_PI);   // [-pi, pi], where sign(sin M) = sign(M)
+
+    double E = M + (M < 0.0 ? -0.85 : 0.85) * e;
+    for (int k = 0; k < KEPLER_MAX_ITERATIONS; ++k) {
+        double s = std::sin(E), c = std::cos(E);
+        double f = E - e * s - M;
+        double f1 = 1.0 - e * c;
+        double dE = f * f1 / (f1 * f1 - 0.5 * f * e * s);
+        E -= dE;
+        if (std::fabs(dE) < KEPLER_TOLERANCE) break;
+    }
+    return E;
+}
+
+glm::dvec3 orbitPosition(const OrbitalElements& elem, double t)
+{
+    double N   = wrapDegrees(elem.N1 + elem.N2 * t) * DEG2RAD;
+    double inc = wrapDegrees(elem.i1 + elem.i2 * t) * DEG2RAD;
+    double w   = wrapDegrees(elem.w1 + elem.w2 * t) * DEG2RAD;
+    double a   = elem.a1 + elem.a2 * t;
+    double ecc = clampEccentricity(elem.e1 + elem.e2 * t);
+    double M   = wrapDegrees(elem.M1 + elem.M2 * t) * DEG2RAD;
+
+    double E = solveKepler(M, ecc);
+    double xv = a * (std::cos(E) - ecc);
+    double yv = a * std::sqrt(1.0 - ecc * ecc) * std::sin(E);
+
+    return toReferenceFrame(xv, yv, std::sin(N), std::cos(N), std::sin(inc), std::cos(inc),
+                            std::sin(w), std::cos(w));
+}
+
+glm::dvec3 OrbitShape::point(double E) const
+{
+    return P * (a * (std::cos(E) - e)) + Q * (b * std::sin(E));
+}
+
+OrbitShape orbitShape(const OrbitalElements& elem, double t)
+{
+    double N   = wrapDegrees(elem.N1 + elem.N2 * t) * DEG2RAD;
+    double inc = wrapDegrees(elem.i1 + elem.i2 * t) * DEG2RAD;
+    double w   = wrapDegrees(elem.w1 + elem.w2 * t) * DEG2RAD;
+    double sinN = std::sin(N), cosN = std::cos(N), sini = std::sin(inc), cosi = std::cos(inc);
+    double sinw = std::sin(w), cosw = std::cos(w);
+
+    OrbitShape shape;
+    shape.a = elem.a1 + elem.a2 * t;
+    shape.e = clampEccentricity(elem.e1 + elem.e2 * t);
+    shape.b = shape.a * std::sqrt(1.0 - shape.e * shape.e);
+    shape.P = toReferenceFrame(1.0, 0.0, sinN, cosN, sini, cosi, sinw, cosw);
+    shape.Q = toReferenceFrame(0.0, 1.0, sinN, cosN, sini, cosi, sinw, cosw);
+    return shape;
+}
+
+void OrbitBatch::clear()
+{
+    for (auto* v : {&N1, &N2, &i1, &i2, &w1, &w2, &a1, &a2, &e1, &e2, &M1, &M2}) v->clear();
+}
+
+void OrbitBatch::add(const OrbitalElements& elem)
+{
+    N1.push_back(elem.N1); N2.push_back(elem.N2);
+    i1.push_back(elem.i1); i2.push_back(elem.i2);
+    w1.push_back(elem.w1); w2.push_back(elem.w2);
+    a1.push_back(elem.a1); a2.push_back(elem.a2);
+    e1.push_back(elem.e1); e2.push_back(elem.e2);
+    M1.push_back(elem.M1); M2.push_back(elem.M2);
+}
+
+void OrbitBatch::evaluate(double t, double* x, double* y, double* z, size_t begin, size_t end) const
+{
+    size_t i = begin;
+
+#ifdef KEPLER_AVX2
+    const __m256d tv = _mm256_set1_pd(t);
+    const __m256d one = _mm256_set1_pd(1.0);
+    const __m256d signMask = _mm256_set1_pd(-0.0);
+    const __m256d tolerance = _mm256_set1_pd(KEPLER_TOLERANCE);
+
+    for (; i + 4 <= end; i += 4) {
+        __m256d N   = wrapRadians4(_mm256_fmadd_pd(_mm256_loadu_pd(&N2[i]), tv, _mm256_loadu_pd(&N1[i])));
+        __m256d inc = wrapRadians4(_mm256_fmadd_pd(_mm256_loadu_pd(&i2[i]), tv, _mm256_loadu_pd(&i1[i])));
+        __m256d w   = wrapRadians4(_mm256_fmadd_pd(_mm256_loadu_pd(&w2[i]), tv, _mm256_loadu_pd(&w1[i])));
+        __m256d M   = wrapRadians4(_mm256_fmadd_pd(_mm256_loadu_pd(&M2[i]), tv, _mm256_loadu_pd(&M1[i])));
+        __m256d a   = _mm256_fmadd_pd(_mm256_loadu_pd(&a2[i]), tv, _mm256_loadu_pd(&a1[i]));
+        __m256d ecc = _mm256_fmadd_pd(_mm256_loadu_pd(&e2[i]), tv, _mm256_loadu_pd(&e1[i]));
+        ecc = _mm256_max_pd(_mm256_min_pd(ecc, _mm256_set1_pd(KEPLER_MAX_ECCENTRICITY)), _mm256_setzero_pd());
+
+        // Halley on all four lanes until every lane has converged
+        __m256d E = _mm256_add_pd(M, _mm256_or_pd(_mm256_and_pd(M, signMask),
+                                                  _mm256_mul_pd(_mm256_set1_pd(0.85), ecc)));
+        __m256d sE, cE;
+        for (int k = 0; k < KEPLER_MAX_ITERATIONS; ++k) {
+            sincos4(E, sE, cE);
+            __m256d es = _mm256_mul_pd(ecc, sE);
+            __m256d f = _mm256_sub_pd(_mm256_sub_pd(E, es), M);
+            __m256d f1 = _mm256_fnmadd_pd(ecc, cE, one);
+            __m256d den = _mm256_fnmadd_pd(_mm256_mul_pd(_mm256_set1_pd(0.5), f), es, _mm256_mul_pd(f1, f1));
+            __m256d dE = _mm256_div_pd(_mm256_mul_pd(f, f1), den);
+            E = _mm256_sub_pd(E, dE);
+
+            // first order update of sin/cos for the last small step
+            __m256d sNext = _mm256_fnmadd_pd(cE, dE, sE);
+            cE = _mm256_fmadd_pd(sE, dE, cE);
+            sE = sNext;
+
+            __m256d small = _mm256_cmp_pd(_mm256_andnot_pd(signMask, dE), tolerance, _CMP_LT_OQ);
+            if (_mm256_movemask_pd(small) == 0xF) break;
+        }
+
+        __m256d b = _mm256_mul_pd(a, _mm256_sqrt_pd(_mm256_fnmadd_pd(ecc, ecc, one)));
+        __m256d xv = _mm256_mul_pd(a, _mm256_sub_pd(cE, ecc));
+        __m256d yv = _mm256_mul_pd(b, sE);
+
+        __m256d sN, cN, si, ci, sw, cw;
+        sincos4(N, sN, cN);
+        sincos4(inc, si, ci);
+        sincos4(w, sw, cw);
+
+        __m256d X = _mm256_fmsub_pd(xv, cw, _mm256_mul_pd(yv, sw));
+        __m256d Y = _mm256_fmadd_pd(xv, sw, _mm256_mul_pd(yv, cw));
+        __m256d ciY = _mm256_mul_pd(ci, Y);
+        _mm256_storeu_pd(&x[i], _mm256_fnmadd_pd(sN, ciY, _mm256_mul_pd(cN, X)));
+        _mm256_storeu_pd(&y[i], _mm256_mul_pd(si, Y));
+        _mm256_storeu_pd(&z[i], _mm256_xor_pd(_mm256_fmadd_pd(cN, ciY, _mm256_mul_pd(sN, X)), signMask));
+    }
+#endif
+
+    for (; i < end; ++i) {
+        OrbitalElements elem = {N1[i], N2[i], i1[i], i2[i], w1[i], w2[i],
+                                a1[i], a2[i], e1[i], e2[i], M1[i], M2[i], 0.0, 0};
+        glm::dvec3 p = orbitPosition(elem, t);
+        x[i] = p.x;
+        y[i] = p.y;
+        z[i] = p.z;
+    }
+}
+
+void OrbitBatch::evaluateAll(double t, double* x, double* y, double* z) const
+{
+    parallelFor(size(), MIN_BODIES_PER_THREAD, [&](size_t begin, size_t end) {
+        evaluate(t, x, y, z, begin, end);
+    });
+}
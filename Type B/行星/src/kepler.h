@@ -0,0 +1,69 @@
+#ifndef KEPLER_H
+#define KEPLER_H
+
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <vector>
+
+// Keplerian elements as linear functions of the day number t
+// (days since 2000 Jan 0.0): value = x1 + x2 * t. Angles in degrees,
+// a in AU.
+struct OrbitalElements {
+    double N1, N2;      // longitude of the ascending node
+    double i1, i2;      // inclination
+    double w1, w2;      // argument of perihelion
+    double a1, a2;      // semi-major axis
+    double e1, e2;      // eccentricity
+    double M1, M2;      // mean anomaly
+    double rotPeriod;   // days
+    int centerOfOrbit;
+};
+
+// Newton/Halley iterations stop once the correction is below this (radians)
+const double KEPLER_TOLERANCE = 1e-12;
+const int KEPLER_MAX_ITERATIONS = 16;
+
+// Elliptic orbits only; larger eccentricities are clamped
+const double KEPLER_MAX_ECCENTRICITY = 0.999999;
+
+// Eccentric anomaly E from the mean anomaly M (radians), solving
+// M = E - e sin E with Halley's method from Danby's starting guess
+double solveKepler(double M, double e);
+
+// Position at day t in AU, relative to the center of the orbit.
+// Y is up, matching the original renderer.
+glm::dvec3 orbitPosition(const OrbitalElements& elem, double t);
+
+// Size, shape and orientation of an orbit at day t, without the mean
+// anomaly: the point at eccentric anomaly E, relative to the center of the
+// orbit, is P a (cos E - e) + Q b sin E
+struct OrbitShape {
+    double a, e, b;
+    glm::dvec3 P, Q;   // unit vectors toward perihelion and 90 degrees ahead
+
+    glm::dvec3 point(double E) const;
+};
+
+OrbitShape orbitShape(const OrbitalElements& elem, double t);
+
+// Orbital elements of many bodies as a structure of arrays. evaluate()
+// works on four bodies at a time with AVX2 when the compiler targets it
+// (-mavx2 -mfma, /arch:AVX2) and falls back to scalar code otherwise.
+class OrbitBatch
+{
+public:
+    void clear();
+    void add(const OrbitalElements& elem);
+    size_t size() const { return N1.size(); }
+
+    // Positions of bodies [begin, end) at day t
+    void evaluate(double t, double* x, double* y, double* z, size_t begin, size_t end) const;
+
+    // All bodies, split across the worker threads
+    void evaluateAll(double t, double* x, double* y, double* z) const;
+
+private:
+    std::vector<double> N1, N2, i1, i2, w1, w2, a1, a2, e1, e2, M1, M2;
+};
+
+#endif
@@ -5,12 +5,16 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
 #include <iostream>
+#include <string>
 #include <vector>
 
 #include "planet.h"
 #include "shader.h"
-#include "sphere.h"
+#include "sim_clock.h"
 
 // stb image for texture
 #define STB_IMAGE_IMPLEMENTATION
@@ -27,8 +31,16 @@ void cursorPosCallback(GLFWwindow* window, double xpos, double ypos);
 // =================Window Settings=====================
 const int WIDTH = 800;
 const int HEIGHT = 600;
-   
-float gTranslateZ = 15.0f;     
+
+// Projection has no far plane; near is in GL units
+const float FOV_DEGREES = 45.0f;
+const float NEAR_PLANE = 0.01f;
+
+float gTranslateZ = 15.0f;     // distance from the eye to the focus
+const float ZOOM_FACTOR = 1.015f;
+const float MIN_DISTANCE = 0.05f;
+int    gFocusBody = -1;        // body the camera orbits, -1 for the origin
+bool   gNextFocus = false;
 
 // Mouse-controlled camera rotation
 bool   gMousePressed = false;
@@ -37,8 +49,101 @@ double gLastMouseY   = 0.0;
 float  gYaw          = 0.0f;  // rotate around Y
 float  gPitch        = 0.0f;  // rotate around X
 
+// Simulation time control
+SimClock gClock;               // days since 2000 Jan 0.0, 5 days per second to start
+bool   gToggleEphemeris = false;
+bool   gToggleNBody = false;
+bool   gToggleOrbits = false;
+bool   gToggleTrails = false;
+int    gLodBiasChange = 0;     // [ and ] coarsen or refine the spheres
+
+const double WARP_FACTOR = 10.0;          // per press of = or -
+const double TITLE_INTERVAL = 0.5;        // seconds between window title updates
+const size_t MAX_ENCOUNTER_LINES = 8;     // close approaches printed per frame
+
+// glClipControl is GL 4.5 (or ARB_clip_control), fetched by hand on a 3.3 context
+#ifndef GL_LOWER_LEFT
+#define GL_LOWER_LEFT 0x8CA1
+#endif
+#ifndef GL_ZERO_TO_ONE
+#define GL_ZERO_TO_ONE 0x935F
+#endif
+typedef void (APIENTRY* ClipControlProc)(GLenum origin, GLenum depth);
+
 // ================== Helper Functions ==================
 
+// Offscreen target the scene is drawn into, then blitted to the window.
+// Its depth buffer is 32-bit float: with reversed Z (depth 1 at the near
+// plane, 0 at infinity) float spacing matches perspective spacing, so
+// depth stays exact from a moon's surface out past Neptune.
+struct SceneTarget {
+  GLuint fbo = 0, color = 0, depth = 0;
+  int width = 0, height = 0;
+  bool reversedZ = false;
+};
+
+bool createSceneTarget(SceneTarget& target, int width, int height)
+{
+  target.width = width;
+  target.height = height;
+
+  glGenFramebuffers(1, &target.fbo);
+  glBindFramebuffer(GL_FRAMEBUFFER, target.fbo);
+  glGenRenderbuffers(1, &target.color);
+  glBindRenderbuffer(GL_RENDERBUFFER, target.color);
+  glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+  glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, target.color);
+  glGenRenderbuffers(1, &target.depth);
+  glBindRenderbuffer(GL_RENDERBUFFER, target.depth);
+  glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT32F, width, height);
+  glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, target.depth);
+  bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+  if (!complete) {
+    std::cout << "Scene framebuffer incomplete, drawing to the window" << std::endl;
+    return false;
+  }
+
+  // a non-null address alone proves nothing (GLX hands one out for any
+  // name), so check for GL 4.5 or the extension first
+  GLFWwindow* context = glfwGetCurrentContext();
+  int major = glfwGetWindowAttrib(context, GLFW_CONTEXT_VERSION_MAJOR);
+  int minor = glfwGetWindowAttrib(context, GLFW_CONTEXT_VERSION_MINOR);
+  bool supported = major > 4 || (major == 4 && minor >= 5) || glfwExtensionSupported("GL_ARB_clip_control");
+  ClipControlProc clipControl = supported ? (ClipControlProc)glfwGetProcAddress("glClipControl") : nullptr;
+  if (clipControl) {
+    clipControl(GL_LOWER_LEFT, GL_ZERO_TO_ONE);
+    glClearDepth(0.0);
+    glDepthFunc(GL_GREATER);
+    target.reversedZ = true;
+  } else {
+    std::cout << "glClipControl not available, using standard depth" << std::endl;
+  }
+  return true;
+}
+
+void destroySceneTarget(SceneTarget& target)
+{
+  if (target.fbo) glDeleteFramebuffers(1, &target.fbo);
+  GLuint buffers[] = {target.color, target.depth};
+  glDeleteRenderbuffers(2, buffers);
+  target = SceneTarget();
+}
+
+// Perspective without a far plane. Reversed, clip z is the near distance
+// so depth = near / distance; otherwise the usual infinite projection.
+glm::mat4 infiniteProjection(float fovy, float aspect, float zNear, bool reversed)
+{
+  if (!reversed) return glm::infinitePerspective(fovy, aspect, zNear);
+  float f = 1.0f / std::tan(fovy / 2.0f);
+  glm::mat4 p(0.0f);
+  p[0][0] = f / aspect;
+  p[1][1] = f;
+  p[2][3] = -1.0f;
+  p[3][2] = zNear;
+  return p;
+}
+
 GLuint loadTexture(const char* paths)
 {
   GLuint texID;
@@ -69,6 +174,78 @@ GLuint loadTexture(const char* paths)
   return texID;
 }
 
+// Box-filter resample of an RGBA image; shrinks average the covered
+// source pixels, enlargements repeat them
+static std::vector<unsigned char> resampleRGBA(const unsigned char* src, int sw, int sh, int dw, int dh)
+{
+  std::vector<unsigned char> dst(static_cast<size_t>(dw) * dh * 4);
+  for (int y = 0; y < dh; ++y) {
+    int y0 = y * sh / dh;
+    int y1 = std::max(y0 + 1, (y + 1) * sh / dh);
+    for (int x = 0; x < dw; ++x) {
+      int x0 = x * sw / dw;
+      int x1 = std::max(x0 + 1, (x + 1) * sw / dw);
+      unsigned int sum[4] = {0, 0, 0, 0};
+      for (int sy = y0; sy < y1; ++sy)
+        for (int sx = x0; sx < x1; ++sx)
+          for (int c = 0; c < 4; ++c) sum[c] += src[(static_cast<size_t>(sy) * sw + sx) * 4 + c];
+      unsigned int n = static_cast<unsigned int>((y1 - y0) * (x1 - x0));
+      for (int c = 0; c < 4; ++c)
+        dst[(static_cast<size_t>(y) * dw + x) * 4 + c] = static_cast<unsigned char>((sum[c] + n / 2) / n);
+    }
+  }
+  return dst;
+}
+
+// All images as layers of one GL_TEXTURE_2D_ARRAY. Layers share a size:
+// the largest image, capped at maxWidth x maxHeight; others are resampled.
+// Files that fail to load become grey layers so the indices stay valid.
+GLuint loadTextureArray(const std::vector<std::string>& paths, int maxWidth, int maxHeight)
+{
+  struct Image { unsigned char* data; int width, height; };
+  std::vector<Image> images(paths.size());
+  int width = 1, height = 1;
+
+  stbi_set_flip_vertically_on_load(true);
+  for (size_t i = 0; i < paths.size(); ++i) {
+    int channels;
+    images[i].data = stbi_load(paths[i].c_str(), &images[i].width, &images[i].height, &channels, 4);
+    if (!images[i].data) {
+      std::cout << "Failed to load texture: " << paths[i] << std::endl;
+      continue;
+    }
+    width = std::max(width, std::min(images[i].width, maxWidth));
+    height = std::max(height, std::min(images[i].height, maxHeight));
+  }
+
+  GLuint texID;
+  glGenTextures(1, &texID);
+  glBindTexture(GL_TEXTURE_2D_ARRAY, texID);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA8, width, height, static_cast<GLsizei>(std::max<size_t>(paths.size(), 1)),
+               0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+
+  for (size_t i = 0; i < images.size(); ++i) {
+    std::vector<unsigned char> layer;
+    if (!images[i].data) {
+      layer.assign(static_cast<size_t>(width) * height * 4, 128);
+    } else if (images[i].width != width || images[i].height != height) {
+      layer = resampleRGBA(images[i].data, images[i].width, images[i].height, width, height);
+    } else {
+      layer.assign(images[i].data, images[i].data + static_cast<size_t>(width) * height * 4);
+    }
+    stbi_image_free(images[i].data);
+    glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, static_cast<GLint>(i), width, height, 1,
+                    GL_RGBA, GL_UNSIGNED_BYTE, layer.data());
+  }
+  glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+
+  return texID;
+}
+
 GLFWwindow* initialize() {
   // Init GLFW
   int glfwInitRes = glfwInit();
@@ -128,16 +305,29 @@ GLFWwindow* initialize() {
 }
 
 // The MAIN function, from here we start the application and run the game loop
-int main() {
+// Usage: Planets [catalogue.csv | catalogue.bin]
+int main(int argc, char** argv) {
   GLFWwindow* window = initialize();
   if (!window) {
     return 0;
   }
 
+  std::string cataloguePath = argc > 1 ? argv[1] : "resources/catalogue/solar_system.csv";
   PlanetSystem ps;
-  ps.init();
+  if (!ps.init(cataloguePath)) {
+    glfwDestroyWindow(window);
+    glfwTerminate();
+    return 1;
+  }
 
-  double lastTime = glfwGetTime();
+  gClock.setLimits(ps.maxStepDays(), ps.maxSubsteps());
+
+  int fbWidth, fbHeight;
+  glfwGetFramebufferSize(window, &fbWidth, &fbHeight);
+  SceneTarget scene;
+  if (!createSceneTarget(scene, fbWidth, fbHeight)) destroySceneTarget(scene);
+  ps.setViewport(fbWidth, fbHeight);
+  ps.setDepthZeroToOne(scene.reversedZ);
 
   //======================Background Picture===================================
   // Set up vertex data (and buffer(s)) and attribute pointers                 
@@ -169,29 +359,19 @@ int main() {
 
   glBindVertexArray(0);  // Unbind VAO
   
-  // ================== create sphere and name==============================
-  GLuint sphereVBO, sphereVAO, sphereEBO;
-  int sphereIndexCount =0;
-  createSphere(1.0f, 32, 64, sphereVAO, sphereVBO, sphereEBO, sphereIndexCount);
-
-  
-
   // ------------------- LOAD TEXTURES/SHADERS -------------------
   const char* bgPath = "resources/tex/background.png";
   
   GLuint bgTexture = loadTexture(bgPath);
 
   // Build and compile our shader program
-  Shader planetShader("resources/shaders/main.vert", "resources/shaders/main.frag");
   Shader bgShader("resources/shaders/bg.vert", "resources/shaders/bg.frag");
 
   bgShader.Use();
   glUniform1i(glGetUniformLocation(bgShader.Program, "bgTexture"), 0);
 
-  planetShader.Use();
-  glUniform1i(glGetUniformLocation(planetShader.Program, "uTexture"), 0);
-  
-  lastTime = (float)glfwGetTime();
+  double lastTime = glfwGetTime();
+  double lastTitleTime = lastTime;
   // Game loop
   while (!glfwWindowShouldClose(window)) {
     // Check if any events have been activiated (key pressed, mouse moved etc.)
@@ -199,12 +379,13 @@ int main() {
     glfwPollEvents();
 
     // ====== 时间更新 ======
-    float currentTime = (float)glfwGetTime();
-    float deltaTime   = currentTime - lastTime;
+    double currentTime = glfwGetTime();
+    double deltaTime   = currentTime - lastTime;
     lastTime = currentTime;
 
     // Render
     // Clear the colorbuffer
+    glBindFramebuffer(GL_FRAMEBUFFER, scene.fbo);
     glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
@@ -218,30 +399,91 @@ int main() {
     glBindVertexArray(0);
     glEnable(GL_DEPTH_TEST);
 
-    planetShader.Use();
-    
-    // camera matrixes
+    if (gNextFocus) {
+      gNextFocus = false;
+      gFocusBody = gFocusBody + 1 < static_cast<int>(ps.bodyCount()) ? gFocusBody + 1 : -1;
+      std::cout << "Focus: " << (gFocusBody < 0 ? std::string("origin") : ps.bodyName(gFocusBody)) << std::endl;
+    }
+
+    if (gToggleEphemeris) {
+      gToggleEphemeris = false;
+      ps.setUseEphemeris(!ps.usingEphemeris());
+      std::cout << (ps.usingEphemeris() ? "Ephemeris cache on" : "Ephemeris cache off") << std::endl;
+    }
+    if (gToggleNBody) {
+      gToggleNBody = false;
+      ps.setUseNBody(!ps.usingNBody());
+      std::cout << (ps.usingNBody() ? "N-body integration" : "Keplerian orbits") << std::endl;
+    }
+    if (gToggleOrbits) {
+      gToggleOrbits = false;
+      ps.setShowOrbits(!ps.showingOrbits());
+    }
+    if (gToggleTrails) {
+      gToggleTrails = false;
+      ps.setShowTrails(!ps.showingTrails());
+    }
+    if (gLodBiasChange != 0) {
+      ps.setLodBias(ps.lodBias() + gLodBiasChange);
+      gLodBiasChange = 0;
+      std::cout << "Sphere detail bias: " << ps.lodBias() << std::endl;
+    }
+
+    // fixed steps, however long the frame took, then draw in between
+    int steps = gClock.advance(deltaTime);
+    if (steps > 0) ps.advance(gClock.step(steps), steps);
+    gClock.setLimits(ps.maxStepDays(), ps.maxSubsteps());   // from this frame's step timing
+    ps.interpolate(gClock.alpha());
+
+    const std::vector<Encounter>& met = ps.newEncounters();
+    for (size_t k = 0; k < met.size() && k < MAX_ENCOUNTER_LINES; ++k) {
+      std::cout << "Close approach: " << ps.bodyName(met[k].a) << " and " << ps.bodyName(met[k].b)
+                << ", " << met[k].distanceAU << " AU at day " << met[k].timeDays << std::endl;
+    }
+    if (met.size() > MAX_ENCOUNTER_LINES) {
+      std::cout << "Close approach: " << met.size() - MAX_ENCOUNTER_LINES << " more" << std::endl;
+    }
+    ps.clearEncounters();
+
+    // camera matrixes: the view only rotates, the eye position stays in
+    // double and the planets are drawn relative to it
     glm::mat4 view(1);
     glm::mat4 projection(1);
-    view = glm::translate(view, glm::vec3(0.0f, 0.0f, -gTranslateZ));   
     view = glm::rotate(view, glm::radians(gPitch), glm::vec3(1.0f, 0.0f, 0.0f));
     view = glm::rotate(view, glm::radians(gYaw), glm::vec3(0.0f, 1.0f, 0.0f));
-    projection = glm::perspective(glm::radians(45.0f), (GLfloat)WIDTH / (GLfloat)HEIGHT, 0.1f, 100.0f);
-
-    
-    double deltaDays = deltaTime * 5;   // 1 sec = 5 days
-    ps.update(deltaDays);
+    projection = infiniteProjection(glm::radians(FOV_DEGREES), (GLfloat)WIDTH / (GLfloat)HEIGHT, NEAR_PLANE,
+                                    scene.reversedZ);
+    glm::dvec3 focus = gFocusBody < 0 ? glm::dvec3(0.0) : ps.positionGL(gFocusBody);
+    glm::vec4 eyeOffset = glm::transpose(view) * glm::vec4(0.0f, 0.0f, gTranslateZ, 0.0f);
+    glm::dvec3 eye = focus + glm::dvec3(eyeOffset.x, eyeOffset.y, eyeOffset.z);
+
+    if (currentTime - lastTitleTime >= TITLE_INTERVAL) {
+      lastTitleTime = currentTime;
+      char title[128];
+      std::snprintf(title, sizeof(title), "Planets - day %.2f, %g days/s%s%s%s", gClock.time(), gClock.warp(),
+                    gClock.warpLimited() ? " (limit)" : "", gClock.reversed() ? ", reversed" : "",
+                    gClock.isPaused() ? ", paused" : "");
+      glfwSetWindowTitle(window, title);
+    }
 
     // draw
-    ps.draw(view, projection, sphereVAO, sphereIndexCount, planetShader.Program); 
+    ps.draw(eye, view, projection);
+
+    if (scene.fbo) {
+      glBindFramebuffer(GL_READ_FRAMEBUFFER, scene.fbo);
+      glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+      glBlitFramebuffer(0, 0, scene.width, scene.height, 0, 0, scene.width, scene.height,
+                        GL_COLOR_BUFFER_BIT, GL_NEAREST);
+      glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    }
 
     // Swap the screen buffers
     glfwSwapBuffers(window);
   }
 
   // Properly de-allocate all resources once they've outlived their purpose
-  glDeleteVertexArrays(1, &sphereVAO);
-  glDeleteBuffers(1, &sphereVBO);
+  ps.destroy();
+  destroySceneTarget(scene);
 
   // Terminate GLFW, clearing any resources allocated by GLFW.
   glfwDestroyWindow(window);
@@ -258,10 +500,44 @@ void keyCallback(GLFWwindow* window, int key, int scancode, int action, int mode
   if (action == GLFW_PRESS || action == GLFW_REPEAT) {
       switch (key) {
       case GLFW_KEY_S:
-          gTranslateZ += 0.2f;  // zoom in
+          gTranslateZ *= ZOOM_FACTOR;  // zoom out
           break;
       case GLFW_KEY_W:
-          gTranslateZ -= 0.2f;  // zoom out
+          gTranslateZ = std::max(gTranslateZ / ZOOM_FACTOR, MIN_DISTANCE);  // zoom in
+          break;
+      case GLFW_KEY_LEFT_BRACKET:
+          if (action == GLFW_PRESS) gLodBiasChange--;  // coarser spheres
+          break;
+      case GLFW_KEY_RIGHT_BRACKET:
+          if (action == GLFW_PRESS) gLodBiasChange++;  // finer spheres
+          break;
+      case GLFW_KEY_O:
+          if (action == GLFW_PRESS) gToggleOrbits = true;
+          break;
+      case GLFW_KEY_T:
+          if (action == GLFW_PRESS) gToggleTrails = true;
+          break;
+      case GLFW_KEY_F:
+          if (action == GLFW_PRESS) gNextFocus = true;  // orbit the next body
+          break;
+      case GLFW_KEY_R:
+          if (action == GLFW_PRESS) gClock.setReversed(!gClock.reversed());  // reverse playback
+          break;
+      case GLFW_KEY_P:
+      case GLFW_KEY_SPACE:
+          if (action == GLFW_PRESS) gClock.setPaused(!gClock.isPaused());
+          break;
+      case GLFW_KEY_EQUAL:
+          gClock.setWarp(gClock.warp() * WARP_FACTOR);  // faster
+          break;
+      case GLFW_KEY_MINUS:
+          gClock.setWarp(gClock.warp() / WARP_FACTOR);  // slower
+          break;
+      case GLFW_KEY_C:
+          if (action == GLFW_PRESS) gToggleEphemeris = true;  // cache vs direct Kepler
+          break;
+      case GLFW_KEY_N:
+          if (action == GLFW_PRESS) gToggleNBody = true;  // gravity vs orbital elements
           break;
       default:
           break;
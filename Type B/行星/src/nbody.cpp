@@ -0,0 +1,336 @@
+#include "nbody.h"
+#include "parallel.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// Bits per axis of a Morton code; a cell at the last level is never split
+const int MORTON_BITS = 21;
+
+// Cells with this many bodies or fewer are summed body by body
+const uint32_t LEAF_SIZE = 8;
+
+// Level whose cells are built as separate subtrees, one task each (up to 64)
+const int PARALLEL_LEVEL = 2;
+
+// Tree walks are far dearer than the other per-body passes
+const size_t MIN_BODIES_PER_THREAD = 512;
+const size_t MIN_KEYS_PER_CHUNK = 16384;
+
+// Deep enough for MORTON_BITS levels with seven siblings waiting on each
+const int STACK_SIZE = 8 * (MORTON_BITS + 2);
+
+// Spread the low 21 bits of v so two zero bits follow each one
+inline uint64_t spreadBits(uint64_t v)
+{
+    v &= 0x1fffff;
+    v = (v | v << 32) & 0x1f00000000ffffULL;
+    v = (v | v << 16) & 0x1f0000ff0000ffULL;
+    v = (v | v << 8) & 0x100f00f00f00f00fULL;
+    v = (v | v << 4) & 0x10c30c30c30c30c3ULL;
+    v = (v | v << 2) & 0x1249249249249249ULL;
+    return v;
+}
+
+inline void addGravity(double dx, double dy, double dz, double m,
+                       double& ax, double& ay, double& az)
+{
+    double r2 = dx * dx + dy * dy + dz * dz + NBODY_SOFTENING_AU * NBODY_SOFTENING_AU;
+    double s = GRAVITY_AU_DAY * m / (r2 * std::sqrt(r2));
+    ax += dx * s;
+    ay += dy * s;
+    az += dz * s;
+}
+
+} // namespace
+
+void NBodySystem::init(const std::vector<glm::dvec3>& positions,
+                       const std::vector<glm::dvec3>& velocities,
+                       const std::vector<double>& masses)
+{
+    size_t n = positions.size();
+    for (auto* v : {&x, &y, &z, &vx, &vy, &vz}) v->resize(n);
+    for (auto* v : {&ax, &ay, &az}) v->assign(n, 0.0);
+    mass = masses;
+    massive.clear();
+    for (size_t i = 0; i < n; ++i) {
+        x[i] = positions[i].x;
+        y[i] = positions[i].y;
+        z[i] = positions[i].z;
+        vx[i] = velocities[i].x;
+        vy[i] = velocities[i].y;
+        vz[i] = velocities[i].z;
+        if (mass[i] > 0.0) massive.push_back(static_cast<uint32_t>(i));
+    }
+    buildTree();
+    computeAccelerations();
+}
+
+void NBodySystem::step(double dt)
+{
+    kick(0.5 * dt);
+    drift(dt);
+    buildTree();
+    computeAccelerations();
+    kick(0.5 * dt);
+}
+
+void NBodySystem::kick(double dt)
+{
+    parallelFor(size(), MIN_KEYS_PER_CHUNK, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            vx[i] += ax[i] * dt;
+            vy[i] += ay[i] * dt;
+            vz[i] += az[i] * dt;
+        }
+    });
+}
+
+void NBodySystem::drift(double dt)
+{
+    parallelFor(size(), MIN_KEYS_PER_CHUNK, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            x[i] += vx[i] * dt;
+            y[i] += vy[i] * dt;
+            z[i] += vz[i] * dt;
+        }
+    });
+}
+
+void NBodySystem::buildTree()
+{
+    nodes.clear();
+    size_t n = massive.size();
+    if (n == 0) return;
+
+    // bounding cube of the massive bodies
+    glm::dvec3 lo(x[massive[0]], y[massive[0]], z[massive[0]]), hi = lo;
+    for (uint32_t i : massive) {
+        glm::dvec3 p(x[i], y[i], z[i]);
+        lo = glm::min(lo, p);
+        hi = glm::max(hi, p);
+    }
+    double width = std::max(std::max(hi.x - lo.x, hi.y - lo.y), hi.z - lo.z);
+    width = width > 0.0 ? width * (1.0 + 1e-9) : 1.0;
+    double cells = static_cast<double>(1u << MORTON_BITS);
+    double scale = cells / width;
+
+    keys.resize(n);
+    parallelFor(n, MIN_KEYS_PER_CHUNK, [&](size_t begin, size_t end) {
+        for (size_t k = begin; k < end; ++k) {
+            uint32_t i = massive[k];
+            uint64_t qx = static_cast<uint64_t>(std::min((x[i] - lo.x) * scale, cells - 1.0));
+            uint64_t qy = static_cast<uint64_t>(std::min((y[i] - lo.y) * scale, cells - 1.0));
+            uint64_t qz = static_cast<uint64_t>(std::min((z[i] - lo.z) * scale, cells - 1.0));
+            keys[k] = {spreadBits(qx) << 2 | spreadBits(qy) << 1 | spreadBits(qz), i};
+        }
+    });
+
+    // sort chunks on their own threads, then merge pairs until one run is left
+    auto byCode = [](const Key& a, const Key& b) {
+        return a.code < b.code || (a.code == b.code && a.body < b.body);
+    };
+    size_t chunkCount = std::max<size_t>(1, std::min<size_t>(workerCount(), n / MIN_KEYS_PER_CHUNK));
+    size_t run = (n + chunkCount - 1) / chunkCount;
+    parallelChunks(n, chunkCount, [&](size_t, size_t begin, size_t end) {
+        std::sort(keys.begin() + begin, keys.begin() + end, byCode);
+    });
+    for (; run < n; run *= 2) {
+        keyScratch.resize(n);
+        size_t pairs = (n + 2 * run - 1) / (2 * run);
+        parallelFor(pairs, 1, [&](size_t begin, size_t end) {
+            for (size_t p = begin; p < end; ++p) {
+                size_t first = p * 2 * run;
+                size_t mid = std::min(n, first + run);
+                size_t last = std::min(n, first + 2 * run);
+                std::merge(keys.begin() + first, keys.begin() + mid, keys.begin() + mid,
+                           keys.begin() + last, keyScratch.begin() + first, byCode);
+            }
+        });
+        keys.swap(keyScratch);
+    }
+
+    for (auto* v : {&sx, &sy, &sz, &sm}) v->resize(n);
+    parallelFor(n, MIN_KEYS_PER_CHUNK, [&](size_t begin, size_t end) {
+        for (size_t k = begin; k < end; ++k) {
+            uint32_t i = keys[k].body;
+            sx[k] = x[i];
+            sy[k] = y[i];
+            sz[k] = z[i];
+            sm[k] = mass[i];
+        }
+    });
+
+    // top levels here, the subtrees below them on the worker threads
+    Node root = {};
+    root.cx = lo.x + 0.5 * width;
+    root.cy = lo.y + 0.5 * width;
+    root.cz = lo.z + 0.5 * width;
+    root.half = 0.5 * width;
+    nodes.push_back(root);
+    std::vector<uint32_t> pending;
+    buildNode(nodes, 0, 0, static_cast<uint32_t>(n), 0, PARALLEL_LEVEL, &pending);
+    size_t topCount = nodes.size();
+
+    std::vector<std::vector<Node>> subtrees(pending.size());
+    parallelFor(pending.size(), 1, [&](size_t begin, size_t end) {
+        for (size_t p = begin; p < end; ++p) {
+            const Node& top = nodes[pending[p]];
+            subtrees[p].assign(1, top);
+            buildNode(subtrees[p], 0, top.begin, top.end, PARALLEL_LEVEL, MORTON_BITS + 1, nullptr);
+        }
+    });
+
+    // append each subtree, moving its child indices past the nodes before it
+    for (size_t p = 0; p < pending.size(); ++p) {
+        uint32_t shift = static_cast<uint32_t>(nodes.size()) - 1;
+        const std::vector<Node>& sub = subtrees[p];
+        nodes[pending[p]] = sub[0];
+        nodes[pending[p]].firstChild += shift;
+        for (size_t k = 1; k < sub.size(); ++k) {
+            nodes.push_back(sub[k]);
+            if (sub[k].childCount) nodes.back().firstChild += shift;
+        }
+    }
+
+    // children always follow their parent, so a backwards pass finishes
+    // the top levels
+    for (size_t k = topCount; k-- > 0;) {
+        Node& node = nodes[k];
+        if (node.childCount == 0) continue;
+        node.comX = node.comY = node.comZ = node.mass = 0.0;
+        for (uint32_t c = node.firstChild; c < node.firstChild + node.childCount; ++c) {
+            const Node& child = nodes[c];
+            node.comX += child.comX * child.mass;
+            node.comY += child.comY * child.mass;
+            node.comZ += child.comZ * child.mass;
+            node.mass += child.mass;
+        }
+        node.comX /= node.mass;
+        node.comY /= node.mass;
+        node.comZ /= node.mass;
+    }
+}
+
+// Split the sorted bodies [begin, end) of out[node] by the next three
+// Morton bits. Cells reaching stopLevel are left for later in pending.
+void NBodySystem::buildNode(std::vector<Node>& out, uint32_t node, uint32_t begin, uint32_t end,
+                            int level, int stopLevel, std::vector<uint32_t>* pending) const
+{
+    out[node].begin = begin;
+    out[node].end = end;
+    out[node].firstChild = 0;
+    out[node].childCount = 0;
+
+    if (end - begin <= LEAF_SIZE || level == MORTON_BITS) {
+        double m = 0.0, mx = 0.0, my = 0.0, mz = 0.0;
+        for (uint32_t k = begin; k < end; ++k) {
+            m += sm[k];
+            mx += sx[k] * sm[k];
+            my += sy[k] * sm[k];
+            mz += sz[k] * sm[k];
+        }
+        Node& leaf = out[node];
+        leaf.mass = m;
+        leaf.comX = mx / m;
+        leaf.comY = my / m;
+        leaf.comZ = mz / m;
+        return;
+    }
+    if (level == stopLevel) {
+        pending->push_back(node);
+        return;
+    }
+
+    int shift = 3 * (MORTON_BITS - 1 - level);
+    uint32_t bounds[9];
+    bounds[0] = begin;
+    bounds[8] = end;
+    for (uint64_t octant = 1; octant < 8; ++octant) {
+        auto it = std::partition_point(keys.begin() + bounds[octant - 1], keys.begin() + end,
+                                       [&](const Key& k) { return (k.code >> shift & 7) < octant; });
+        bounds[octant] = static_cast<uint32_t>(it - keys.begin());
+    }
+
+    // out may grow below, so nothing holds a reference into it
+    double quarter = 0.5 * out[node].half;
+    double cx = out[node].cx, cy = out[node].cy, cz = out[node].cz;
+    uint32_t first = static_cast<uint32_t>(out.size());
+    uint32_t count = 0;
+    for (int octant = 0; octant < 8; ++octant) {
+        if (bounds[octant] == bounds[octant + 1]) continue;
+        Node child = {};
+        child.cx = cx + (octant & 4 ? quarter : -quarter);
+        child.cy = cy + (octant & 2 ? quarter : -quarter);
+        child.cz = cz + (octant & 1 ? quarter : -quarter);
+        child.half = quarter;
+        child.begin = bounds[octant];
+        child.end = bounds[octant + 1];
+        out.push_back(child);
+        ++count;
+    }
+    out[node].firstChild = first;
+    out[node].childCount = count;
+
+    double m = 0.0, mx = 0.0, my = 0.0, mz = 0.0;
+    for (uint32_t c = first; c < first + count; ++c) {
+        buildNode(out, c, out[c].begin, out[c].end, level + 1, stopLevel, pending);
+        m += out[c].mass;
+        mx += out[c].comX * out[c].mass;
+        my += out[c].comY * out[c].mass;
+        mz += out[c].comZ * out[c].mass;
+    }
+    // pending cells have no mass yet; buildTree() sums these nodes again
+    Node& self = out[node];
+    self.mass = m;
+    if (m > 0.0) {
+        self.comX = mx / m;
+        self.comY = my / m;
+        self.comZ = mz / m;
+    }
+}
+
+void NBodySystem::computeAccelerations()
+{
+    if (nodes.empty()) {
+        for (auto* v : {&ax, &ay, &az}) std::fill(v->begin(), v->end(), 0.0);
+        return;
+    }
+
+    double theta2 = theta * theta;
+    parallelFor(size(), MIN_BODIES_PER_THREAD, [&](size_t begin, size_t end) {
+        uint32_t stack[STACK_SIZE];
+        for (size_t i = begin; i < end; ++i) {
+            double px = x[i], py = y[i], pz = z[i];
+            double accX = 0.0, accY = 0.0, accZ = 0.0;
+            int top = 0;
+            stack[top++] = 0;
+            while (top > 0) {
+                const Node& node = nodes[stack[--top]];
+                if (node.childCount == 0) {
+                    for (uint32_t k = node.begin; k < node.end; ++k) {
+                        if (keys[k].body == i) continue;
+                        addGravity(sx[k] - px, sy[k] - py, sz[k] - pz, sm[k], accX, accY, accZ);
+                    }
+                    continue;
+                }
+
+                // far enough away, and not around the body itself: one mass
+                double dx = node.comX - px, dy = node.comY - py, dz = node.comZ - pz;
+                double d2 = dx * dx + dy * dy + dz * dz;
+                double size = 2.0 * node.half;
+                bool inside = std::abs(px - node.cx) <= node.half && std::abs(py - node.cy) <= node.half &&
+                              std::abs(pz - node.cz) <= node.half;
+                if (!inside && size * size < theta2 * d2) {
+                    addGravity(dx, dy, dz, node.mass, accX, accY, accZ);
+                    continue;
+                }
+                for (uint32_t c = 0; c < node.childCount; ++c) stack[top++] = node.firstChild + c;
+            }
+            ax[i] = accX;
+            ay[i] = accY;
+            az[i] = accZ;
+        }
+    });
+}
@@ -0,0 +1,77 @@
+#ifndef NBODY_H
+#define NBODY_H
+
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Gaussian gravitational constant squared: G in AU^3 / (solar mass day^2)
+const double GRAVITY_AU_DAY = 0.01720209895 * 0.01720209895;
+
+// A cell is treated as one mass when its width over the distance to its
+// center of mass is below this
+const double BARNES_HUT_THETA = 0.5;
+
+// Plummer softening, keeps close passes between massive bodies finite
+const double NBODY_SOFTENING_AU = 1e-6;
+
+// Bodies moved by gravity instead of by their orbital elements, in AU,
+// days and solar masses. Bodies with zero mass are test particles: they
+// feel the others but are left out of the tree, so a million of them cost
+// a million tree walks and nothing more.
+//
+// Each step is a kick-drift-kick leapfrog, which is symplectic and time
+// reversible, so energy errors stay bounded over long runs and a negative
+// step retraces the path. Forces come from a Barnes-Hut octree over the
+// massive bodies, rebuilt every step: Morton codes and the sort run on all
+// threads, the top two levels are split on the calling thread and the
+// subtrees under them are built in parallel.
+class NBodySystem
+{
+public:
+    void init(const std::vector<glm::dvec3>& positions,
+              const std::vector<glm::dvec3>& velocities,
+              const std::vector<double>& masses);
+
+    // Advance by dt days (negative runs backwards)
+    void step(double dt);
+
+    void setTheta(double value) { theta = value; }
+
+    size_t size() const { return mass.size(); }
+    size_t massiveCount() const { return massive.size(); }
+    glm::dvec3 position(size_t i) const { return glm::dvec3(x[i], y[i], z[i]); }
+    glm::dvec3 velocity(size_t i) const { return glm::dvec3(vx[i], vy[i], vz[i]); }
+
+private:
+    struct Node {
+        double comX, comY, comZ, mass;   // center of mass, total mass
+        double cx, cy, cz, half;         // cell center and half width
+        uint32_t firstChild;             // children are stored together
+        uint32_t childCount;             // 0 for a leaf
+        uint32_t begin, end;             // range of sorted bodies
+    };
+    struct Key {
+        uint64_t code;
+        uint32_t body;
+    };
+
+    void kick(double dt);
+    void drift(double dt);
+    void buildTree();
+    void buildNode(std::vector<Node>& out, uint32_t node, uint32_t begin, uint32_t end,
+                   int level, int stopLevel, std::vector<uint32_t>* pending) const;
+    void computeAccelerations();
+
+    std::vector<double> x, y, z, vx, vy, vz, ax, ay, az, mass;
+    std::vector<uint32_t> massive;   // bodies with mass > 0
+
+    // Tree over the massive bodies, positions copied in Morton order
+    std::vector<Key> keys, keyScratch;
+    std::vector<double> sx, sy, sz, sm;
+    std::vector<Node> nodes;
+    double theta = BARNES_HUT_THETA;
+};
+
+#endif
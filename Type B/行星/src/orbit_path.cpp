@@ -0,0 +1,245 @@
+#include "orbit_path.h"
+#include "parallel.h"
+#include "shader.h"
+#include <glm/gtc/type_ptr.hpp>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+
+const double PI = 3.14159265358979323846;
+const double DEG2RAD = PI / 180.0;
+
+// Fewer expired paths than this are patched one by one, more rebuild all
+const size_t MAX_PATCHED_PATHS = 256;
+
+// Origin slot of orbits around the coordinate origin rather than a body
+const uint32_t NO_PARENT = 0xFFFFFFFFu;
+
+// Smallest share of expired paths worth a thread
+const size_t MIN_PATHS_PER_THREAD = 16;
+
+// Spare room per path, as a fraction of its vertices, so a rebuilt path
+// that gained a few vertices still fits where it was
+const GLsizei CAPACITY_SLACK_DIVISOR = 4;
+
+// Split [E0, E1] until the chord sits within PATH_SAGITTA of the ellipse;
+// emits the start of each final segment, the loop closes itself
+void subdivide(const OrbitShape& shape, double E0, const glm::dvec3& p0, double E1, const glm::dvec3& p1,
+               int depth, double scale, float slot, std::vector<glm::vec4>& out)
+{
+    double Em = 0.5 * (E0 + E1);
+    glm::dvec3 pm = shape.point(Em);
+    if (depth < PATH_MAX_DEPTH && glm::length(pm - 0.5 * (p0 + p1)) > PATH_SAGITTA * glm::length(pm)) {
+        subdivide(shape, E0, p0, Em, pm, depth + 1, scale, slot, out);
+        subdivide(shape, Em, pm, E1, p1, depth + 1, scale, slot, out);
+        return;
+    }
+    out.push_back(glm::vec4(glm::vec3(p0 * scale), slot));
+}
+
+} // namespace
+
+OrbitPaths::~OrbitPaths() {}
+
+bool OrbitPaths::init(const std::vector<OrbitalElements>& orbitElements, const std::vector<double>& orbitScaleGL, double t)
+{
+    elements = orbitElements;
+    scaleGL = orbitScaleGL;
+
+    bodies.clear();
+    originSlot.clear();
+    originBodies.clear();
+    std::vector<int> slotOf(elements.size() + 1, -1);   // last entry: the origin
+    for (size_t i = 0; i < elements.size(); ++i) {
+        int parent = elements[i].centerOfOrbit;
+        if (elements[i].a1 + elements[i].a2 * t <= 0.0) continue;
+        size_t key = parent < 0 ? elements.size() : static_cast<size_t>(parent);
+        if (slotOf[key] < 0) {
+            slotOf[key] = static_cast<int>(originBodies.size());
+            originBodies.push_back(parent < 0 ? NO_PARENT : static_cast<uint32_t>(parent));
+        }
+        bodies.push_back(static_cast<uint32_t>(i));
+        originSlot.push_back(static_cast<uint32_t>(slotOf[key]));
+    }
+    origins.assign(originBodies.size(), glm::vec4(0.0f));
+    if (bodies.empty()) return false;
+
+    shader.reset(new Shader("resources/shaders/orbit.vert", "resources/shaders/orbit.frag"));
+    shader->Use();
+    glUniform1i(glGetUniformLocation(shader->Program, "uOrigins"), 0);
+
+    glGenVertexArrays(1, &VAO);
+    glGenBuffers(1, &VBO);
+    glBindVertexArray(VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    // layout (location = 0): vec4 position relative to the parent, origin slot
+    glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, sizeof(glm::vec4), (void*)0);
+    glEnableVertexAttribArray(0);
+    glBindVertexArray(0);
+
+    glGenBuffers(1, &originVBO);
+    glBindBuffer(GL_TEXTURE_BUFFER, originVBO);
+    glBufferData(GL_TEXTURE_BUFFER, origins.size() * sizeof(glm::vec4), nullptr, GL_STREAM_DRAW);
+    glGenTextures(1, &originTexture);
+    glBindTexture(GL_TEXTURE_BUFFER, originTexture);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, originVBO);
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+    build(t);
+    return true;
+}
+
+void OrbitPaths::destroy()
+{
+    if (VAO) glDeleteVertexArrays(1, &VAO);
+    GLuint buffers[] = {VBO, originVBO};
+    glDeleteBuffers(2, buffers);
+    if (originTexture) glDeleteTextures(1, &originTexture);
+    VAO = VBO = originVBO = originTexture = 0;
+    shader.reset();
+    bodies.clear();
+    vertexCount = 0;
+}
+
+// Vertices of one path at day t, and how long they stay good
+void OrbitPaths::sample(size_t path, double t, std::vector<glm::vec4>& out)
+{
+    const OrbitalElements& elem = elements[bodies[path]];
+    OrbitShape shape = orbitShape(elem, t);
+    double scale = scaleGL[bodies[path]];
+    float slot = static_cast<float>(originSlot[path]);
+
+    double step = 2.0 * PI / PATH_MIN_SEGMENTS;
+    glm::dvec3 p0 = shape.point(0.0);
+    for (int s = 0; s < PATH_MIN_SEGMENTS; ++s) {
+        double E1 = (s + 1) * step;
+        glm::dvec3 p1 = shape.point(E1);
+        subdivide(shape, s * step, p0, E1, p1, 0, scale, slot, out);
+        p0 = p1;
+    }
+
+    // fastest any point can move: turning the plane, stretching, flattening
+    double a = shape.a, e = shape.e;
+    double turnRate = (std::abs(elem.N2) + std::abs(elem.i2) + std::abs(elem.w2)) * DEG2RAD;
+    double rate = a * (1.0 + e) * turnRate + std::abs(elem.a2) * (1.0 + e)
+                + a * std::abs(elem.e2) * (1.0 + e / std::sqrt(1.0 - e * e));
+    builtAt[path] = t;
+    validDays[path] = rate > 0.0 ? PATH_DRIFT * a * (1.0 - e) / rate : std::numeric_limits<double>::infinity();
+}
+
+void OrbitPaths::build(double t)
+{
+    size_t n = bodies.size();
+    firsts.resize(n);
+    counts.resize(n);
+    capacity.resize(n);
+    builtAt.resize(n);
+    validDays.resize(n);
+
+    // each chunk samples its paths into its own list
+    size_t chunkCount = std::min<size_t>(workerCount(), n);
+    std::vector<std::vector<glm::vec4>> chunkVertices(chunkCount);
+    std::vector<size_t> chunkBegin(chunkCount, 0), chunkEnd(chunkCount, 0);
+    parallelChunks(n, chunkCount, [&](size_t c, size_t begin, size_t end) {
+        chunkBegin[c] = begin;
+        chunkEnd[c] = end;
+        for (size_t k = begin; k < end; ++k) {
+            size_t before = chunkVertices[c].size();
+            sample(k, t, chunkVertices[c]);
+            counts[k] = static_cast<GLsizei>(chunkVertices[c].size() - before);
+        }
+    });
+
+    GLint next = 0;
+    for (size_t k = 0; k < n; ++k) {
+        capacity[k] = counts[k] + counts[k] / CAPACITY_SLACK_DIVISOR;
+        firsts[k] = next;
+        next += capacity[k];
+    }
+    vertexCount = static_cast<size_t>(next);
+
+    // then into place, gaps left for growth
+    std::vector<glm::vec4> all(vertexCount, glm::vec4(0.0f));
+    parallelFor(chunkCount, 1, [&](size_t cBegin, size_t cEnd) {
+        for (size_t c = cBegin; c < cEnd; ++c) {
+            const glm::vec4* src = chunkVertices[c].data();
+            for (size_t k = chunkBegin[c]; k < chunkEnd[c]; ++k) {
+                std::copy(src, src + counts[k], all.begin() + firsts[k]);
+                src += counts[k];
+            }
+        }
+    });
+
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    glBufferData(GL_ARRAY_BUFFER, all.size() * sizeof(glm::vec4), all.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void OrbitPaths::refresh(double t)
+{
+    std::vector<size_t> expired;
+    for (size_t k = 0; k < bodies.size(); ++k) {
+        if (std::abs(t - builtAt[k]) > validDays[k]) expired.push_back(k);
+    }
+    if (expired.empty()) return;
+    if (expired.size() > MAX_PATCHED_PATHS) {
+        build(t);
+        return;
+    }
+
+    std::vector<std::vector<glm::vec4>> fresh(expired.size());
+    parallelFor(expired.size(), MIN_PATHS_PER_THREAD, [&](size_t begin, size_t end) {
+        for (size_t j = begin; j < end; ++j) sample(expired[j], t, fresh[j]);
+    });
+    for (size_t j = 0; j < expired.size(); ++j) {
+        if (static_cast<GLsizei>(fresh[j].size()) > capacity[expired[j]]) {
+            build(t);   // outgrew its room, lay everything out again
+            return;
+        }
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    for (size_t j = 0; j < expired.size(); ++j) {
+        size_t k = expired[j];
+        counts[k] = static_cast<GLsizei>(fresh[j].size());
+        glBufferSubData(GL_ARRAY_BUFFER, firsts[k] * sizeof(glm::vec4), fresh[j].size() * sizeof(glm::vec4), fresh[j].data());
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void OrbitPaths::draw(const glm::dvec3& eyeGL, const glm::mat4& view, const glm::mat4& proj,
+                      const glm::vec4& color, const std::function<glm::dvec3(size_t)>& bodyGL)
+{
+    if (bodies.empty()) return;
+
+    // the parents relative to the eye, in double before the float copy
+    for (size_t s = 0; s < originBodies.size(); ++s) {
+        glm::dvec3 origin = originBodies[s] == NO_PARENT ? glm::dvec3(0.0) : bodyGL(originBodies[s]);
+        origins[s] = glm::vec4(glm::vec3(origin - eyeGL), 0.0f);
+    }
+    size_t bytes = origins.size() * sizeof(glm::vec4);
+    glBindBuffer(GL_TEXTURE_BUFFER, originVBO);
+    glBufferData(GL_TEXTURE_BUFFER, bytes, nullptr, GL_STREAM_DRAW);
+    glBufferSubData(GL_TEXTURE_BUFFER, 0, bytes, origins.data());
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+    shader->Use();
+    GLuint program = shader->Program;
+    glUniformMatrix4fv(glGetUniformLocation(program, "view"), 1, GL_FALSE, glm::value_ptr(view));
+    glUniformMatrix4fv(glGetUniformLocation(program, "projection"), 1, GL_FALSE, glm::value_ptr(proj));
+    glUniform4fv(glGetUniformLocation(program, "uColor"), 1, glm::value_ptr(color));
+
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_BUFFER, originTexture);
+
+    // blended over the scene, without hiding what is drawn after
+    glDepthMask(GL_FALSE);
+    glBindVertexArray(VAO);
+    glMultiDrawArrays(GL_LINE_LOOP, firsts.data(), counts.data(), static_cast<GLsizei>(bodies.size()));
+    glBindVertexArray(0);
+    glDepthMask(GL_TRUE);
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+}
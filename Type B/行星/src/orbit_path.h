@@ -0,0 +1,86 @@
+#ifndef ORBIT_PATH_H
+#define ORBIT_PATH_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <functional>
+#include <memory>
+#include <vector>
+#include "kepler.h"
+
+class Shader;
+
+// A chord may bow this far from the ellipse, as a fraction of the distance
+// to the center of the orbit: circles get 64 segments
+const double PATH_SAGITTA = 2e-3;
+
+// A path is rebuilt once drifting elements could have moved it this far,
+// as a fraction of the perihelion distance
+const double PATH_DRIFT = 2e-3;
+
+// Segments per orbit before refinement, and halvings allowed after
+const int PATH_MIN_SEGMENTS = 16;
+const int PATH_MAX_DEPTH = 6;
+
+// Full orbit ellipses of every body, drawn as line loops.
+//
+// Each ellipse is sampled in eccentric anomaly and a segment is split
+// while its midpoint lies more than PATH_SAGITTA of its distance from the
+// chord, so eccentric orbits get more vertices round perihelion and
+// fewer out at aphelion. Paths are generated in parallel into one static
+// vertex buffer and all of them are one glMultiDrawArrays.
+//
+// Vertices are relative to the parent, in GL units, with the index of the
+// parent in a small buffer texture of eye-relative origins in w; only those
+// origins are uploaded each frame. A path built at day t0 stays valid while
+// the element rates cannot have moved it PATH_DRIFT of its perihelion
+// distance; refresh() rebuilds the expired ones in place.
+class OrbitPaths
+{
+public:
+    OrbitPaths() = default;
+    ~OrbitPaths();
+
+    OrbitPaths(const OrbitPaths&) = delete;
+    OrbitPaths& operator=(const OrbitPaths&) = delete;
+
+    // elements[i].centerOfOrbit indexes the same list, -1 for orbits about
+    // the coordinate origin; bodies without a semi-major axis get no path.
+    // scaleGL[i] takes body i's orbit from AU to GL units. Call with a
+    // current context.
+    bool init(const std::vector<OrbitalElements>& elements, const std::vector<double>& scaleGL, double t);
+    void destroy();
+
+    // Rebuild paths that no longer match the elements at day t
+    void refresh(double t);
+
+    // bodyGL(b) gives the drawn position of body b in GL units
+    void draw(const glm::dvec3& eyeGL, const glm::mat4& view, const glm::mat4& proj,
+              const glm::vec4& color, const std::function<glm::dvec3(size_t)>& bodyGL);
+
+    size_t paths() const { return bodies.size(); }
+    size_t vertices() const { return vertexCount; }
+
+private:
+    void build(double t);
+    void sample(size_t path, double t, std::vector<glm::vec4>& out);
+
+    std::vector<OrbitalElements> elements;
+    std::vector<double> scaleGL;
+
+    // One entry per path
+    std::vector<uint32_t> bodies;
+    std::vector<uint32_t> originSlot;       // parent's texel in the origin buffer
+    std::vector<GLint> firsts;
+    std::vector<GLsizei> counts, capacity;
+    std::vector<double> builtAt, validDays;
+
+    std::vector<uint32_t> originBodies;     // parents, one texel each
+    std::vector<glm::vec4> origins;
+    size_t vertexCount = 0;
+
+    GLuint VAO = 0, VBO = 0, originVBO = 0, originTexture = 0;
+    std::unique_ptr<Shader> shader;
+};
+
+#endif
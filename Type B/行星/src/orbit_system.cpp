@@ -0,0 +1,210 @@
+#include "orbit_system.h"
+#include "parallel.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+namespace {
+
+// Smallest share of bodies worth a thread in update()
+const size_t MIN_BODIES_PER_THREAD = 4096;
+
+// The step is held to this fraction of the shortest orbital period
+const double STEPS_PER_ORBIT = 64.0;
+
+// Time step of the central difference giving the starting N-body velocities
+const double VELOCITY_STEP_DAYS = 1e-3;
+
+} // namespace
+
+bool OrbitSystem::init(const std::vector<BodyRecord>& bodies, double startDays)
+{
+    size_t n = bodies.size();
+    names.resize(n);
+    elems.resize(n);
+    masses.resize(n);
+    orbits.clear();
+    for (size_t i = 0; i < n; ++i) {
+        names[i] = bodies[i].name;
+        elems[i] = bodies[i].elem;
+        masses[i] = bodies[i].mass;
+        orbits.add(bodies[i].elem);
+    }
+    if (!buildHierarchy()) return false;
+    maxStep = fastestOrbitStep();
+
+    displayScale.assign(n, 1.0);
+    relativeAU.assign(n, glm::dvec3(0.0));
+    posAU.assign(n, glm::dvec3(0.0));
+    displayAU.assign(n, glm::dvec3(0.0));
+    ephemerisReady = useEphemeris = useNBody = false;
+    currTimeDays = startDays;
+    update(startDays);
+    return true;
+}
+
+// Breadth-first order over the centerOfOrbit tree
+bool OrbitSystem::buildHierarchy()
+{
+    size_t n = elems.size();
+    std::vector<uint32_t> childStart(n + 1, 0), children(n);
+    levelOrder.clear();
+    for (size_t i = 0; i < n; ++i) {
+        int parent = elems[i].centerOfOrbit;
+        if (parent < 0) levelOrder.push_back(static_cast<uint32_t>(i));
+        else childStart[parent + 1]++;
+    }
+    for (size_t i = 0; i < n; ++i) childStart[i + 1] += childStart[i];
+    {
+        std::vector<uint32_t> next(childStart.begin(), childStart.end() - 1);
+        for (size_t i = 0; i < n; ++i) {
+            int parent = elems[i].centerOfOrbit;
+            if (parent >= 0) children[next[parent]++] = static_cast<uint32_t>(i);
+        }
+    }
+
+    levelStart.assign(1, 0);
+    while (levelStart.back() < levelOrder.size()) {
+        size_t begin = levelStart.back(), end = levelOrder.size();
+        for (size_t k = begin; k < end; ++k) {
+            uint32_t body = levelOrder[k];
+            levelOrder.insert(levelOrder.end(), children.begin() + childStart[body],
+                              children.begin() + childStart[body + 1]);
+        }
+        levelStart.push_back(end);
+    }
+    if (levelOrder.size() != n) {
+        std::cout << "Catalogue: orbits form a cycle, " << n - levelOrder.size()
+                  << " bodies never reach a root" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void OrbitSystem::setDisplayScale(const std::vector<double>& scale)
+{
+    displayScale = scale;
+    displayScale.resize(elems.size(), 1.0);
+}
+
+double OrbitSystem::fastestOrbitStep() const
+{
+    // M2 is the mean motion in degrees per day, whatever the parent
+    double fastest = 0.0;
+    for (const auto& elem : elems) fastest = std::max(fastest, std::abs(elem.M2));
+    if (fastest <= 0.0) return 1.0;
+    return 360.0 / fastest / STEPS_PER_ORBIT;
+}
+
+void OrbitSystem::setUseEphemeris(bool enable)
+{
+    if (enable && !ephemerisReady) {
+        ephemeris.init(elems);
+        ephemerisReady = true;
+    }
+    useEphemeris = enable;
+}
+
+void OrbitSystem::prebuildEphemeris(double t0, double t1)
+{
+    if (!ephemerisReady) {
+        ephemeris.init(elems);
+        ephemerisReady = true;
+    }
+    ephemeris.build(t0, t1);
+}
+
+// True positions from the elements alone, parents included
+void OrbitSystem::keplerPositions(double timeDays, std::vector<glm::dvec3>& out)
+{
+    posX.resize(elems.size());
+    posY.resize(elems.size());
+    posZ.resize(elems.size());
+    orbits.evaluateAll(timeDays, posX.data(), posY.data(), posZ.data());
+    out.resize(elems.size());
+    for (uint32_t i : levelOrder) {
+        int parent = elems[i].centerOfOrbit;
+        out[i] = glm::dvec3(posX[i], posY[i], posZ[i]);
+        if (parent >= 0) out[i] += out[parent];
+    }
+}
+
+bool OrbitSystem::setUseNBody(bool enable)
+{
+    if (!enable || useNBody) {
+        useNBody = enable;
+        return true;
+    }
+
+    double total = 0.0;
+    for (double m : masses) total += m;
+    if (total <= 0.0) {
+        std::cout << "N-body mode needs body masses in the catalogue" << std::endl;
+        return false;
+    }
+
+    // start from the orbits as they are now, velocities by central difference
+    std::vector<glm::dvec3> positions, before, after, velocities(elems.size());
+    keplerPositions(currTimeDays, positions);
+    keplerPositions(currTimeDays - VELOCITY_STEP_DAYS, before);
+    keplerPositions(currTimeDays + VELOCITY_STEP_DAYS, after);
+    glm::dvec3 momentum(0.0);
+    for (size_t i = 0; i < elems.size(); ++i) {
+        velocities[i] = (after[i] - before[i]) / (2.0 * VELOCITY_STEP_DAYS);
+        momentum += masses[i] * velocities[i];
+    }
+    // the elements put the Sun at rest; let the whole system drift nowhere
+    for (auto& v : velocities) v -= momentum / total;
+
+    nbody.init(positions, velocities, masses);
+    useNBody = true;
+    return true;
+}
+
+void OrbitSystem::update(double timeDays)
+{
+    double dt = timeDays - currTimeDays;
+    currTimeDays = timeDays;
+    size_t n = elems.size();
+
+    // every orbit relative to its parent, all bodies at once
+    if (useNBody) {
+        if (dt != 0.0) nbody.step(dt);
+        parallelFor(n, MIN_BODIES_PER_THREAD, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) {
+                int parent = elems[i].centerOfOrbit;
+                relativeAU[i] = nbody.position(i) - (parent >= 0 ? nbody.position(parent) : glm::dvec3(0.0));
+            }
+        });
+    } else if (useEphemeris) {
+        parallelFor(n, MIN_BODIES_PER_THREAD, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) relativeAU[i] = ephemeris.position(i, currTimeDays);
+        });
+    } else {
+        posX.resize(n);
+        posY.resize(n);
+        posZ.resize(n);
+        orbits.evaluateAll(currTimeDays, posX.data(), posY.data(), posZ.data());
+        for (size_t i = 0; i < n; ++i) {
+            relativeAU[i] = glm::dvec3(posX[i], posY[i], posZ[i]);
+        }
+    }
+
+    // then add the parents, one level of the tree at a time
+    for (size_t d = 0; d + 1 < levelStart.size(); ++d) {
+        size_t first = levelStart[d];
+        parallelFor(levelStart[d + 1] - first, MIN_BODIES_PER_THREAD, [&](size_t begin, size_t end) {
+            for (size_t k = first + begin; k < first + end; ++k) {
+                uint32_t i = levelOrder[k];
+                int parent = elems[i].centerOfOrbit;
+                if (parent < 0) {
+                    posAU[i] = relativeAU[i];
+                    displayAU[i] = relativeAU[i];
+                } else {
+                    posAU[i] = posAU[parent] + relativeAU[i];
+                    displayAU[i] = displayAU[parent] + relativeAU[i] * displayScale[i];
+                }
+            }
+        });
+    }
+}
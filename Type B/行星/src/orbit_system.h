@@ -0,0 +1,89 @@
+#ifndef ORBIT_SYSTEM_H
+#define ORBIT_SYSTEM_H
+
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "catalogue.h"
+#include "ephemeris.h"
+#include "kepler.h"
+#include "nbody.h"
+
+// Positions of every body of a catalogue over time, with no window or GL
+// context: the viewer draws them and ephem_tool writes them out.
+//
+// Each update() finds every orbit relative to its parent, all bodies at
+// once (from the elements, the Chebyshev cache or the N-body state), then
+// adds the parents one level of the orbit tree at a time. Besides the true
+// position each body has a display position, where its orbit around the
+// parent may be widened by setDisplayScale().
+class OrbitSystem
+{
+public:
+    // Bodies with their parents resolved, as loadCatalogue() gives them;
+    // positions start at day startDays, from the elements
+    bool init(const std::vector<BodyRecord>& bodies, double startDays);
+
+    // Positions at day timeDays; in N-body mode, integrated from the
+    // current time
+    void update(double timeDays);
+    double time() const { return currTimeDays; }
+
+    size_t size() const { return names.size(); }
+    const std::string& name(size_t body) const { return names[body]; }
+    const OrbitalElements& elements(size_t body) const { return elems[body]; }
+    double mass(size_t body) const { return masses[body]; }
+    const std::vector<OrbitalElements>& allElements() const { return elems; }
+
+    const glm::dvec3& position(size_t body) const { return posAU[body]; }          // AU, parents included
+    const glm::dvec3& displayPosition(size_t body) const { return displayAU[body]; }
+
+    // Factor each body's orbit around its parent is drawn at (1 by default)
+    void setDisplayScale(const std::vector<double>& scale);
+
+    // A step short enough for the fastest orbit
+    double maxStepDays() const { return maxStep; }
+
+    // Orbits from the Chebyshev cache instead of straight from the
+    // elements; the cache is set up on first use
+    void setUseEphemeris(bool enable);
+    bool usingEphemeris() const { return useEphemeris; }
+    void prebuildEphemeris(double t0, double t1);
+    const EphemerisCache& ephemerisCache() const { return ephemeris; }
+
+    // Positions integrated under gravity from the current state instead of
+    // taken from the elements; needs at least one body with a mass
+    bool setUseNBody(bool enable);
+    bool usingNBody() const { return useNBody; }
+    size_t massiveCount() const { return nbody.massiveCount(); }
+
+private:
+    bool buildHierarchy();
+    double fastestOrbitStep() const;
+    void keplerPositions(double timeDays, std::vector<glm::dvec3>& out);
+
+    std::vector<std::string> names;
+    std::vector<OrbitalElements> elems;
+    std::vector<double> masses;
+
+    // Bodies sorted by depth in the orbit tree, roots first. Every body at
+    // depth d is in levelOrder[levelStart[d] .. levelStart[d + 1]), so a
+    // level only reads positions finished by the level above.
+    std::vector<uint32_t> levelOrder;
+    std::vector<size_t> levelStart;
+    std::vector<glm::dvec3> relativeAU;         // position relative to the parent
+    std::vector<glm::dvec3> posAU, displayAU;
+    std::vector<double> displayScale;           // widening of the orbit around the parent
+    OrbitBatch orbits;                          // elements of all bodies, same order
+    std::vector<double> posX, posY, posZ;       // scratch for OrbitBatch::evaluateAll
+    EphemerisCache ephemeris;
+    bool ephemerisReady = false;
+    bool useEphemeris = false;
+    NBodySystem nbody;
+    bool useNBody = false;
+    double currTimeDays = 0.0;
+    double maxStep = 1.0;
+};
+
+#endif
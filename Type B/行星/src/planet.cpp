@@ -1,125 +1,258 @@
 #include "planet.h"
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
+#include <algorithm>
+#include <chrono>
 #include <cmath>
+#include <cstddef>
+#include <iostream>
+#include <iterator>
+#include <unordered_map>
+#include "parallel.h"
+#include "shader.h"
+#include "sphere.h"
 
-extern GLuint loadTexture(const char* path);
+extern GLuint loadTextureArray(const std::vector<std::string>& paths, int maxWidth, int maxHeight);
 
 #define DEG2RAD 0.017453292519943295
 static const double AU_TO_GL = 5.0;     // 1 AU = 5 OpenGL units
 const double PI = 3.14159265358979323846;
-GLuint nameVBO, nameVAO, nameEBO;
+
+// Layer sizes of the texture arrays; larger images are scaled down
+static const int SURFACE_MAX_WIDTH = 2048, SURFACE_MAX_HEIGHT = 1024;
+static const int TAG_MAX_WIDTH = 512, TAG_MAX_HEIGHT = 256;
+
+// Ephemeris segments fitted up front, each side of the start time
+static const double EPHEMERIS_PREBUILD_DAYS = 366.0;
+
+// Smallest share of bodies worth a thread in interpolate() and draw()
+static const size_t MIN_BODIES_PER_THREAD = 4096;
+
+// Wall-clock time a frame may spend on clock steps, as measured by
+// advance(), and the time per body assumed before the first measurement
+static const double STEP_SECONDS_PER_FRAME = 0.008;
+static const double INITIAL_SECONDS_PER_BODY_STEP = 1e-6;
+// Slower steps are believed at once, faster ones by this fraction a frame
+static const double STEP_TIME_SMOOTHING = 0.2;
+// Substep limit reported for closed-form orbits, which jump instead
+static const int UNLIMITED_SUBSTEPS = 1 << 30;
+
+// Bodies closer than this are reported, about 300 000 km
+static const double ENCOUNTER_DISTANCE_AU = 0.002;
+
+// Moon orbits are drawn at least this many parent radii out, since at
+// true scale they would sit inside the inflated planet spheres
+static const double MOON_CLEARANCE = 2.0;
+
+// Sphere levels of detail, in stacks (with twice as many sectors), finest
+// first. A body gets the coarsest level whose equator edges stay under
+// LOD_EDGE_PIXELS on screen.
+static const int SPHERE_LOD_STACKS[] = {64, 32, 16, 8, 4};
+static const double LOD_EDGE_PIXELS = 8.0;
+static const int MAX_LOD_BIAS = 3;
+static_assert(sizeof(SPHERE_LOD_STACKS) / sizeof(int) <= 8, "PlanetSystem::MAX_SPHERE_LODS");
+
+// Spheres under this radius in pixels are ray cast on a quad instead,
+// as are all small bodies, which are never drawn under IMPOSTOR_MIN_PIXELS
+static const double IMPOSTOR_PIXELS = 3.0;
+static const float IMPOSTOR_MIN_PIXELS = 1.0f;
+static const glm::vec4 SMALL_BODY_COLOR(0.75f, 0.7f, 0.6f, 0.8f);
+
+// Orbit paths and trails
+static const glm::vec4 ORBIT_COLOR(0.4f, 0.45f, 0.55f, 0.35f);
+static const size_t MAX_TRAIL_BODIES = 4096;
+static const glm::vec4 TRAIL_COLOR(0.55f, 0.7f, 1.0f, 0.6f);
 
 PlanetSystem::PlanetSystem() {
     currTimeDays = 0.0;
+    prevTimeDays = 0.0;
 }
 
-void PlanetSystem::init() {
-    loadOrbitalElements();
+PlanetSystem::~PlanetSystem() {}
+
+bool PlanetSystem::init(const std::string& cataloguePath) {
+    if (!loadOrbitalElements(cataloguePath)) return false;
+
+    orbit.setUseEphemeris(true);
+    orbit.prebuildEphemeris(currTimeDays - EPHEMERIS_PREBUILD_DAYS, currTimeDays + EPHEMERIS_PREBUILD_DAYS);
+    const EphemerisCache& ephemeris = orbit.ephemerisCache();
+
+    double worst = 0.0;
+    for (size_t i = 0; i < ephemeris.size(); ++i) worst = std::max(worst, ephemeris.errorBound(i));
+    std::cout << "Ephemeris: " << ephemeris.segmentCount() << " segments, max error "
+              << worst << " AU" << std::endl;
+
     loadTextures();
     createName(nameVAO, nameVBO, nameEBO);
+    createInstancing();
+    createImpostors();
+
+    trailBodies = sphereBodies;
+    trailBodies.insert(trailBodies.end(), smallBodies.begin(), smallBodies.end());
+    trailBodies.resize(std::min(trailBodies.size(), MAX_TRAIL_BODIES));
+    trails.init(trailBodies.size());
+
+    std::vector<double> orbitScaleGL(planets.size());
+    for (size_t i = 0; i < planets.size(); ++i) orbitScaleGL[i] = displayScale[i] * AU_TO_GL;
+    orbitPaths.init(orbit.allElements(), orbitScaleGL, currTimeDays);
+    std::cout << "Orbit paths: " << orbitPaths.paths() << " paths, "
+              << orbitPaths.vertices() << " vertices" << std::endl;
+
+    std::vector<int> parents(planets.size());
+    for (size_t i = 0; i < planets.size(); ++i) parents[i] = orbit.elements(i).centerOfOrbit;
+    encounters.init(parents, ENCOUNTER_DISTANCE_AU);
+
+    // both steps at the start time until the clock runs
+    step(currTimeDays);
+    interpolate(1.0);
+    return true;
 }
 
-void PlanetSystem::loadOrbitalElements() {
-    planets.resize(6);  // Sun + 5 planets
-
-    // -------- SUN --------
-    planets[0].elem = {0,0,0,0,0,0,0,0,0,0,0,0,25.05,0};
-    planets[0].radiusGL = 1.2f;
-
-    // -------- MERCURY --------
-    planets[1].elem = {48.3313,0.0000324587, 7.0047,0.0000000500,
-                       29.1241,0.0000101444, 0.387098,0,
-                       0.205635,0.000000000559,
-                       168.6562,4.0923344368, 58.646, 0};
-    planets[1].radiusGL = 0.3f;
-
-    // -------- VENUS --------
-    planets[2].elem = {76.6799,0.0000246590, 3.3946,0.0000000275,
-                       54.8910,0.0000138374, 0.723330,0,
-                       0.006773,-0.000000001302,
-                       48.0052,1.6021302244, 243.0185, 0};
-    planets[2].radiusGL = 0.4f;
-
-    // -------- EARTH --------
-    planets[3].elem = {174.873,0, 0.00005,0,
-                       102.94719,0, 1.0,0,
-                       0.01671022,0,
-                       357.529,0.985608, 0.997, 0};
-    planets[3].radiusGL = 0.45f;
-
-    // -------- MARS --------
-    planets[4].elem = {49.5574,0.0000211081, 1.8497,-0.0000000178,
-                       286.5016,0.0000292961, 1.523688,0,
-                       0.093405,0.000000002516,
-                       18.6021,0.5240207766, 1.025957, 0};
-    planets[4].radiusGL = 0.35f;
-
-    // -------- JUPITER --------
-    planets[5].elem = {100.4542,0.0000276854, 1.3030,-0.0000001557,
-                       273.8777,0.0000164505, 5.20256,0,
-                       0.048498,0.000000004469,
-                       19.8950,0.0830853001, 0.4135, 0};
-    planets[5].radiusGL = 0.7f;
+void PlanetSystem::destroy() {
+    GLuint arrays[] = {surfaceArray, tagArray};
+    glDeleteTextures(2, arrays);
+    surfaceArray = tagArray = 0;
+    GLuint buffers[] = {sphereVBO, sphereEBO, sphereInstanceVBO, tagInstanceVBO};
+    glDeleteBuffers(4, buffers);
+    sphereVBO = sphereEBO = sphereInstanceVBO = tagInstanceVBO = 0;
+    if (sphereVAO) glDeleteVertexArrays(1, &sphereVAO);
+    sphereVAO = 0;
+    sphereShader.reset();
+    tagShader.reset();
+    if (impostorVAO) glDeleteVertexArrays(1, &impostorVAO);
+    if (impostorVBO) glDeleteBuffers(1, &impostorVBO);
+    impostorVAO = impostorVBO = 0;
+    impostorShader.reset();
+    trails.destroy();
+    orbitPaths.destroy();
+    if (nameVAO) glDeleteVertexArrays(1, &nameVAO);
+    if (nameVBO) glDeleteBuffers(1, &nameVBO);
+    if (nameEBO) glDeleteBuffers(1, &nameEBO);
+    nameVAO = nameVBO = nameEBO = 0;
 }
 
-void PlanetSystem::loadTextures() {
-    planets[0].texture = loadTexture("resources/tex/sun.jpg");
-    planets[1].texture = loadTexture("resources/tex/mercury.jpg");
-    planets[2].texture = loadTexture("resources/tex/venus.jpg");
-    planets[3].texture = loadTexture("resources/tex/earth.jpg");
-    planets[4].texture = loadTexture("resources/tex/mars.jpg");
-    planets[5].texture = loadTexture("resources/tex/moon.jpg");
-
-    // name texure
-    planets[0].nameTexture = loadTexture("resources/tex/sunTag.png");
-    planets[1].nameTexture = loadTexture("resources/tex/mercuryTag.png");
-    planets[2].nameTexture = loadTexture("resources/tex/venusTag.png");
-    planets[3].nameTexture = loadTexture("resources/tex/earthTag.png");
-    planets[4].nameTexture = loadTexture("resources/tex/marsTag.png");
-    planets[5].nameTexture = loadTexture("resources/tex/moonTag.png");
+bool PlanetSystem::loadOrbitalElements(const std::string& cataloguePath) {
+    std::vector<BodyRecord> bodies;
+    if (!loadCatalogue(cataloguePath, bodies)) return false;
+
+    planets.clear();
+    planets.resize(bodies.size());
+    sphereBodies.clear();
+    smallBodies.clear();
+    for (size_t i = 0; i < bodies.size(); ++i) {
+        planets[i].radiusGL = bodies[i].radius;
+        planets[i].rotPeriod = bodies[i].elem.rotPeriod;
+        planets[i].textureFile = bodies[i].texture;
+        planets[i].tagFile = bodies[i].nameTag;
+        (bodies[i].texture.empty() ? smallBodies : sphereBodies).push_back(i);
+    }
+    std::cout << "Catalogue: " << sphereBodies.size() << " bodies, "
+              << smallBodies.size() << " small bodies" << std::endl;
+    if (!orbit.init(bodies, currTimeDays)) return false;
+
+    // only moons, i.e. bodies whose parent orbits something itself
+    displayScale.assign(bodies.size(), 1.0);
+    for (size_t i = 0; i < bodies.size(); ++i) {
+        int parent = bodies[i].elem.centerOfOrbit;
+        double a = bodies[i].elem.a1 * AU_TO_GL;
+        if (parent < 0 || bodies[parent].elem.centerOfOrbit < 0 || a <= 0.0) continue;
+        displayScale[i] = std::max(1.0, MOON_CLEARANCE * planets[parent].radiusGL / a);
+    }
+    orbit.setDisplayScale(displayScale);
+    return true;
 }
 
-glm::dvec3 PlanetSystem::computeOrbitPositionAU(const Planet& p, double t) {
-    const auto& e = p.elem;
-
-    double N = (e.N1 + e.N2 * t) * DEG2RAD;
-    double inc = (e.i1 + e.i2 * t) * DEG2RAD;
-    double w = (e.w1 + e.w2 * t) * DEG2RAD;
-    double a =  e.a1 + e.a2 * t;
-    double ecc = e.e1 + e.e2 * t;
-    double M = (e.M1 + e.M2 * t) * DEG2RAD;
+void PlanetSystem::loadTextures() {
+    // the catalogue only lists file names; each file becomes one layer
+    auto addLayer = [](const std::string& file, std::vector<std::string>& paths,
+                       std::unordered_map<std::string, int>& layers) -> int {
+        if (file.empty()) return -1;
+        auto inserted = layers.emplace(file, static_cast<int>(paths.size()));
+        if (inserted.second) paths.push_back("resources/tex/" + file);
+        return inserted.first->second;
+    };
 
-    double E = M + ecc * std::sin(M) * (1.0 + ecc * std::cos(M));
+    std::vector<std::string> surfacePaths, tagPaths;
+    std::unordered_map<std::string, int> surfaceLayers, tagLayers;
+    for (size_t i : sphereBodies) {
+        planets[i].textureLayer = addLayer(planets[i].textureFile, surfacePaths, surfaceLayers);
+        planets[i].tagLayer = addLayer(planets[i].tagFile, tagPaths, tagLayers);
+    }
+    surfaceArray = loadTextureArray(surfacePaths, SURFACE_MAX_WIDTH, SURFACE_MAX_HEIGHT);
+    tagArray = loadTextureArray(tagPaths, TAG_MAX_WIDTH, TAG_MAX_HEIGHT);
+}
 
-    double xv = a * (std::cos(E) - ecc);
-    double yv = a * (std::sqrt(1.0 - ecc * ecc) * std::sin(E));
-    double v = std::atan2(yv, xv);
-    double r = std::sqrt(xv * xv + yv * yv);
+int PlanetSystem::affordableSteps() const {
+    double seconds = stepSeconds > 0.0 ? stepSeconds : INITIAL_SECONDS_PER_BODY_STEP * std::max<size_t>(planets.size(), 1);
+    return static_cast<int>(std::min(std::max(STEP_SECONDS_PER_FRAME / seconds, 1.0), static_cast<double>(UNLIMITED_SUBSTEPS)));
+}
 
-    double cosN = std::cos(N);
-    double sinN = std::sin(N);
-    double cosi = std::cos(inc);
-    double sini = std::sin(inc);
-    double cosvw = std::cos(v + w);
-    double sinvw = std::sin(v + w);
+int PlanetSystem::maxSubsteps() const {
+    // only N-body mode has to run every step
+    return orbit.usingNBody() ? affordableSteps() : UNLIMITED_SUBSTEPS;
+}
 
-    double xh = r * (cosN * cosvw - sinN * sinvw * cosi);
-    double zh = -r * (sinN * cosvw + cosN * sinvw * cosi);
-    double yh = r * (sinvw * sini);
+void PlanetSystem::advance(double endDays, int steps) {
+    if (steps <= 0) return;
+    double stepDays = (endDays - currTimeDays) / steps;
+    int run = steps;
+    if (!orbit.usingNBody()) {
+        // closed-form orbits: jump to the last steps the close-approach
+        // sweep can afford, skipping the search before them
+        run = std::min(steps, affordableSteps());
+        if (run < steps) {
+            encounters.skip();
+            step(endDays - run * stepDays);
+        }
+    }
 
-    return glm::dvec3(xh, yh, zh);
+    auto start = std::chrono::steady_clock::now();
+    for (int i = run - 1; i >= 0; --i) step(i == 0 ? endDays : endDays - i * stepDays);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() / run;
+    stepSeconds = seconds > stepSeconds ? seconds : stepSeconds + (seconds - stepSeconds) * STEP_TIME_SMOOTHING;
 }
 
-void PlanetSystem::update(double deltaDays) {
-    currTimeDays += deltaDays;
+void PlanetSystem::step(double timeDays) {
+    for (size_t i = 0; i < planets.size(); ++i) planets[i].prevDisplayAU = orbit.displayPosition(i);
+    prevTimeDays = currTimeDays;
+    currTimeDays = timeDays;
+    orbit.update(timeDays);
+    trailPending = true;
+    encounters.update(currTimeDays, [&](size_t i) { return orbit.position(i); });
+}
 
-    for (auto& p : planets) {
-        p.posAU = computeOrbitPositionAU(p, currTimeDays);
+void PlanetSystem::interpolate(double alpha) {
+    parallelFor(planets.size(), MIN_BODIES_PER_THREAD, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            Planet& p = planets[i];
+            p.renderAU = p.prevDisplayAU + (orbit.displayPosition(i) - p.prevDisplayAU) * alpha;
+        }
+    });
+
+    // the spin is a function of time, so it needs no history
+    double t = prevTimeDays + (currTimeDays - prevTimeDays) * alpha;
+    for (size_t i : sphereBodies) {
+        Planet& p = planets[i];
+        if (p.rotPeriod > 0) {   // kept in [0, 2 pi) so the float copy stays exact
+            double turns = t / p.rotPeriod;
+            p.selfAngle = (turns - std::floor(turns)) * 2.0 * PI;
+        }
+    }
+}
 
-        if (p.elem.rotPeriod > 0)
-            p.selfAngle += (deltaDays / p.elem.rotPeriod) * 2.0 * PI;
+bool PlanetSystem::setUseNBody(bool enable) {
+    bool wasNBody = orbit.usingNBody();
+    if (!orbit.setUseNBody(enable)) return false;
+    if (wasNBody && !enable) {   // back to the elements, a jump
+        trails.clear();
+        encounters.reset();
+    }
+    stepSeconds = 0.0;   // a different kind of step, time it afresh
+    if (!wasNBody && enable) {
+        std::cout << "N-body: " << orbit.massiveCount() << " massive bodies, "
+                  << orbit.size() - orbit.massiveCount() << " test particles" << std::endl;
     }
+    return true;
 }
 
 void PlanetSystem::createName(GLuint& nameVAO, GLuint& nameVBO, GLuint& nameEBO)
@@ -163,49 +296,228 @@ void PlanetSystem::createName(GLuint& nameVAO, GLuint& nameVBO, GLuint& nameEBO)
 }
 
 
-void PlanetSystem::draw(const glm::mat4& view,
-                        const glm::mat4& proj,
-                        GLuint sphereVAO,
-                        int indexCount,
-                        GLuint shaderProgram)
+// Attach the per-instance attributes to the sphere and name tag meshes
+void PlanetSystem::createInstancing()
+{
+    createSphereLods(std::vector<int>(std::begin(SPHERE_LOD_STACKS), std::end(SPHERE_LOD_STACKS)),
+                     sphereVAO, sphereVBO, sphereEBO, sphereLods);
+
+    sphereShader.reset(new Shader("resources/shaders/main.vert", "resources/shaders/main.frag"));
+    tagShader.reset(new Shader("resources/shaders/tag.vert", "resources/shaders/main.frag"));
+    for (Shader* shader : {sphereShader.get(), tagShader.get()}) {
+        shader->Use();
+        glUniform1i(glGetUniformLocation(shader->Program, "uTexture"), 0);
+    }
+    sphereViewLoc = glGetUniformLocation(sphereShader->Program, "view");
+    sphereProjLoc = glGetUniformLocation(sphereShader->Program, "projection");
+    tagViewLoc = glGetUniformLocation(tagShader->Program, "view");
+    tagProjLoc = glGetUniformLocation(tagShader->Program, "projection");
+
+    glGenBuffers(1, &sphereInstanceVBO);
+    glGenBuffers(1, &tagInstanceVBO);
+
+    glBindVertexArray(sphereVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, sphereInstanceVBO);
+    // layout (location = 2): vec4 center, radius
+    glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, sizeof(SphereInstance), (void*)0);
+    glEnableVertexAttribArray(2);
+    glVertexAttribDivisor(2, 1);
+    // layout (location = 3): vec2 spin, layer
+    glVertexAttribPointer(3, 2, GL_FLOAT, GL_FALSE, sizeof(SphereInstance), (void*)offsetof(SphereInstance, spinLayer));
+    glEnableVertexAttribArray(3);
+    glVertexAttribDivisor(3, 1);
+
+    glBindVertexArray(nameVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, tagInstanceVBO);
+    // layout (location = 2): vec4 center, layer
+    glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, sizeof(TagInstance), (void*)0);
+    glEnableVertexAttribArray(2);
+    glVertexAttribDivisor(2, 1);
+    glBindVertexArray(0);
+}
+
+void PlanetSystem::setLodBias(int bias)
+{
+    sphereLodBias = std::min(std::max(bias, -MAX_LOD_BIAS), MAX_LOD_BIAS);
+}
+
+glm::dvec3 PlanetSystem::positionGL(size_t body) const
 {
-    glUseProgram(shaderProgram);
+    return planets[body].renderAU * AU_TO_GL;
+}
 
-    GLint modelLoc = glGetUniformLocation(shaderProgram, "model");
-    GLint viewLoc  = glGetUniformLocation(shaderProgram, "view");
-    GLint projLoc  = glGetUniformLocation(shaderProgram, "projection");
+void PlanetSystem::draw(const glm::dvec3& eyeGL, const glm::mat4& view,
+                        const glm::mat4& proj)
+{
+    // subtract the eye in double first; only the small offsets become float.
+    // Sectors wanted = equator length in pixels / LOD_EDGE_PIXELS, with the
+    // pixel radius from the projection's vertical scale. Spheres smaller
+    // than IMPOSTOR_PIXELS and all small bodies go to the impostor bucket.
+    size_t spheres = sphereBodies.size();
+    size_t n = spheres + smallBodies.size();
+    int lastLod = static_cast<int>(sphereLods.size()) - 1;
+    int impostorBucket = lastLod + 1;
+    double pixelsPerUnit = 0.5 * viewportHeight * proj[1][1];
+    double sectorsPerPixel = 2.0 * PI / LOD_EDGE_PIXELS * std::exp2(sphereLodBias);
+    unsortedInstances.resize(n);
+    instanceLod.resize(n);
+    parallelFor(n, MIN_BODIES_PER_THREAD, [&](size_t begin, size_t end) {
+        for (size_t k = begin; k < end; ++k) {
+            bool small = k >= spheres;
+            const Planet& p = planets[small ? smallBodies[k - spheres] : sphereBodies[k]];
+            glm::dvec3 rel = p.renderAU * AU_TO_GL - eyeGL;
+            unsortedInstances[k].centerRadius = glm::vec4(glm::vec3(rel), p.radiusGL);
+            unsortedInstances[k].spinLayer = glm::vec2(static_cast<float>(p.selfAngle), static_cast<float>(p.textureLayer));
+            if (small) {
+                instanceLod[k] = static_cast<uint8_t>(impostorBucket);
+                continue;
+            }
+
+            double distance = glm::length(rel);
+            int lod = 0;
+            if (distance > p.radiusGL) {
+                double pixels = p.radiusGL / distance * pixelsPerUnit;
+                double wanted = pixels * sectorsPerPixel;
+                while (lod < lastLod && sphereLods[lod + 1].sectors >= wanted) ++lod;
+                if (pixels < IMPOSTOR_PIXELS) lod = impostorBucket;
+            }
+            instanceLod[k] = static_cast<uint8_t>(lod);
+        }
+    });
+
+    // counting sort by level, so each level is one contiguous slice
+    std::fill(std::begin(lodCount), std::end(lodCount), 0);
+    for (uint8_t lod : instanceLod) lodCount[lod]++;
+    for (int l = 0, first = 0; l <= impostorBucket; ++l) {
+        lodFirst[l] = first;
+        first += static_cast<int>(lodCount[l]);
+    }
+    sphereInstances.resize(n);
+    {
+        size_t next[MAX_SPHERE_LODS + 1];
+        std::copy(std::begin(lodFirst), std::end(lodFirst), next);
+        for (size_t k = 0; k < n; ++k) sphereInstances[next[instanceLod[k]]++] = unsortedInstances[k];
+    }
 
-    glUniformMatrix4fv(viewLoc, 1, GL_FALSE, glm::value_ptr(view));
-    glUniformMatrix4fv(projLoc, 1, GL_FALSE, glm::value_ptr(proj));
+    tagInstances.clear();
+    for (size_t i : sphereBodies) {
+        const Planet& p = planets[i];
+        if (p.tagLayer < 0) continue;
+        glm::vec3 namePos = glm::vec3(p.renderAU * AU_TO_GL - eyeGL) + glm::vec3(0.0f, p.radiusGL * -1.5f, 0.0f);
+        tagInstances.push_back({glm::vec4(namePos, static_cast<float>(p.tagLayer))});
+    }
 
-    for (auto& p : planets) {
-        glm::vec3 posGL = glm::vec3(
-            p.posAU.x * AU_TO_GL,
-            p.posAU.y * AU_TO_GL,
-            p.posAU.z * AU_TO_GL
-        );
+    glActiveTexture(GL_TEXTURE0);
+
+    // all spheres
+    sphereShader->Use();
+    glUniformMatrix4fv(sphereViewLoc, 1, GL_FALSE, glm::value_ptr(view));
+    glUniformMatrix4fv(sphereProjLoc, 1, GL_FALSE, glm::value_ptr(proj));
+    glBindTexture(GL_TEXTURE_2D_ARRAY, surfaceArray);
+
+    size_t bytes = sphereInstances.size() * sizeof(SphereInstance);
+    glBindBuffer(GL_ARRAY_BUFFER, sphereInstanceVBO);
+    glBufferData(GL_ARRAY_BUFFER, bytes, nullptr, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, bytes, sphereInstances.data());
+
+    glBindVertexArray(sphereVAO);
+    for (int l = 0; l <= lastLod; ++l) {
+        if (lodCount[l] == 0) continue;
+        // GL 3.3 has no base instance, so point the instance attributes at
+        // this level's slice of the buffer instead
+        size_t offset = lodFirst[l] * sizeof(SphereInstance);
+        glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, sizeof(SphereInstance), (void*)offset);
+        glVertexAttribPointer(3, 2, GL_FLOAT, GL_FALSE, sizeof(SphereInstance),
+                              (void*)(offset + offsetof(SphereInstance, spinLayer)));
+        const SphereLod& lod = sphereLods[l];
+        glDrawElementsInstancedBaseVertex(GL_TRIANGLES, lod.indexCount, GL_UNSIGNED_INT,
+                                          (void*)(lod.firstIndex * sizeof(unsigned int)),
+                                          static_cast<GLsizei>(lodCount[l]), lod.baseVertex);
+    }
 
-        // draw sphere
-        glBindVertexArray(sphereVAO);
-        glm::mat4 model(1.0f);
-        model = glm::translate(model, posGL);
-        model = glm::rotate(model, (float)p.selfAngle, glm::vec3(0,1,0));
-        model = glm::scale(model, glm::vec3(p.radiusGL));
+    if (showOrbits) {
+        orbitPaths.refresh(currTimeDays);
+        orbitPaths.draw(eyeGL, view, proj, ORBIT_COLOR, [&](size_t b) { return positionGL(b); });
+    }
 
-        glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
+    // the step the bodies just left, so trails end behind them
+    if (trailPending) {
+        trailPending = false;
+        trails.push([&](size_t b) { return planets[trailBodies[b]].prevDisplayAU * AU_TO_GL; });
+    }
+    if (showTrails) trails.draw(eyeGL, view, proj, TRAIL_COLOR);
+
+    // everything too small for a mesh, one quad each
+    if (lodCount[impostorBucket] > 0) {
+        impostorShader->Use();
+        GLuint program = impostorShader->Program;
+        glUniformMatrix4fv(glGetUniformLocation(program, "view"), 1, GL_FALSE, glm::value_ptr(view));
+        glUniformMatrix4fv(glGetUniformLocation(program, "projection"), 1, GL_FALSE, glm::value_ptr(proj));
+        glUniform1f(glGetUniformLocation(program, "uPixelsPerUnit"), static_cast<float>(pixelsPerUnit));
+        glUniform1f(glGetUniformLocation(program, "uMinPixels"), IMPOSTOR_MIN_PIXELS);
+        glUniform4fv(glGetUniformLocation(program, "uColor"), 1, glm::value_ptr(SMALL_BODY_COLOR));
+        glUniform1i(glGetUniformLocation(program, "uDepthZeroToOne"), depthZeroToOne ? 1 : 0);
+
+        // the orbit and trail passes above bind their own buffers
+        size_t offset = lodFirst[impostorBucket] * sizeof(SphereInstance);
+        glBindBuffer(GL_ARRAY_BUFFER, sphereInstanceVBO);
+        glBindVertexArray(impostorVAO);
+        glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, sizeof(SphereInstance), (void*)offset);
+        glVertexAttribPointer(3, 2, GL_FLOAT, GL_FALSE, sizeof(SphereInstance),
+                              (void*)(offset + offsetof(SphereInstance, spinLayer)));
+        glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, static_cast<GLsizei>(lodCount[impostorBucket]));
+    }
 
-        glBindTexture(GL_TEXTURE_2D, p.texture);
-        glDrawElements(GL_TRIANGLES, indexCount, GL_UNSIGNED_INT, 0);
+    // all name tags, after the spheres so they blend over them
+    if (!tagInstances.empty()) {
+        tagShader->Use();
+        glUniformMatrix4fv(tagViewLoc, 1, GL_FALSE, glm::value_ptr(view));
+        glUniformMatrix4fv(tagProjLoc, 1, GL_FALSE, glm::value_ptr(proj));
+        glBindTexture(GL_TEXTURE_2D_ARRAY, tagArray);
 
-        // draw name
-        glm::vec3 namePos = posGL + glm::vec3(0.0f, p.radiusGL * -1.5f, 0.0f);
-        glm::mat4 nameModel(1.0f);
-        nameModel = glm::translate(nameModel, namePos);
-        nameModel = glm::scale(nameModel, glm::vec3(1.0f)); // adjust size
-        glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(nameModel));
+        bytes = tagInstances.size() * sizeof(TagInstance);
+        glBindBuffer(GL_ARRAY_BUFFER, tagInstanceVBO);
+        glBufferData(GL_ARRAY_BUFFER, bytes, nullptr, GL_STREAM_DRAW);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, bytes, tagInstances.data());
 
         glBindVertexArray(nameVAO);
-        glBindTexture(GL_TEXTURE_2D, p.nameTexture);
-        glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+        glDrawElementsInstanced(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0,
+                                static_cast<GLsizei>(tagInstances.size()));
     }
+    glBindVertexArray(0);
+}
+
+// Ray-cast spheres: a quad per body, the instance attributes shared with
+// the sphere meshes
+void PlanetSystem::createImpostors()
+{
+    impostorShader.reset(new Shader("resources/shaders/impostor.vert", "resources/shaders/impostor.frag"));
+    impostorShader->Use();
+    glUniform1i(glGetUniformLocation(impostorShader->Program, "uTexture"), 0);
+
+    float corners[] = {
+        -1.0f, -1.0f,
+         1.0f, -1.0f,
+        -1.0f,  1.0f,
+         1.0f,  1.0f
+    };
+    glGenVertexArrays(1, &impostorVAO);
+    glGenBuffers(1, &impostorVBO);
+    glBindVertexArray(impostorVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, impostorVBO);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(corners), corners, GL_STATIC_DRAW);
+
+    // layout (location = 0): vec2 corner
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(0);
+
+    // layout (location = 2, 3): same instance data as the spheres
+    glBindBuffer(GL_ARRAY_BUFFER, sphereInstanceVBO);
+    glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, sizeof(SphereInstance), (void*)0);
+    glEnableVertexAttribArray(2);
+    glVertexAttribDivisor(2, 1);
+    glVertexAttribPointer(3, 2, GL_FLOAT, GL_FALSE, sizeof(SphereInstance), (void*)offsetof(SphereInstance, spinLayer));
+    glEnableVertexAttribArray(3);
+    glVertexAttribDivisor(3, 1);
+    glBindVertexArray(0);
 }
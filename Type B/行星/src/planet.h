@@ -2,52 +2,155 @@
 #define PLANET_H
 #pragma once
 #include <glm/glm.hpp>
+#include <cstdint>
 #include <vector>
 #include <string>
 #include <GLFW/glfw3.h>
 #include <glad/glad.h>
+#include <memory>
+#include "encounter.h"
+#include "orbit_path.h"
+#include "orbit_system.h"
+#include "sphere.h"
+#include "trail.h"
 
-struct OrbitalElements {
-    double N1, N2;
-    double i1, i2;
-    double w1, w2;
-    double a1, a2;
-    double e1, e2;
-    double M1, M2;
-    double rotPeriod;
-    int centerOfOrbit;
-};
+class Shader;
 
+// What the viewer needs of a body besides its orbit (in OrbitSystem)
 struct Planet {
-    OrbitalElements elem;
-
-    glm::dvec3 posAU;
-    double selfAngle;
+    glm::dvec3 prevDisplayAU;  // display position one step earlier
+    glm::dvec3 renderAU;       // between that and the current one, for this frame
+    double selfAngle = 0.0;
+    double rotPeriod = 0.0;    // days
 
     float radiusGL;
-    GLuint texture;
-    GLuint nameTexture;
+    std::string textureFile;   // empty for small bodies, which are always impostors
+    std::string tagFile;
+    int textureLayer = -1;     // layer of the surface texture array
+    int tagLayer = -1;         // layer of the name tag array, -1 for no tag
 };
 
 class PlanetSystem {
 public:
     PlanetSystem();
-    ~PlanetSystem() {}
+    ~PlanetSystem();
+
+    bool init(const std::string& cataloguePath);   // load the catalogue, load textures
+    void destroy();                    // free GL objects while the context is alive
+    void step(double timeDays);        // compute orbital positions at the next clock step
+    // Run one frame's clock steps, the last at endDays. N-body mode
+    // integrates every step; closed-form orbits are only evaluated for as
+    // many final steps as the close-approach sweep can afford.
+    void advance(double endDays, int steps);
+    void interpolate(double alpha);    // blend the last two steps for drawing
+    // render planets; view holds only the camera rotation, eyeGL is the
+    // camera position and everything is drawn relative to it
+    void draw(const glm::dvec3& eyeGL, const glm::mat4& view,
+              const glm::mat4& proj);
+
+    // Framebuffer size, for the on-screen size of each body
+    void setViewport(int width, int height) { viewportWidth = width; viewportHeight = height; }
+
+    // Depth range set by glClipControl: [0, 1] instead of [-1, 1] in clip
+    // space; the impostors write their own depth and need to know
+    void setDepthZeroToOne(bool enable) { depthZeroToOne = enable; }
+
+    // Sphere detail: each step up doubles the triangles along the equator
+    void setLodBias(int bias);
+    int lodBias() const { return sphereLodBias; }
+
+    size_t bodyCount() const { return planets.size(); }
+    const std::string& bodyName(size_t body) const { return orbit.name(body); }
+    glm::dvec3 positionGL(size_t body) const;   // drawn position this frame
+
+    // Limits for SimClock::setLimits: a step short enough for the fastest
+    // orbit, and as many steps per frame as the measured step time affords
+    double maxStepDays() const { return orbit.maxStepDays(); }
+    int maxSubsteps() const;
+
+    // Positions from the Chebyshev cache (default) or straight from the elements
+    void setUseEphemeris(bool enable) { orbit.setUseEphemeris(enable); }
+    bool usingEphemeris() const { return orbit.usingEphemeris(); }
 
-    void init();                       // load planet data, load textures
-    void update(double deltaDays);     // compute orbital positions
-    void draw(const glm::mat4& view, 
-              const glm::mat4& proj,
-              unsigned int sphereVAO,
-              int sphereIndexCount,
-              GLuint shaderProgram);   // render planets
+    // Positions integrated under gravity from the current state instead of
+    // taken from the elements; needs at least one body with a mass
+    bool setUseNBody(bool enable);
+    bool usingNBody() const { return orbit.usingNBody(); }
+
+    // Close approaches found by the steps since the last clearEncounters(),
+    // bodies orbiting each other excepted
+    void setEncounterDistance(double au) { encounters.setDistance(au); }
+    double encounterDistance() const { return encounters.distance(); }
+    const std::vector<Encounter>& newEncounters() const { return encounters.events(); }
+    void clearEncounters() { encounters.clearEvents(); }
+
+    // Full orbit ellipses from the elements
+    void setShowOrbits(bool enable) { showOrbits = enable; }
+    bool showingOrbits() const { return showOrbits; }
+
+    // Fading trails of recent positions
+    void setShowTrails(bool enable) { showTrails = enable; }
+    bool showingTrails() const { return showTrails; }
 
 private:
-    glm::dvec3 computeOrbitPositionAU(const Planet& p, double timeD);
-    void loadOrbitalElements();
+    bool loadOrbitalElements(const std::string& cataloguePath);
     void loadTextures();
     void createName( GLuint& nameVAO, GLuint& nameVBO, GLuint& nameEBO);
+    void createInstancing();
+    void createImpostors();
+    int affordableSteps() const;
     std::vector<Planet> planets;
+    std::vector<size_t> sphereBodies;           // textured, drawn as spheres
+    std::vector<size_t> smallBodies;            // untextured, ray cast
+
+    // Orbits, positions and propagation; the rest of this class draws them
+    OrbitSystem orbit;
+    std::vector<double> displayScale;           // moon orbits widened to clear their planet
+    EncounterDetector encounters;               // fed the true positions every step
     double currTimeDays;
+    double prevTimeDays;
+    double stepSeconds = 0.0;                   // measured wall-clock time per step, 0 until timed
+
+    // One instanced draw per sphere level of detail, one of ray-cast quads
+    // for everything too small for a mesh, and one for all name tags. The
+    // instance buffers are orphaned and refilled every frame, the spheres
+    // sorted by level with the impostors last; the surface maps and tags
+    // are layers of two texture arrays.
+    struct SphereInstance {
+        glm::vec4 centerRadius;   // GL units
+        glm::vec2 spinLayer;      // self rotation (radians), texture layer
+    };
+    struct TagInstance {
+        glm::vec4 centerLayer;    // tag center, tag layer
+    };
+    std::vector<SphereInstance> sphereInstances;    // sorted by level, impostors last
+    std::vector<SphereInstance> unsortedInstances;
+    std::vector<uint8_t> instanceLod;
+    static const int MAX_SPHERE_LODS = 8;
+    size_t lodFirst[MAX_SPHERE_LODS + 1] = {}, lodCount[MAX_SPHERE_LODS + 1] = {};
+    std::vector<TagInstance> tagInstances;
+    std::unique_ptr<Shader> sphereShader, tagShader;
+    GLint sphereViewLoc = -1, sphereProjLoc = -1, tagViewLoc = -1, tagProjLoc = -1;
+    GLuint surfaceArray = 0, tagArray = 0;
+    GLuint sphereVAO = 0, sphereVBO = 0, sphereEBO = 0;
+    std::vector<SphereLod> sphereLods;          // finest first
+    int sphereLodBias = 0;
+    int viewportWidth = 800, viewportHeight = 600;
+    bool depthZeroToOne = false;
+    GLuint nameVAO = 0, nameVBO = 0, nameEBO = 0;
+    GLuint sphereInstanceVBO = 0, tagInstanceVBO = 0;
+
+    std::unique_ptr<Shader> impostorShader;
+    GLuint impostorVAO = 0, impostorVBO = 0;
+
+    OrbitPaths orbitPaths;
+    bool showOrbits = true;
+
+    // One sample per frame that had a new step, for the first
+    // MAX_TRAIL_BODIES bodies (spheres first)
+    TrailBuffer trails;
+    std::vector<size_t> trailBodies;
+    bool trailPending = false;
+    bool showTrails = true;
 };
 #endif
\ No newline at end of file
@@ -0,0 +1,78 @@
+#include "sim_clock.h"
+#include <algorithm>
+#include <cmath>
+
+const double SimClock::MIN_WARP = 1.0 / 86400.0;
+const double SimClock::MAX_WARP = 1e6;
+
+namespace {
+
+// Frame time the step budget is planned for
+const double NOMINAL_FRAME_SECONDS = 1.0 / 60.0;
+
+// Longer frames (a breakpoint, a dragged window) are cut to this instead
+// of being caught up
+const double MAX_FRAME_SECONDS = 0.25;
+
+} // namespace
+
+SimClock::SimClock(double startDays) : base(startDays)
+{
+    chooseStep();
+}
+
+void SimClock::setLimits(double maxStepDays, int substeps)
+{
+    maxStep = maxStepDays;
+    maxSubsteps = std::max(substeps, 1);
+    chooseStep();
+}
+
+void SimClock::setWarp(double daysPerSecond)
+{
+    requestedWarp = std::min(std::max(daysPerSecond, MIN_WARP), MAX_WARP);
+    chooseStep();
+}
+
+void SimClock::setReversed(bool reverse)
+{
+    double d = reverse ? -1.0 : 1.0;
+    if (d == direction) return;
+    base = time();
+    index = 0;
+    direction = d;
+}
+
+void SimClock::chooseStep()
+{
+    double step = std::exp2(std::floor(std::log2(maxStep)));
+    warpDays = std::min(requestedWarp, maxSubsteps * step / NOMINAL_FRAME_SECONDS);
+    if (step == stepSize) return;
+
+    // restart the step count from here, keeping alpha where it was
+    double a = alpha();
+    base = time();
+    index = 0;
+    stepSize = step;
+    pending = a * stepSize;
+}
+
+int SimClock::advance(double realSeconds)
+{
+    if (paused) return 0;
+
+    pending += std::min(std::max(realSeconds, 0.0), MAX_FRAME_SECONDS) * warpDays;
+    double steps = std::floor(pending / stepSize);
+    pending -= steps * stepSize;
+
+    // a slow frame may run twice its budget to catch up; past that (a long
+    // frame at a high warp) the rest is dropped
+    if (steps > 2.0 * maxSubsteps) steps = 2.0 * maxSubsteps;
+    return static_cast<int>(steps);
+}
+
+double SimClock::step(int count)
+{
+    index += count;
+    return time();
+}
@@ -0,0 +1,66 @@
+#ifndef SIM_CLOCK_H
+#define SIM_CLOCK_H
+
+#include <cstdint>
+
+// Simulation time in days, advanced in fixed steps independent of the
+// frame rate. The time of step k is base + k * step, both doubles, so no
+// error piles up from adding frame deltas over a long session; the same
+// warp always gives the same step, so every run visits the same times.
+//
+// Each frame advance() turns real seconds into a number of whole steps and
+// leaves the remainder as alpha, for drawing between the last two steps.
+// The step is the largest power of two (in days) no longer than the
+// system's maxStep, whatever the warp. A warp that would need more than
+// maxSubsteps per frame is held down to what that many steps cover, so
+// the cost per frame stays bounded without ever taking unstable steps.
+class SimClock
+{
+public:
+    explicit SimClock(double startDays = 0.0);
+
+    // Largest step that keeps body motion correct, and the most steps a
+    // frame may run
+    void setLimits(double maxStepDays, int maxSubsteps);
+
+    // Asked for warp, clamped to [MIN_WARP, MAX_WARP]; warp() is what the
+    // limits allow of it
+    void setWarp(double daysPerSecond);
+    double warp() const { return warpDays; }
+    bool warpLimited() const { return warpDays < requestedWarp; }
+
+    void setReversed(bool reverse);
+    bool reversed() const { return direction < 0.0; }
+    void setPaused(bool pause) { paused = pause; }
+    bool isPaused() const { return paused; }
+
+    // Number of steps to run for this frame
+    int advance(double realSeconds);
+
+    // Move count steps on and return the time reached
+    double step(int count = 1);
+
+    double time() const { return base + static_cast<double>(index) * stepSigned(); }
+    double stepDays() const { return stepSize; }
+    double alpha() const { return stepSize > 0.0 ? pending / stepSize : 0.0; }
+
+    static const double MIN_WARP;   // real time, 1 s per second
+    static const double MAX_WARP;   // 1e6 days per second
+
+private:
+    void chooseStep();
+    double stepSigned() const { return stepSize * direction; }
+
+    double base;
+    int64_t index = 0;
+    double stepSize = 1.0;
+    double direction = 1.0;
+    double pending = 0.0;        // days accumulated towards the next step
+    double requestedWarp = 5.0;
+    double warpDays = 5.0;       // requestedWarp, held to the substep budget
+    double maxStep = 1.0;
+    int maxSubsteps = 256;
+    bool paused = false;
+};
+
+#endif
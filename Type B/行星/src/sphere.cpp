@@ -4,18 +4,15 @@
 
 const double PI = 3.14159265358979323846;
 
-void createSphere(
+// Vertices (position, uv) and indices of one UV sphere, appended to the
+// arrays; indices start from 0 for this sphere
+static void appendSphere(
     float radius,
     int stackCount,
     int sectorCount,
-    GLuint& sphereVAO,
-    GLuint& sphereVBO,
-    GLuint& sphereEBO,
-    int& indexCount)
+    std::vector<float>& vertices,
+    std::vector<unsigned int>& indices)
 {
-    std::vector<float> vertices;
-    std::vector<unsigned int> indices;
-
     // -----------generate vertices
     for (int i =0; i <= stackCount; ++i)
     {
@@ -73,6 +70,20 @@ void createSphere(
             }
         }
     }
+}
+
+void createSphere(
+    float radius,
+    int stackCount,
+    int sectorCount,
+    GLuint& sphereVAO,
+    GLuint& sphereVBO,
+    GLuint& sphereEBO,
+    int& indexCount)
+{
+    std::vector<float> vertices;
+    std::vector<unsigned int> indices;
+    appendSphere(radius, stackCount, sectorCount, vertices, indices);
 
     indexCount = static_cast<int>(indices.size());
 
@@ -102,5 +113,45 @@ void createSphere(
     glBindVertexArray(0);
 }
 
+void createSphereLods(
+    const std::vector<int>& stackCounts,
+    GLuint& sphereVAO,
+    GLuint& sphereVBO,
+    GLuint& sphereEBO,
+    std::vector<SphereLod>& lods)
+{
+    std::vector<float> vertices;
+    std::vector<unsigned int> indices;
+    lods.clear();
+    for (int stacks : stackCounts)
+    {
+        SphereLod lod;
+        lod.stacks = stacks;
+        lod.sectors = 2 * stacks;
+        lod.firstIndex = static_cast<int>(indices.size());
+        lod.baseVertex = static_cast<int>(vertices.size() / 5);
+        appendSphere(1.0f, lod.stacks, lod.sectors, vertices, indices);
+        lod.indexCount = static_cast<int>(indices.size()) - lod.firstIndex;
+        lods.push_back(lod);
+    }
+
+    // --------- VAO/VBO/EBO, same layout as createSphere
+    glGenVertexArrays(1, &sphereVAO);
+    glGenBuffers(1, &sphereVBO);
+    glGenBuffers(1, &sphereEBO);
 
+    glBindVertexArray(sphereVAO);
 
+    glBindBuffer(GL_ARRAY_BUFFER, sphereVBO);
+    glBufferData(GL_ARRAY_BUFFER, vertices.size()*sizeof(float), vertices.data(), GL_STATIC_DRAW);
+
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, sphereEBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size()*sizeof(unsigned int), indices.data(), GL_STATIC_DRAW);
+
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(3 *sizeof(float)));
+    glEnableVertexAttribArray(1);
+
+    glBindVertexArray(0);
+}
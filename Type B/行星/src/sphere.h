@@ -2,6 +2,7 @@
 #define SPHERE_H
 
 #include <glad/glad.h>
+#include <vector>
 
 void createSphere(
     float radius,
@@ -13,5 +14,24 @@ void createSphere(
     int& indexCount
 );
 
+// One unit sphere inside the buffers shared by all levels of detail
+struct SphereLod {
+    int stacks, sectors;
+    int firstIndex;    // in the element buffer
+    int indexCount;
+    int baseVertex;    // added to every index of this level
+};
+
+// Unit spheres with stackCounts[k] stacks and twice as many sectors, one
+// per level, packed into a single VBO/EBO behind one VAO. Draw level k
+// with glDrawElementsBaseVertex(..., firstIndex, baseVertex).
+void createSphereLods(
+    const std::vector<int>& stackCounts,
+    GLuint& sphereVAO,
+    GLuint& sphereVBO,
+    GLuint& sphereEBO,
+    std::vector<SphereLod>& lods
+);
+
 #endif
 
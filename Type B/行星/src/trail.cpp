@@ -0,0 +1,142 @@
+#include "trail.h"
+#include "parallel.h"
+#include "shader.h"
+#include <glm/gtc/type_ptr.hpp>
+#include <algorithm>
+#include <iostream>
+
+namespace {
+
+const size_t MIN_BODIES_PER_THREAD = 4096;
+const size_t TEXELS_PER_SAMPLE = 2;   // high, low
+
+// Waits on a push fence are retried in slices of this long
+const GLuint64 FENCE_WAIT_NS = 100000000;
+
+// float halves of a double: high + low == value to about 48 bits
+inline void splitDouble(const glm::dvec3& value, glm::vec3& high, glm::vec3& low)
+{
+    high = glm::vec3(value);
+    low = glm::vec3(value - glm::dvec3(high));
+}
+
+} // namespace
+
+TrailBuffer::~TrailBuffer() {}
+
+bool TrailBuffer::init(size_t maxBodies)
+{
+    GLint maxTexels = 0;
+    glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &maxTexels);
+    size_t limit = static_cast<size_t>(std::max(maxTexels, 0)) / (TEXELS_PER_SAMPLE * TRAIL_LENGTH);
+    bodyCount = std::min(maxBodies, limit);
+    if (bodyCount < maxBodies) {
+        std::cout << "Trails limited to " << bodyCount << " bodies by the buffer texture size" << std::endl;
+    }
+    head = count = 0;
+    if (bodyCount == 0) return false;
+
+    shader.reset(new Shader("resources/shaders/trail.vert", "resources/shaders/trail.frag"));
+    shader->Use();
+    glUniform1i(glGetUniformLocation(shader->Program, "uTrail"), 0);
+
+    glGenBuffers(1, &VBO);
+    glBindBuffer(GL_TEXTURE_BUFFER, VBO);
+    glBufferData(GL_TEXTURE_BUFFER, bodyCount * TRAIL_LENGTH * TEXELS_PER_SAMPLE * sizeof(glm::vec4),
+                 nullptr, GL_STREAM_DRAW);
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_BUFFER, texture);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, VBO);
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+    // no attributes, the shader works from gl_VertexID and gl_InstanceID
+    glGenVertexArrays(1, &VAO);
+    return true;
+}
+
+void TrailBuffer::destroy()
+{
+    if (VAO) glDeleteVertexArrays(1, &VAO);
+    if (VBO) glDeleteBuffers(1, &VBO);
+    if (texture) glDeleteTextures(1, &texture);
+    VAO = VBO = texture = 0;
+    for (GLsync& fence : fences) {
+        if (fence) glDeleteSync(fence);
+        fence = nullptr;
+    }
+    shader.reset();
+    bodyCount = 0;
+    head = count = 0;
+}
+
+void TrailBuffer::push(const std::function<glm::dvec3(size_t)>& positionGL)
+{
+    if (bodyCount == 0) return;
+
+    // every draw that read row head came before the push that left this
+    // fence; then fence everything so far for the push that many rows on
+    GLsync& fence = fences[head % TRAIL_GUARD_ROWS];
+    if (fence) {
+        GLenum status = GL_TIMEOUT_EXPIRED;
+        while (status == GL_TIMEOUT_EXPIRED) status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, FENCE_WAIT_NS);
+        glDeleteSync(fence);
+    }
+    fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+    size_t rowBytes = bodyCount * TEXELS_PER_SAMPLE * sizeof(glm::vec4);
+    glBindBuffer(GL_TEXTURE_BUFFER, VBO);
+    void* mapped = glMapBufferRange(GL_TEXTURE_BUFFER, static_cast<GLintptr>(head * rowBytes),
+                                    static_cast<GLsizeiptr>(rowBytes),
+                                    GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+    if (!mapped) {
+        glBindBuffer(GL_TEXTURE_BUFFER, 0);
+        return;
+    }
+
+    glm::vec4* row = static_cast<glm::vec4*>(mapped);
+    parallelFor(bodyCount, MIN_BODIES_PER_THREAD, [&](size_t begin, size_t end) {
+        for (size_t b = begin; b < end; ++b) {
+            glm::vec3 high, low;
+            splitDouble(positionGL(b), high, low);
+            row[TEXELS_PER_SAMPLE * b] = glm::vec4(high, 1.0f);
+            row[TEXELS_PER_SAMPLE * b + 1] = glm::vec4(low, 0.0f);
+        }
+    });
+    glUnmapBuffer(GL_TEXTURE_BUFFER);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+    head = (head + 1) % TRAIL_LENGTH;
+    count = std::min(count + 1, TRAIL_LENGTH - TRAIL_GUARD_ROWS);
+}
+
+void TrailBuffer::draw(const glm::dvec3& eyeGL, const glm::mat4& view, const glm::mat4& proj, const glm::vec4& color)
+{
+    if (bodyCount == 0 || count < 2) return;
+
+    glm::vec3 eyeHigh, eyeLow;
+    splitDouble(eyeGL, eyeHigh, eyeLow);
+
+    shader->Use();
+    GLuint program = shader->Program;
+    glUniformMatrix4fv(glGetUniformLocation(program, "view"), 1, GL_FALSE, glm::value_ptr(view));
+    glUniformMatrix4fv(glGetUniformLocation(program, "projection"), 1, GL_FALSE, glm::value_ptr(proj));
+    glUniform3fv(glGetUniformLocation(program, "uEyeHigh"), 1, glm::value_ptr(eyeHigh));
+    glUniform3fv(glGetUniformLocation(program, "uEyeLow"), 1, glm::value_ptr(eyeLow));
+    glUniform4fv(glGetUniformLocation(program, "uColor"), 1, glm::value_ptr(color));
+    glUniform1i(glGetUniformLocation(program, "uBodies"), static_cast<GLint>(bodyCount));
+    glUniform1i(glGetUniformLocation(program, "uRows"), TRAIL_LENGTH);
+    glUniform1i(glGetUniformLocation(program, "uHead"), head);
+    glUniform1i(glGetUniformLocation(program, "uCount"), count);
+
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_BUFFER, texture);
+
+    // blended over the scene, without hiding what is drawn after
+    glDepthMask(GL_FALSE);
+    glBindVertexArray(VAO);
+    glDrawArraysInstanced(GL_LINE_STRIP, 0, count, static_cast<GLsizei>(bodyCount));
+    glBindVertexArray(0);
+    glDepthMask(GL_TRUE);
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+}
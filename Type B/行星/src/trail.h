@@ -0,0 +1,68 @@
+#ifndef TRAIL_H
+#define TRAIL_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <functional>
+#include <memory>
+
+class Shader;
+
+// Samples kept per body; TRAIL_GUARD_ROWS of them are never drawn (below)
+const int TRAIL_LENGTH = 128;
+const int TRAIL_GUARD_ROWS = 4;
+static_assert(TRAIL_LENGTH % TRAIL_GUARD_ROWS == 0, "fence slots follow the ring");
+
+// Recent positions of many bodies in one GPU ring buffer, drawn as
+// fading line strips.
+//
+// The buffer is slot major: row r holds sample r of every body, each as
+// two RGBA32F texels (the high and low float halves of the position in GL
+// units). push() writes one row through glMapBufferRange with
+// UNSYNCHRONIZED | INVALIDATE_RANGE, so nothing else is uploaded and the
+// driver does not stall on the whole buffer. Draws stop TRAIL_GUARD_ROWS
+// short of a full ring, so the row being replaced was last drawn before
+// the push() that many pushes ago; each push() leaves a fence, and the
+// one from then is waited on before writing. Unless the GPU is that far
+// behind, the wait returns at once.
+//
+// The vertex shader reads the samples through a buffer texture and
+// subtracts the eye's high and low halves separately, so trails far from
+// the origin keep full precision.
+// All trails are one glDrawArraysInstanced: an instance per body, a
+// vertex per sample.
+class TrailBuffer
+{
+public:
+    TrailBuffer() = default;
+    ~TrailBuffer();
+
+    TrailBuffer(const TrailBuffer&) = delete;
+    TrailBuffer& operator=(const TrailBuffer&) = delete;
+
+    // Room for up to maxBodies trails, fewer if the buffer texture limit
+    // is lower; call with a current context
+    bool init(size_t maxBodies);
+    void destroy();
+
+    // One new sample per body, at most once per frame; positionGL(b) gives
+    // body b's position in GL units
+    void push(const std::function<glm::dvec3(size_t)>& positionGL);
+
+    // Forget all samples, e.g. after the positions jump
+    void clear() { count = 0; }
+
+    void draw(const glm::dvec3& eyeGL, const glm::mat4& view, const glm::mat4& proj, const glm::vec4& color);
+
+    size_t bodies() const { return bodyCount; }
+
+private:
+    size_t bodyCount = 0;
+    int head = 0;     // next row written
+    int count = 0;    // rows drawn, at most TRAIL_LENGTH - TRAIL_GUARD_ROWS
+    GLuint VAO = 0, VBO = 0, texture = 0;
+    GLsync fences[TRAIL_GUARD_ROWS] = {};   // one per recent push(), slot head % TRAIL_GUARD_ROWS
+    std::unique_ptr<Shader> shader;
+};
+
+#endif